@@ -0,0 +1,212 @@
+/**********************************************************
+   audio_profile.h
+   Sample rate / block size profile for every app, and a
+   measurement mode for it
+
+   The apps take their timing from AudioSampleRate() and
+   AudioBlockSize(), so a profile only has to be applied
+   right after the board's Init(), before anything reads
+   them:
+
+       patch.Init();
+       ApplyAudioProfile(patch);
+       float sr = patch.AudioSampleRate();
+
+   The profile is picked at build time (see the app
+   Makefiles):
+
+       make SR=96000 BLOCK=16
+
+   which defines DAISYEX_SAMPLE_RATE / DAISYEX_BLOCK_SIZE.
+   Left out, the board default stays (48 kHz, 48 samples
+   on the Patch and the Pod; the host tools' -r / -b).
+
+   Measurement mode (make MEASURE=1, AUDIO_MEASURE in the
+   apps) adds an AudioMeasure:
+     - round trip: a click every 250 ms on one output,
+       timed on one input; patch a cable between the two
+       (Patch: out 4 => in 1, Pod: out R => in L). This
+       includes the codec's filters; the buffering part
+       alone is two blocks (the DMA half being played and
+       the one being filled), printed next to it.
+     - callback overhead: the share of the callback's
+       cycles outside its per-sample sections
+       (CycleProfiler::OverheadPercent()); the interrupt
+       entry and libDaisy's buffer handling around the
+       callback come on top.
+     - load: average, p99 (5% bins, at most the worst)
+       and worst callback
+       in percent of the block deadline, and the headroom
+       left at the worst one.
+   It prints one line per report over the Logger (USB):
+
+       48000 Hz / 48: buffers 2.00 ms, round trip 2.52 ms
+       (121 smp), cpu 12% p99 20% max 30%, overhead 18%,
+       headroom 70%
+**********************************************************/
+#pragma once
+#ifndef DAISYEX_AUDIO_PROFILE_H
+#define DAISYEX_AUDIO_PROFILE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include "daisy.h"
+#include "fixed_format.h"
+
+#if defined(DAISYEX_SAMPLE_RATE)
+static_assert(DAISYEX_SAMPLE_RATE == 8000 || DAISYEX_SAMPLE_RATE == 16000
+                  || DAISYEX_SAMPLE_RATE == 32000
+                  || DAISYEX_SAMPLE_RATE == 48000
+                  || DAISYEX_SAMPLE_RATE == 96000,
+              "DAISYEX_SAMPLE_RATE: 8000, 16000, 32000, 48000 or 96000");
+#endif
+#if defined(DAISYEX_BLOCK_SIZE)
+static_assert(DAISYEX_BLOCK_SIZE >= 1 && DAISYEX_BLOCK_SIZE <= 256,
+              "DAISYEX_BLOCK_SIZE: 1..256");
+#endif
+
+namespace daisyex
+{
+// ----------------------------------------------------
+// Profile
+// ----------------------------------------------------
+inline daisy::SaiHandle::Config::SampleRate SaiRate(uint32_t hz)
+{
+    typedef daisy::SaiHandle::Config::SampleRate Rate;
+    switch(hz)
+    {
+        case 8000: return Rate::SAI_8KHZ;
+        case 16000: return Rate::SAI_16KHZ;
+        case 32000: return Rate::SAI_32KHZ;
+        case 96000: return Rate::SAI_96KHZ;
+        default: return Rate::SAI_48KHZ;
+    }
+}
+
+// after hw.Init(), before the rate or block size is read
+template <typename Board>
+void ApplyAudioProfile(Board &hw)
+{
+#if defined(DAISYEX_SAMPLE_RATE)
+    hw.SetAudioSampleRate(SaiRate(DAISYEX_SAMPLE_RATE));
+#endif
+#if defined(DAISYEX_BLOCK_SIZE)
+    hw.SetAudioBlockSize(DAISYEX_BLOCK_SIZE);
+#endif
+    (void)hw;
+}
+
+// ----------------------------------------------------
+// Measurement mode
+// ----------------------------------------------------
+class AudioMeasure
+{
+  public:
+    void Init(float samplerate, size_t blocksize)
+    {
+        sr_        = samplerate;
+        block_     = blocksize;
+        period_    = (uint32_t)(samplerate * 0.25f);
+        now_       = 0;
+        next_      = period_;
+        sent_      = 0;
+        waiting_   = false;
+        last_      = 0;
+        count_     = 0;
+        misses_    = 0;
+        threshold_ = 0.25f;
+    }
+
+    // Audio callback, after the app has written 'out':
+    // the probe's output channel carries only the clicks.
+    void Process(const float *in, float *out, size_t size)
+    {
+        for(size_t i = 0; i < size; i++)
+        {
+            uint32_t t = now_ + (uint32_t)i;
+            if(waiting_)
+            {
+                if(fabsf(in[i]) > threshold_)
+                {
+                    last_    = t - sent_;
+                    waiting_ = false;
+                    count_   = count_ + 1;
+                }
+                else if(t - sent_ >= period_ - 1)
+                {
+                    // nothing came back before the next click
+                    waiting_ = false;
+                    misses_  = misses_ + 1;
+                }
+            }
+            out[i] = 0.f;
+            if(t == next_)
+            {
+                out[i]   = 0.9f;
+                sent_    = t;
+                next_    = t + period_;
+                waiting_ = true;
+            }
+        }
+        now_ += (uint32_t)size;
+    }
+
+    // last round trip in samples (0 before the first)
+    uint32_t RoundTripSamples() const { return last_; }
+    uint32_t Count() const { return count_; }
+    uint32_t Misses() const { return misses_; }
+    // the DMA double buffer alone: one block in, one out
+    float BufferMs() const { return 2000.f * (float)block_ / sr_; }
+
+    // one line for the Logger
+    template <typename Prof, typename PrintFn>
+    void Report(const Prof &prof, PrintFn print) const
+    {
+        char       line[128];
+        TextWriter w(line, sizeof(line));
+        w.Uint((uint32_t)sr_)
+            .Str(" Hz / ")
+            .Uint(block_)
+            .Str(": buffers ")
+            .Fixed(BufferMs(), 2)
+            .Str(" ms, round trip ");
+        uint32_t rt = last_;
+        if(count_ > 0)
+            w.Fixed(1000.f * (float)rt / sr_, 2)
+                .Str(" ms (")
+                .Uint(rt)
+                .Str(" smp)");
+        else
+            w.Str("-- (no loopback)");
+        // Percentile() is a bin's upper edge (5% bins), which
+        // can be above the worst callback actually seen
+        uint32_t max = prof.MaxLoad();
+        uint32_t p99 = prof.LoadHistogram().Percentile(0.99f);
+        if(p99 > max)
+            p99 = max;
+        w.Str(", cpu ")
+            .Uint(prof.AvgLoad())
+            .Str("% p99 ")
+            .Uint(p99)
+            .Str("% max ")
+            .Uint(max)
+            .Str("%, overhead ")
+            .Uint(prof.OverheadPercent())
+            .Str("%, headroom ")
+            .Uint(prof.Headroom())
+            .Char('%');
+        print(line);
+    }
+
+  private:
+    float             sr_, threshold_;
+    size_t            block_;
+    uint32_t          period_, now_, next_, sent_;
+    bool              waiting_;
+    volatile uint32_t last_, count_, misses_;
+};
+
+} // namespace daisyex
+
+#endif
@@ -0,0 +1,313 @@
+/**********************************************************
+   clock_sync.h
+   Step clock locked to MIDI clock or a gate input
+
+   The step phase runs on a beat position P counted in
+   input pulses (32.32 fixed point). Each sample adds the
+   current rate; a step falls on the sample where P passes
+   the next multiple of the step length, so steps land on
+   exact sample offsets whatever the block size.
+
+   Pulses (MIDI 0xF8 at 24 per quarter, or gate rising
+   edges) only ever steer the rate: the k-th pulse since
+   Start() should arrive at P = k, and the difference
+   drives a PI loop
+       rate_int += ki * err * rate_int
+       rate      = rate_int * (1 + kp * err)
+   so timestamp jitter on the pulses (the apps poll at
+   4 kHz, 250 us) is smoothed rather than copied onto the
+   steps. A pulse more than half a pulse off (first pulse,
+   tempo jump) resyncs P to it instead; a backwards resync
+   never repeats a step already taken.
+
+       ClockSync clk;
+       clk.Init(sr);
+       clk.SetRatio(1, 6);       // one step per 6 pulses
+       ...                       // (MIDI 1/16 notes)
+       if(pulse_on_this_sample)  // before Tick()
+           clk.Pulse();
+       if(clk.Tick())
+           ... step on this sample
+
+   Start()/Stop()/Continue() follow MIDI transport: after
+   Start() the next pulse is beat 1 and steps at once.
+   Between pulses P runs on at most half a pulse past the
+   next one due, so a clock that stops costs at most the
+   step due on its missing edge; after kTimeoutPulses
+   periods without one the next pulse is beat 1 again (a
+   gate clock restarting).
+
+   Jitter measurement: Stats() since the last ResetStats()
+   gives the RMS jitter of the input pulse intervals, of
+   the output step intervals (both against the tracked
+   period) and the RMS phase error, in microseconds.
+**********************************************************/
+#pragma once
+#ifndef DAISYEX_CLOCK_SYNC_H
+#define DAISYEX_CLOCK_SYNC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+namespace daisyex
+{
+class ClockSync
+{
+  public:
+    static const uint32_t kTimeoutPulses = 3;
+    static const uint32_t kLockPulses    = 8; // within 5% in a row
+    static const uint64_t kHalfPulse     = 1ull << 31;
+
+    struct JitterStats
+    {
+        uint32_t pulses;     // input pulses in the window
+        uint32_t steps;      // steps taken in the window
+        float    in_us;      // RMS, pulse interval vs period
+        float    out_us;     // RMS, step interval vs period
+        float    phase_us;   // RMS, pulse vs beat position
+        float    period_us;  // tracked pulse period
+        bool     locked;
+    };
+
+    void Init(float samplerate)
+    {
+        sr_          = samplerate;
+        kp_          = 0.25f;
+        ki_          = 0.03f;
+        pos_         = 0;
+        limit_       = 0;
+        SetRatio(1, 1);
+        rate_        = 0;
+        rate_int_    = 0.f;
+        now_         = 0;
+        last_pulse_  = 0;
+        last_step_   = 0;
+        pulse_index_ = 0;
+        timeout_     = 0;
+        step_timed_  = false;
+        have_pulse_  = false;
+        have_rate_   = false;
+        running_     = true;
+        holding_     = false;
+        restart_     = true;
+        lock_count_  = 0;
+        ResetStats();
+    }
+
+    // 'steps' steps every 'pulses' input pulses: MIDI 1/16
+    // notes = (1, 6), a gate clock doubled = (2, 1)
+    void SetRatio(uint32_t steps, uint32_t pulses)
+    {
+        steps_     = steps > 0 ? steps : 1;
+        pulses_    = pulses > 0 ? pulses : 1;
+        step_len_  = ((uint64_t)pulses_ << 32) / steps_;
+        next_step_ = NextBoundary(pos_);
+    }
+
+    // loop gains: kp corrects that fraction of the phase
+    // error per pulse, ki integrates it into the rate
+    void SetGains(float kp, float ki)
+    {
+        kp_ = kp;
+        ki_ = ki;
+    }
+
+    // MIDI transport
+    void Start()
+    {
+        running_ = true;
+        restart_ = true;
+    }
+    void Stop() { running_ = false; }
+    void Continue() { running_ = true; }
+    bool Running() const { return running_; }
+
+    // an input pulse on the sample about to be Tick()ed
+    void Pulse()
+    {
+        uint32_t interval = now_ - last_pulse_;
+        bool     timed    = have_pulse_ && !holding_;
+        last_pulse_       = now_;
+        have_pulse_       = true;
+        holding_          = false;
+        win_pulses_++;
+        if(timed)
+        {
+            if(have_rate_)
+            {
+                // interval jitter against the tracked period
+                float dev = (float)interval - Period();
+                sum_in_ += dev * dev;
+                n_in_++;
+            }
+            else
+            {
+                rate_int_  = 1.f / (float)interval;
+                have_rate_ = true;
+            }
+        }
+        if(have_rate_)
+            timeout_ = (uint32_t)(kTimeoutPulses * Period());
+
+        // a stopped MIDI clock still tracks the tempo
+        if(!running_)
+            return;
+
+        if(restart_ || !timed)
+        {
+            // beat 1: this pulse is P = 0 and steps now
+            restart_     = false;
+            pulse_index_ = 0;
+            pos_         = 0;
+            next_step_   = 0;
+            limit_       = kHalfPulse * 3;
+            Resynced();
+            return;
+        }
+        pulse_index_++;
+        limit_ = ((uint64_t)(pulse_index_ + 1) << 32) + kHalfPulse;
+
+        int64_t err_fx = (int64_t)(((uint64_t)pulse_index_ << 32) - pos_);
+        float   err    = (float)err_fx * (1.f / 4294967296.f);
+        if(err > 0.5f || err < -0.5f)
+        {
+            // Forward, P crosses at most one boundary and
+            // Tick() steps once; backward, next_step_ stays
+            // ahead so no step is taken twice.
+            pos_ = (uint64_t)pulse_index_ << 32;
+            if(timed)
+                rate_int_ = 1.f / (float)interval;
+            Resynced();
+            return;
+        }
+
+        float ph_us = err * Period() * 1e6f / sr_;
+        sum_phase_ += ph_us * ph_us;
+        n_phase_++;
+        if(fabsf(err) < 0.05f)
+            lock_count_ = lock_count_ < kLockPulses ? lock_count_ + 1
+                                                    : kLockPulses;
+        else
+            lock_count_ = 0;
+
+        rate_int_ += ki_ * err * rate_int_;
+        SetRate(rate_int_ * (1.f + kp_ * err));
+    }
+
+    // one sample; true on the sample of a step
+    inline bool Tick()
+    {
+        now_++;
+        if(!running_ || holding_ || restart_)
+            return false;
+        bool step = pos_ >= next_step_;
+        if(step)
+        {
+            next_step_ = NextBoundary(pos_);
+            if(step_timed_)
+            {
+                float dev = (float)(now_ - last_step_) - StepPeriod();
+                sum_out_ += dev * dev;
+                n_out_++;
+            }
+            last_step_  = now_;
+            step_timed_ = true;
+            win_steps_++;
+        }
+        pos_ += rate_;
+        if(pos_ > limit_)
+            pos_ = limit_;
+        // no pulse for a while: hold until the next one
+        if(have_rate_ && now_ - last_pulse_ > timeout_)
+        {
+            holding_    = true;
+            step_timed_ = false;
+            lock_count_ = 0;
+        }
+        return step;
+    }
+
+    bool Locked() const { return lock_count_ >= kLockPulses; }
+
+    // tracked pulse period in samples (0 before two pulses)
+    float Period() const { return have_rate_ ? 1.f / rate_int_ : 0.f; }
+    // MIDI tempo for 24 pulses per quarter
+    float Bpm() const
+    {
+        return have_rate_ ? rate_int_ * sr_ * 60.f / 24.f : 0.f;
+    }
+
+    JitterStats Stats() const
+    {
+        float       us = 1e6f / sr_;
+        JitterStats s;
+        s.pulses    = win_pulses_;
+        s.steps     = win_steps_;
+        s.in_us     = Rms(sum_in_, n_in_) * us;
+        s.out_us    = Rms(sum_out_, n_out_) * us;
+        s.phase_us  = Rms(sum_phase_, n_phase_);
+        s.period_us = Period() * us;
+        s.locked    = Locked();
+        return s;
+    }
+
+    void ResetStats()
+    {
+        win_pulses_ = win_steps_ = 0;
+        n_in_ = n_out_ = n_phase_ = 0;
+        sum_in_ = sum_out_ = sum_phase_ = 0.f;
+    }
+
+  private:
+    // after a jump in P: interval stats restart, the loop
+    // has to lock again
+    void Resynced()
+    {
+        step_timed_ = false;
+        lock_count_ = 0;
+        SetRate(have_rate_ ? rate_int_ : 0.f);
+    }
+
+    float StepPeriod() const
+    {
+        return Period() * (float)pulses_ / (float)steps_;
+    }
+
+    void SetRate(float pulses_per_sample)
+    {
+        float r = pulses_per_sample * 4294967296.f;
+        rate_   = r > 0.f ? (uint64_t)r : 0;
+    }
+
+    uint64_t NextBoundary(uint64_t pos) const
+    {
+        return (pos / step_len_ + 1) * step_len_;
+    }
+
+    static float Rms(float sum, uint32_t n)
+    {
+        return n > 0 ? sqrtf(sum / (float)n) : 0.f;
+    }
+
+    float    sr_, kp_, ki_;
+    uint32_t steps_, pulses_;
+    uint64_t step_len_;  // 32.32 pulses per step
+    uint64_t pos_;       // 32.32 pulses since beat 1
+    uint64_t next_step_; // boundary of the next step
+    uint64_t limit_;     // P stops here without a pulse
+    uint64_t rate_;      // 32.32 pulses per sample
+    float    rate_int_;  // integrator, pulses per sample
+    uint32_t now_, last_pulse_, last_step_, pulse_index_;
+    uint32_t timeout_; // samples without a pulse before holding
+    bool     have_pulse_, have_rate_, running_, holding_, restart_;
+    bool     step_timed_; // last_step_ valid for the stats
+    uint32_t lock_count_;
+    uint32_t win_pulses_, win_steps_;
+    uint32_t n_in_, n_out_, n_phase_;
+    float    sum_in_, sum_out_, sum_phase_;
+};
+
+} // namespace daisyex
+
+#endif
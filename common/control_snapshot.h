@@ -0,0 +1,103 @@
+/**********************************************************
+   control_snapshot.h
+   Once-per-block control acquisition with a lock-free,
+   double-buffered snapshot
+
+   The audio callback is the only place that processes the
+   analog controls (their filters must run exactly once per
+   block). It publishes what it read into a Snapshot<T>;
+   any other context (main loop, OLED, timer ISR) calls
+   Read() and gets a consistent copy of the whole set
+   instead of racing the filters with its own Process().
+
+   Snapshot<T> is a seqlock over two buffers: the writer
+   fills the buffer readers are not using and bumps the
+   sequence (odd while writing). A reader only retries if
+   the writer published twice during its copy, which on
+   the Daisy means being preempted for a whole audio block.
+**********************************************************/
+#pragma once
+#ifndef DAISYEX_CONTROL_SNAPSHOT_H
+#define DAISYEX_CONTROL_SNAPSHOT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+namespace daisyex
+{
+// T must be trivially copyable
+template <typename T>
+class Snapshot
+{
+  public:
+    Snapshot() : seq_(0), retries_(0) { buf_[0] = buf_[1] = T(); }
+
+    // single writer
+    void Publish(const T &value)
+    {
+        uint32_t seq  = seq_.load(std::memory_order_relaxed);
+        T &      next = buf_[((seq >> 1) + 1) & 1];
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        next = value;
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    // any context, never blocks the writer
+    T Read() const
+    {
+        T value;
+        while(1)
+        {
+            uint32_t seq = seq_.load(std::memory_order_acquire);
+            value        = buf_[(seq >> 1) & 1];
+            std::atomic_thread_fence(std::memory_order_acquire);
+            // the buffer we copied is rewritten from seq + 3 on
+            if(seq_.load(std::memory_order_relaxed) - (seq & ~1u) <= 2)
+                return value;
+            retries_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // number of snapshots published
+    uint32_t Version() const
+    {
+        return seq_.load(std::memory_order_acquire) >> 1;
+    }
+    uint32_t Retries() const
+    {
+        return retries_.load(std::memory_order_relaxed);
+    }
+
+  private:
+    T                             buf_[2];
+    std::atomic<uint32_t>         seq_;
+    mutable std::atomic<uint32_t> retries_;
+};
+
+// ----------------------------------------------------
+// Daisy Patch knobs (knob + CV in) and gate inputs
+// ----------------------------------------------------
+struct PatchControls
+{
+    float    knob[4]; // 0..1, filtered
+    bool     gate[2];
+    uint32_t block; // audio block it was taken in
+};
+
+// Call once per audio block; Hw is DaisyPatch
+template <typename Hw>
+inline void AcquirePatchControls(Hw &hw, uint32_t block, PatchControls &c)
+{
+    hw.ProcessAnalogControls();
+    for(size_t i = 0; i < 4; i++)
+        c.knob[i] = hw.controls[i].Value();
+    for(size_t i = 0; i < 2; i++)
+        c.gate[i] = hw.gate_input[i].State();
+    c.block = block;
+}
+
+} // namespace daisyex
+
+#endif
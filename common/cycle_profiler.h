@@ -0,0 +1,267 @@
+/**********************************************************
+   cycle_profiler.h
+   Cycle counts for the audio callback and named sections
+   inside it
+
+   CycleCount() reads the Cortex-M7 DWT cycle counter
+   (EnableCycleCounter() once at startup). On hosts it
+   falls back to rdtsc on x86 and std::chrono nanoseconds
+   elsewhere, so the same instrumentation runs in the host
+   tools.
+
+   CycleProfiler keeps min/avg/max/last per section and a
+   histogram of whole-callback load in percent of the
+   block deadline:
+
+       g_prof.Init(System::GetSysClkFreq(), sr, blocksize);
+       ...
+       g_prof.BeginCallback();
+       g_prof.Begin(kSecFbm);  ...  g_prof.End(kSecFbm);
+       g_prof.EndCallback();
+
+   Begin/End are a counter read and a few adds; Report()
+   formats lines for the OLED or the Logger (USB CDC) with
+   fixed_format.h, no float printf.
+
+   Sections whose work scales with the block (the
+   per-sample loops) are added with per_sample = true;
+   everything else in the callback is per-block overhead,
+   and OverheadPercent() is its share of the callback's
+   cycles. That share is what a smaller block costs
+   (audio_profile.h reports it per sample rate / block
+   size).
+**********************************************************/
+#pragma once
+#ifndef DAISYEX_CYCLE_PROFILER_H
+#define DAISYEX_CYCLE_PROFILER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "fixed_format.h"
+#include "latency_histogram.h"
+
+#if !defined(__arm__)
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+#endif
+
+namespace daisyex
+{
+// ----------------------------------------------------
+// Cycle counter
+// ----------------------------------------------------
+#if defined(__arm__)
+inline void EnableCycleCounter()
+{
+    volatile uint32_t *demcr    = (volatile uint32_t *)0xE000EDFCu;
+    volatile uint32_t *dwt_ctrl = (volatile uint32_t *)0xE0001000u;
+    volatile uint32_t *dwt_cyc  = (volatile uint32_t *)0xE0001004u;
+    volatile uint32_t *dwt_lar  = (volatile uint32_t *)0xE0001FB0u;
+    *demcr |= 1u << 24;     // TRCENA
+    *dwt_lar = 0xC5ACCE55u; // unlock (M7)
+    *dwt_cyc = 0;
+    *dwt_ctrl |= 1u; // CYCCNTENA
+}
+inline uint32_t CycleCount()
+{
+    return *(volatile uint32_t *)0xE0001004u;
+}
+#elif defined(__x86_64__) || defined(__i386__)
+inline void     EnableCycleCounter() {}
+inline uint32_t CycleCount()
+{
+    return (uint32_t)__rdtsc();
+}
+#else
+inline void     EnableCycleCounter() {}
+inline uint32_t CycleCount()
+{
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+#endif
+
+// ----------------------------------------------------
+// Profiler
+// ----------------------------------------------------
+template <size_t MaxSections, size_t LoadBins = 24>
+class CycleProfiler
+{
+  public:
+    struct SectionStats
+    {
+        const char *name;
+        uint32_t    count;
+        uint32_t    min, max, last;
+        uint64_t    total;
+        bool        per_sample;
+    };
+
+    // cpu_hz: counter rate; the deadline is one block
+    void Init(uint32_t cpu_hz, float samplerate, size_t blocksize)
+    {
+        EnableCycleCounter();
+        budget_ = (uint32_t)((float)cpu_hz * (float)blocksize / samplerate);
+        // 5% per bin, the last bin collects overruns
+        load_.Init(5);
+        num_ = 0;
+        AddSection("callback");
+        Reset();
+    }
+
+    // returns the section id (0 is the whole callback)
+    int AddSection(const char *name, bool per_sample = false)
+    {
+        if(num_ >= MaxSections)
+            return -1;
+        stats_[num_].name       = name;
+        stats_[num_].per_sample = per_sample;
+        ResetSection(num_);
+        return (int)num_++;
+    }
+
+    // may be called from the main loop; applied at the
+    // start of the next callback
+    void RequestReset() { reset_ = true; }
+
+    void BeginCallback()
+    {
+        if(reset_)
+            Reset();
+        start_[0] = CycleCount();
+    }
+    void EndCallback()
+    {
+        uint32_t c = Record(0);
+        load_.Record(budget_ ? (uint32_t)((uint64_t)c * 100 / budget_) : 0);
+    }
+
+    void Begin(int id) { start_[id] = CycleCount(); }
+    void End(int id) { Record(id); }
+
+    size_t              NumSections() const { return num_; }
+    const SectionStats &Stats(int id) const { return stats_[id]; }
+    uint32_t            BudgetCycles() const { return budget_; }
+
+    uint32_t AvgCycles(int id) const
+    {
+        const SectionStats &s = stats_[id];
+        return s.count ? (uint32_t)(s.total / s.count) : 0;
+    }
+
+    // percent of the block deadline
+    uint32_t LoadPercent(uint32_t cycles) const
+    {
+        return budget_ ? (uint32_t)((uint64_t)cycles * 100 / budget_) : 0;
+    }
+    uint32_t AvgLoad() const { return LoadPercent(AvgCycles(0)); }
+    uint32_t MaxLoad() const { return LoadPercent(stats_[0].max); }
+    // deadline left at the worst callback
+    uint32_t Headroom() const
+    {
+        uint32_t max = MaxLoad();
+        return max < 100 ? 100 - max : 0;
+    }
+
+    // percent of the callback's cycles outside the
+    // per-sample sections
+    uint32_t OverheadPercent() const
+    {
+        uint64_t per_sample = 0;
+        for(size_t i = 1; i < num_; i++)
+            if(stats_[i].per_sample)
+                per_sample += stats_[i].total;
+        uint64_t total = stats_[0].total;
+        if(total == 0)
+            return 0;
+        if(per_sample > total)
+            per_sample = total;
+        return (uint32_t)((total - per_sample) * 100 / total);
+    }
+
+    // callback load histogram, 5% per bin
+    const LatencyHistogram<LoadBins> &LoadHistogram() const { return load_; }
+
+    // One line per section, then the load histogram;
+    // print(const char *line) is called for each line.
+    template <typename PrintFn>
+    void Report(PrintFn print) const
+    {
+        char line[64];
+        for(size_t i = 0; i < num_; i++)
+        {
+            const SectionStats &s = stats_[i];
+            TextWriter(line, sizeof(line))
+                .Str(s.name)
+                .Str(" min ")
+                .Uint(s.count ? s.min : 0)
+                .Str(" avg ")
+                .Uint(AvgCycles((int)i))
+                .Str(" max ")
+                .Uint(s.max)
+                .Str(" avg% ")
+                .Uint(LoadPercent(AvgCycles((int)i)));
+            print(line);
+        }
+        for(size_t b = 0; b < LoadBins; b++)
+        {
+            if(load_.Bin(b) == 0)
+                continue;
+            TextWriter w(line, sizeof(line));
+            w.Str("load ").Uint(b * 5);
+            if(b + 1 < LoadBins)
+                w.Str("-").Uint(b * 5 + 5).Str("%: ");
+            else
+                w.Str("%+: ");
+            w.Uint(load_.Bin(b));
+            print(line);
+        }
+    }
+
+  private:
+    uint32_t Record(int id)
+    {
+        uint32_t      c = CycleCount() - start_[id];
+        SectionStats &s = stats_[id];
+        s.count++;
+        s.total += c;
+        s.last = c;
+        if(c < s.min)
+            s.min = c;
+        if(c > s.max)
+            s.max = c;
+        return c;
+    }
+
+    void ResetSection(size_t i)
+    {
+        stats_[i].count = 0;
+        stats_[i].min   = 0xFFFFFFFFu;
+        stats_[i].max   = 0;
+        stats_[i].last  = 0;
+        stats_[i].total = 0;
+    }
+
+    void Reset()
+    {
+        for(size_t i = 0; i < num_; i++)
+            ResetSection(i);
+        load_.Reset();
+        reset_ = false;
+    }
+
+    SectionStats               stats_[MaxSections];
+    uint32_t                   start_[MaxSections];
+    size_t                     num_;
+    uint32_t                   budget_;
+    LatencyHistogram<LoadBins> load_;
+    volatile bool              reset_;
+};
+
+} // namespace daisyex
+
+#endif
@@ -0,0 +1,189 @@
+/**********************************************************
+   event_queue.h
+   Timestamped MIDI events from the main loop (or an ISR)
+   to the audio callback
+
+   - SpscQueue: wait-free single-producer/single-consumer
+     ring buffer. Push never blocks; a full queue drops the
+     event and counts it.
+   - NoteEvent also carries MIDI clock/transport and
+     clock edges seen on a gate input, so clock pulses
+     get the same sample-accurate placement as notes.
+   - BlockEvents: drained by the audio callback at the
+     start of a block. Each event's arrival time (us) is
+     mapped to a sample offset inside the block, measured
+     from the start of the previous callback. That adds one
+     fixed block of latency but keeps the spacing between
+     events sample-accurate instead of snapping them all to
+     the block boundary.
+**********************************************************/
+#pragma once
+#ifndef DAISYEX_EVENT_QUEUE_H
+#define DAISYEX_EVENT_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+namespace daisyex
+{
+struct NoteEvent
+{
+    enum Type : uint8_t
+    {
+        NOTE_ON,
+        NOTE_OFF,
+        CC,
+        CLOCK,      // MIDI 0xF8
+        START,      // MIDI 0xFA
+        CONTINUE,   // MIDI 0xFB
+        STOP,       // MIDI 0xFC
+        GATE_CLOCK, // rising edge on a gate input
+    };
+    Type     type;
+    uint8_t  channel;
+    uint8_t  data0;   // note or controller number
+    uint8_t  data1;   // velocity or controller value
+    uint32_t time_us; // arrival time, System::GetUs()
+};
+
+// N must be a power of two
+template <typename T, size_t N>
+class SpscQueue
+{
+    static_assert((N & (N - 1)) == 0, "SpscQueue size must be a power of 2");
+
+  public:
+    SpscQueue() : head_(0), tail_(0), dropped_(0) {}
+
+    // producer side
+    bool Push(const T &item)
+    {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        uint32_t tail = tail_.load(std::memory_order_acquire);
+        if(head - tail >= N)
+        {
+            dropped_++;
+            return false;
+        }
+        buf_[head & (N - 1)] = item;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side
+    bool Pop(T &item)
+    {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        uint32_t head = head_.load(std::memory_order_acquire);
+        if(tail == head)
+            return false;
+        item = buf_[tail & (N - 1)];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool Empty() const
+    {
+        return head_.load(std::memory_order_acquire)
+               == tail_.load(std::memory_order_acquire);
+    }
+
+    // only written by the producer
+    uint32_t Dropped() const { return dropped_; }
+
+  private:
+    T                     buf_[N];
+    std::atomic<uint32_t> head_;
+    std::atomic<uint32_t> tail_;
+    uint32_t              dropped_;
+};
+
+// ----------------------------------------------------
+// Per-block event list for the audio callback
+// ----------------------------------------------------
+template <size_t MaxEvents>
+class BlockEvents
+{
+  public:
+    void Init(float samplerate)
+    {
+        samples_per_us_ = samplerate * 1.0e-6f;
+        prev_us_        = 0;
+        cur_us_         = 0;
+        started_        = false;
+        count_          = 0;
+        next_           = 0;
+    }
+
+    // Call first thing in the audio callback with
+    // System::GetUs(), then Collect().
+    void BeginBlock(uint32_t now_us)
+    {
+        prev_us_ = started_ ? cur_us_ : now_us;
+        cur_us_  = now_us;
+        started_ = true;
+        count_   = 0;
+        next_    = 0;
+    }
+
+    // Drain the queue; events are in arrival order so the
+    // offsets come out non-decreasing. Anything beyond
+    // MaxEvents stays queued for the next block.
+    template <typename Queue>
+    void Collect(Queue &q, size_t blocksize)
+    {
+        while(count_ < MaxEvents && q.Pop(ev_[count_]))
+        {
+            offset_[count_] = OffsetOf(ev_[count_].time_us, blocksize);
+            count_++;
+        }
+    }
+
+    // Next event due at or before sample i of this block
+    bool Due(size_t i, NoteEvent &ev)
+    {
+        if(next_ >= count_ || offset_[next_] > i)
+            return false;
+        ev = ev_[next_++];
+        return true;
+    }
+
+    size_t Count() const { return count_; }
+
+    // sample offset of an arrival time within this block
+    size_t OffsetOf(uint32_t time_us, size_t blocksize) const
+    {
+        int32_t dt = (int32_t)(time_us - prev_us_);
+        if(dt <= 0)
+            return 0;
+        size_t off = (size_t)((float)dt * samples_per_us_);
+        return off < blocksize ? off : blocksize - 1;
+    }
+
+    // start time of the block the offsets are measured from
+    uint32_t ReferenceUs() const { return prev_us_; }
+
+    // Arrival => sound time for an event applied at 'offset'.
+    // The buffer filled now starts playing one block after
+    // this callback started.
+    uint32_t LatencyUs(const NoteEvent &ev,
+                       size_t           offset,
+                       size_t           blocksize) const
+    {
+        float out_us = (float)(offset + blocksize) / samples_per_us_;
+        return cur_us_ + (uint32_t)out_us - ev.time_us;
+    }
+
+  private:
+    NoteEvent ev_[MaxEvents];
+    size_t    offset_[MaxEvents];
+    size_t    count_, next_;
+    float     samples_per_us_;
+    uint32_t  prev_us_, cur_us_;
+    bool      started_;
+};
+
+} // namespace daisyex
+
+#endif
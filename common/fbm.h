@@ -0,0 +1,139 @@
+/***************************************************************
+   fbm.h
+   1D Perlin noise + fBm shared by patch and pod FractalZoom
+
+   - FractalNoise1D keeps its own 512-entry permutation table
+     (the reference Perlin permutation, duplicated)
+   - Noise()  => PerlinNoise1D, range ~[-1..1]
+   - FBm()    => fBm1D, sum of octaves
+   - FBmBatch() evaluates many domains in one call. The octave
+     loop is outside the voice loop so freq/amp are computed
+     once per octave and the inner loop runs without
+     dependencies between voices.
+   - The three run from ITCM in TCM=1/3 builds (tcm.h); tag
+     the FractalNoise1D object DAISYEX_DTCM to keep perm_ in
+     DTCM as well.
+***************************************************************/
+#pragma once
+#ifndef DAISYEX_FBM_H
+#define DAISYEX_FBM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include "tcm.h"
+
+namespace daisyex
+{
+// A standard reference permutation for 256 values:
+static const uint8_t kPermRef[256] = {
+    151,160,137,91,90,15,131,13,201,95,96,53,194,233,7,225,
+    140,36,103,30,69,142,8,99,37,240,21,10,23,190, 6,148,
+    247,120,234,75, 0,26,197,62,94,252,219,203,117,35,11,32,
+    57,177,33, 88,237,149,56,87,174,20,125,136,171,168, 68,
+    175, 74,165,71,134,139,48,27,166,77,146,158,231, 83,111,
+    229,122,60,211,133,230,220,105,92,41,55,46,245,40,244,
+    102,143,54, 65,25,63,161, 1,216,80,73,209,76,132,187,
+    208, 89,18,169,200,196,135,130,116,188,159,86,164,100,
+    109,198,173,186, 3,64,52,217,226,250,124,123, 5,202,
+    38,147,118,126,255,82,85,212,207,206,59,227,47,16,58,
+    17,182,189,28,42,223,183,170,213,119,248,152,  2,44,
+    154,163,70,221,153,101,155,167, 43,172,  9,129,22,39,
+    253,19, 98,108,110,79,113,224,232,178,185,112,104,218,
+    246,97,228,251,34,242,193,238,210,144,12,191,179,162,
+    241,81,51,145,235,249,14,239,107, 49,192,214,31,181,
+    199,106,157,184,84,204,176,115,121, 50,45,127,  4,
+    150,254,138,236,205,93,222,114,67,29,24,72,243,141,
+    128,195,78,66,215
+};
+
+class FractalNoise1D
+{
+  public:
+    void Init()
+    {
+        // Duplicate kPermRef[] in perm_[] 2x
+        for(int i = 0; i < 256; i++)
+        {
+            perm_[i]       = kPermRef[i];
+            perm_[i + 256] = kPermRef[i];
+        }
+    }
+
+    // Fade function: 6t^5 - 15t^4 + 10t^3
+    static inline float Fade(float t)
+    {
+        return t * t * t * (t * (t * 6.f - 15.f) + 10.f);
+    }
+
+    // We only need a 1D gradient => sign flip
+    static inline float Grad1D(int hash, float x)
+    {
+        // If (hash & 1) => +x else => -x
+        return ((hash & 1) ? x : -x);
+    }
+
+    // Return noise in range ~[-1..1]
+    DAISYEX_ITCM inline float Noise(float x) const
+    {
+        int   xi = (int)floorf(x);
+        float xf = x - (float)xi;
+        int   X  = xi & 255;
+
+        float u = Fade(xf);
+
+        int hashA = perm_[X];
+        int hashB = perm_[X + 1];
+
+        float g1 = Grad1D(hashA, xf);
+        float g2 = Grad1D(hashB, xf - 1.f);
+
+        return (1.f - u) * g1 + u * g2;
+    }
+
+    // Simple fBm with ~4..7 octaves typical
+    DAISYEX_ITCM float
+    FBm(float x, int octaves, float lacunarity, float gain) const
+    {
+        float sum  = 0.f;
+        float freq = 1.f;
+        float amp  = 1.f;
+
+        for(int i = 0; i < octaves; i++)
+        {
+            sum += Noise(x * freq) * amp;
+            freq *= lacunarity;
+            amp *= gain;
+        }
+        return sum;
+    }
+
+    // out[i] = FBm(x[i], ...) for i in [0..n)
+    DAISYEX_ITCM void FBmBatch(const float *x,
+                               float *      out,
+                               size_t       n,
+                               int          octaves,
+                               float        lacunarity,
+                               float        gain) const
+    {
+        for(size_t i = 0; i < n; i++)
+            out[i] = 0.f;
+
+        float freq = 1.f;
+        float amp  = 1.f;
+        for(int o = 0; o < octaves; o++)
+        {
+            for(size_t i = 0; i < n; i++)
+                out[i] += Noise(x[i] * freq) * amp;
+            freq *= lacunarity;
+            amp *= gain;
+        }
+    }
+
+  private:
+    uint8_t perm_[512];
+};
+
+} // namespace daisyex
+
+#endif
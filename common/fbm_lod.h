@@ -0,0 +1,176 @@
+/***************************************************************
+   fbm_lod.h
+   Level-of-detail fBm for a curve sampled at a fixed step
+
+   FractalNoise1D::FBm sums a fixed number of octaves. When
+   the curve is only read every 'step' units of x (pod
+   FractalZoom: zoom / eval rate), octave k moves
+   step * lacunarity^k lattice cells between two reads:
+     - above one cell per step it is a fresh random number
+       at every read. It only adds aliasing, so it is left
+       out. The cutoff octave fades in and out as the step
+       changes (no pops while zooming).
+     - far below the cutoff it barely moves between reads,
+       so it does not have to be recomputed on every read.
+
+   FbmLod computes only a window of 'window' octaves under
+   the cutoff on each Eval(). The octaves below the window
+   are cached and refreshed one per Eval in a ruler
+   sequence: the first one below the window every 2nd
+   read, the next every 4th, and so on. Each of them then
+   lags by at most lacunarity^-window cells. So a read
+   costs at most window + 1 Noise() calls at any step,
+   however deep the zoom goes.
+
+       FbmLod lod;
+       lod.Init(noise, 7, 4, 2.f, .5f); // octaves, window
+       ...
+       lod.SetStep(zoom / rate);        // x units per read
+       y = lod.Eval(x);
+
+   A jump in x (a loop wrap) larger than a quarter cell of
+   the fastest cached octave refreshes the whole cache on
+   that read. The sum is not renormalized: octaves left
+   out count as 0, as in FBm. With step 0 and window >=
+   octaves, Eval(x) == FBm(x, octaves, lacunarity, gain).
+   Eval() keeps state, so use one FbmLod per curve.
+***************************************************************/
+#pragma once
+#ifndef DAISYEX_FBM_LOD_H
+#define DAISYEX_FBM_LOD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include "fbm.h"
+#include "tcm.h"
+
+namespace daisyex
+{
+class FbmLod
+{
+  public:
+    // x * lacunarity^k loses the fraction in a float above
+    // about this many octaves
+    static const int kMaxOctaves = 16;
+
+    // lacunarity > 1; octaves 1..kMaxOctaves, window >= 1
+    void Init(const FractalNoise1D &noise,
+              int                   octaves,
+              int                   window,
+              float                 lacunarity,
+              float                 gain)
+    {
+        noise_   = &noise;
+        octaves_ = octaves < 1             ? 1
+                   : octaves > kMaxOctaves ? kMaxOctaves
+                                           : octaves;
+        window_  = window < 1 ? 1 : window;
+        inv_log_lac_ = 1.f / logf(lacunarity);
+
+        float freq = 1.f;
+        float amp  = 1.f;
+        for(int k = 0; k < octaves_; k++)
+        {
+            freq_[k]  = freq;
+            amp_[k]   = amp;
+            cache_[k] = 0.f;
+            freq *= lacunarity;
+            amp *= gain;
+        }
+        cutoff_  = (float)octaves_;
+        last_x_  = 0.f;
+        last_hi_ = 0;
+        count_   = 0;
+    }
+
+    // Distance in x between two reads; 0 keeps every octave
+    void SetStep(float step)
+    {
+        float c = (float)octaves_;
+        if(step > 0.f)
+        {
+            // the octave that moves one cell per step
+            c = -logf(step) * inv_log_lac_;
+            if(c < 1.f)
+                c = 1.f; // octave 0 always plays
+            if(c > (float)octaves_)
+                c = (float)octaves_;
+        }
+        cutoff_ = c;
+    }
+
+    DAISYEX_ITCM float Eval(float x)
+    {
+        float c  = cutoff_;
+        int   hi = (int)ceilf(c);                   // octaves [0, hi)
+        int   lo = hi > window_ ? hi - window_ : 0; // [0, lo) cached
+
+        if(lo > 0)
+        {
+            // the cache is good if the last read covered it
+            // and x moved on by a step, not a jump
+            float drift = fabsf(x - last_x_) * freq_[lo - 1];
+            if(lo > last_hi_ || drift > 0.25f)
+            {
+                for(int k = 0; k < lo; k++)
+                    cache_[k] = Octave(x, k);
+                count_ = 0;
+            }
+            else
+            {
+                // ruler sequence: octave lo-1 on odd counts,
+                // lo-2 on 2 mod 4, lo-3 on 4 mod 8, ...
+                uint32_t n = ++count_;
+                int      k = lo - 1;
+                while(k >= 0 && !(n & 1))
+                {
+                    n >>= 1;
+                    k--;
+                }
+                if(k >= 0)
+                    cache_[k] = Octave(x, k);
+            }
+        }
+
+        float sum = 0.f;
+        for(int k = 0; k < lo; k++)
+            sum += cache_[k];
+        for(int k = lo; k < hi - 1; k++)
+        {
+            cache_[k] = Octave(x, k);
+            sum += cache_[k];
+        }
+        // the cutoff octave, faded by how far it is in
+        cache_[hi - 1] = Octave(x, hi - 1);
+        sum += cache_[hi - 1] * (c - (float)(hi - 1));
+
+        last_x_  = x;
+        last_hi_ = hi;
+        return sum;
+    }
+
+    // octaves in the sum at the current step (the top one
+    // possibly faded)
+    int Octaves() const { return (int)ceilf(cutoff_); }
+
+  private:
+    float Octave(float x, int k) const
+    {
+        return noise_->Noise(x * freq_[k]) * amp_[k];
+    }
+
+    const FractalNoise1D *noise_;
+    int                   octaves_, window_;
+    float                 inv_log_lac_;
+    float                 freq_[kMaxOctaves], amp_[kMaxOctaves];
+    float                 cache_[kMaxOctaves]; // octave values at their last read
+    float                 cutoff_;             // in octaves, [1, octaves_]
+    float                 last_x_;
+    int                   last_hi_;
+    uint32_t              count_; // reads since the last full refresh
+};
+
+} // namespace daisyex
+
+#endif
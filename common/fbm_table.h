@@ -0,0 +1,210 @@
+/***************************************************************
+   fbm_table.h
+   fBm baked into a table for fixed octaves/lacunarity/gain
+
+   With an integer lacunarity every octave of
+   FractalNoise1D::FBm repeats within the 256-unit
+   permutation period, so for fixed settings the whole
+   curve is one periodic function of x. The table holds
+   its value and slope at 'per_unit' points per unit over
+   that period; Eval() is a cubic Hermite between the two
+   neighbours (one 16-byte read) instead of one Noise()
+   per octave.
+
+   Image layout (little endian, what utils/host/fbm_bake
+   writes and the app maps from QSPI):
+       FbmTableHeader
+       float pairs {value, slope} for i in [0, n], the last
+       one a copy of the first so Eval() never wraps
+
+       FbmTable table;
+       if(table.Init((const void *)0x90400000, 5, 2.f, .5f))
+           y = table.Eval(x);
+
+   Init() checks the settings and a CRC of the data, so a
+   missing or stale image is refused rather than played.
+***************************************************************/
+#pragma once
+#ifndef DAISYEX_FBM_TABLE_H
+#define DAISYEX_FBM_TABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include "fbm.h"
+
+namespace daisyex
+{
+static const uint32_t kFbmTableMagic   = 0x4d424646u; // "FFBM"
+static const uint32_t kFbmTableVersion = 1;
+
+struct FbmTableHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    int32_t  octaves;
+    float    lacunarity;
+    float    gain;
+    uint32_t units;    // period, 256
+    uint32_t per_unit; // entries per unit, power of 2
+    uint32_t crc;      // CRC-32 of the entries
+};
+
+inline uint32_t Crc32(const void *data, size_t bytes, uint32_t crc = 0)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    crc              = ~crc;
+    for(size_t i = 0; i < bytes; i++)
+    {
+        crc ^= p[i];
+        for(int b = 0; b < 8; b++)
+            crc = (crc >> 1) ^ (0xedb88320u & (0u - (crc & 1u)));
+    }
+    return ~crc;
+}
+
+class FbmTable
+{
+  public:
+    FbmTable() : entries_(nullptr) {}
+
+    // image: header + entries; false if it isn't a table
+    // for these settings (or fails its CRC)
+    bool Init(const void *image, int octaves, float lacunarity, float gain)
+    {
+        entries_                 = nullptr;
+        const FbmTableHeader *h  = (const FbmTableHeader *)image;
+        uint32_t              n  = h->units * h->per_unit;
+        const float *         fp = (const float *)(h + 1);
+        if(h->magic != kFbmTableMagic || h->version != kFbmTableVersion
+           || h->octaves != octaves || h->lacunarity != lacunarity
+           || h->gain != gain || h->units != 256 || h->per_unit == 0
+           || (h->per_unit & (h->per_unit - 1)) != 0)
+            return false;
+        if(Crc32(fp, (n + 1) * 2 * sizeof(float)) != h->crc)
+            return false;
+        header_  = *h;
+        entries_ = fp;
+        scale_   = (float)h->per_unit;
+        mask_    = n - 1;
+        step_    = 1.f / scale_;
+        return true;
+    }
+
+    bool Valid() const { return entries_ != nullptr; }
+    bool Matches(int octaves, float lacunarity, float gain) const
+    {
+        return entries_ && header_.octaves == octaves
+               && header_.lacunarity == lacunarity && header_.gain == gain;
+    }
+
+    inline float Eval(float x) const
+    {
+        float        t  = x * scale_;
+        float        fi = floorf(t);
+        float        f  = t - fi;
+        uint32_t     i  = (uint32_t)(int32_t)fi & mask_;
+        const float *e  = entries_ + 2 * i; // v0 d0 v1 d1
+        // cubic Hermite, slopes scaled to the step
+        float f2  = f * f;
+        float f3  = f2 * f;
+        float h01 = 3.f * f2 - 2.f * f3;
+        float h10 = f3 - 2.f * f2 + f;
+        float h11 = f3 - f2;
+        return e[0] + (e[2] - e[0]) * h01
+               + (e[1] * h10 + e[3] * h11) * step_;
+    }
+
+    void EvalBatch(const float *x, float *out, size_t n) const
+    {
+        for(size_t i = 0; i < n; i++)
+            out[i] = Eval(x[i]);
+    }
+
+    const FbmTableHeader &Header() const { return header_; }
+
+  private:
+    FbmTableHeader header_;
+    const float *  entries_;
+    float          scale_, step_;
+    uint32_t       mask_;
+};
+
+// ----------------------------------------------------
+// Baking (host side: utils/host/fbm_bake.cpp, benches)
+// ----------------------------------------------------
+
+// FractalNoise1D::FBm and its slope, in double
+inline void FBmWithSlope(const uint8_t *perm512,
+                         double         x,
+                         int            octaves,
+                         double         lacunarity,
+                         double         gain,
+                         double &       value,
+                         double &       slope)
+{
+    double freq = 1.0, amp = 1.0;
+    value = slope = 0.0;
+    for(int o = 0; o < octaves; o++)
+    {
+        double xs = x * freq;
+        double xi = floor(xs);
+        double xf = xs - xi;
+        int    X  = (int)((int64_t)xi & 255);
+        double s1 = (perm512[X] & 1) ? 1.0 : -1.0;
+        double s2 = (perm512[X + 1] & 1) ? 1.0 : -1.0;
+        double g1 = s1 * xf, g2 = s2 * (xf - 1.0);
+        double u  = xf * xf * xf * (xf * (xf * 6.0 - 15.0) + 10.0);
+        double du = 30.0 * xf * xf * (xf - 1.0) * (xf - 1.0);
+        value += amp * ((1.0 - u) * g1 + u * g2);
+        slope += amp * freq * (du * (g2 - g1) + (1.0 - u) * s1 + u * s2);
+        freq *= lacunarity;
+        amp *= gain;
+    }
+}
+
+// Fill 'out' ((units * per_unit + 1) * 2 floats) and the
+// header. Integer lacunarity only: others don't repeat.
+inline bool BakeFbmTable(FbmTableHeader &h,
+                         float *         out,
+                         uint32_t        per_unit,
+                         int             octaves,
+                         float           lacunarity,
+                         float           gain)
+{
+    if(lacunarity != floorf(lacunarity) || lacunarity < 1.f || per_unit == 0
+       || (per_unit & (per_unit - 1)) != 0)
+        return false;
+    uint8_t perm[512];
+    for(int i = 0; i < 512; i++)
+        perm[i] = kPermRef[i & 255];
+
+    const uint32_t units = 256;
+    uint32_t       n     = units * per_unit;
+    for(uint32_t i = 0; i <= n; i++)
+    {
+        double v, d;
+        FBmWithSlope(perm,
+                     (double)(i % n) / per_unit,
+                     octaves,
+                     lacunarity,
+                     gain,
+                     v,
+                     d);
+        out[2 * i]     = (float)v;
+        out[2 * i + 1] = (float)d;
+    }
+    h.magic      = kFbmTableMagic;
+    h.version    = kFbmTableVersion;
+    h.octaves    = octaves;
+    h.lacunarity = lacunarity;
+    h.gain       = gain;
+    h.units      = units;
+    h.per_unit   = per_unit;
+    h.crc        = Crc32(out, (n + 1) * 2 * sizeof(float));
+    return true;
+}
+
+} // namespace daisyex
+
+#endif
@@ -0,0 +1,195 @@
+/**********************************************************
+   fixed_format.h
+   Float-printf-free number formatting for the UI
+
+   newlib-nano's printf has no %f unless the firmware is
+   linked with -u _printf_float, which pulls in a large part
+   of the soft-float/dtoa code; the formatting itself is
+   slow on the M7 as well. TextWriter formats into a caller
+   buffer with integer arithmetic only:
+
+       char buf[16];
+       TextWriter(buf, sizeof(buf)).Str("In: ").Volts(v);
+
+   Fixed(v, d) gives the same text as printf("%.<d>f", v)
+   for |v| < 2^43 (round half to even on the exact binary
+   value, "-0.00" for small negatives, inf/nan), checked
+   against snprintf in utils/bench/format_bench.cpp.
+
+   Output is always NUL-terminated; when the buffer is too
+   small it's truncated like snprintf.
+**********************************************************/
+#pragma once
+#ifndef DAISYEX_FIXED_FORMAT_H
+#define DAISYEX_FIXED_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+namespace daisyex
+{
+class TextWriter
+{
+  public:
+    static const int kMaxDecimals = 6;
+
+    TextWriter(char *buf, size_t size) : buf_(buf), size_(size), len_(0)
+    {
+        if(size_ > 0)
+            buf_[0] = 0;
+    }
+
+    TextWriter &Char(char c)
+    {
+        if(len_ + 1 < size_)
+        {
+            buf_[len_++] = c;
+            buf_[len_]   = 0;
+        }
+        return *this;
+    }
+
+    TextWriter &Str(const char *s)
+    {
+        while(*s)
+            Char(*s++);
+        return *this;
+    }
+
+    TextWriter &Uint(uint64_t v)
+    {
+        char   tmp[20];
+        size_t n = 0;
+        // 32-bit divides where possible (no __aeabi_uldivmod)
+        while(v > 0xFFFFFFFFu)
+        {
+            tmp[n++] = (char)('0' + v % 10);
+            v /= 10;
+        }
+        uint32_t v32 = (uint32_t)v;
+        do
+        {
+            tmp[n++] = (char)('0' + v32 % 10);
+            v32 /= 10;
+        } while(v32);
+        while(n)
+            Char(tmp[--n]);
+        return *this;
+    }
+
+    TextWriter &Int(int32_t v)
+    {
+        if(v < 0)
+        {
+            Char('-');
+            return Uint((uint64_t)(-(int64_t)v));
+        }
+        return Uint((uint64_t)v);
+    }
+
+    // printf("%.<decimals>f"), or "%+.<decimals>f" with plus
+    TextWriter &Fixed(float value, int decimals, bool plus = false)
+    {
+        static const uint32_t kPow10[kMaxDecimals + 1]
+            = {1, 10, 100, 1000, 10000, 100000, 1000000};
+        if(decimals < 0)
+            decimals = 0;
+        if(decimals > kMaxDecimals)
+            decimals = kMaxDecimals;
+
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        bool     neg = (bits >> 31) != 0;
+        int      exp = (int)((bits >> 23) & 0xFF);
+        uint32_t man = bits & 0x7FFFFF;
+
+        if(neg)
+            Char('-');
+        else if(plus)
+            Char('+');
+        if(exp == 0xFF)
+            return Str(man ? "nan" : "inf");
+
+        // value = man * 2^e exactly
+        int e;
+        if(exp == 0)
+        {
+            e = -149; // denormal
+        }
+        else
+        {
+            man |= 0x800000;
+            e = exp - 150;
+        }
+
+        // q = round(value * 10^decimals), half to even
+        uint64_t scaled = (uint64_t)man * kPow10[decimals]; // < 2^44
+        uint64_t q      = 0;
+        if(e >= 0)
+        {
+            if(e > 19)
+                return Str("ovf");
+            q = scaled << e;
+        }
+        else if(-e < 64)
+        {
+            int      s    = -e;
+            uint64_t rem  = scaled & ((1ull << s) - 1);
+            uint64_t half = 1ull << (s - 1);
+            q             = scaled >> s;
+            if(rem > half || (rem == half && (q & 1)))
+                q++;
+        }
+
+        uint32_t p = kPow10[decimals];
+        uint32_t frac;
+        if(q <= 0xFFFFFFFFu)
+        {
+            Uint((uint32_t)q / p);
+            frac = (uint32_t)q % p;
+        }
+        else
+        {
+            Uint(q / p);
+            frac = (uint32_t)(q % p);
+        }
+        if(decimals > 0)
+        {
+            Char('.');
+            for(int d = decimals - 1; d >= 0; d--)
+                Char((char)('0' + (frac / kPow10[d]) % 10));
+        }
+        return *this;
+    }
+
+    // ----------------------------------------------------
+    // Units as the apps print them
+    // ----------------------------------------------------
+    TextWriter &Volts(float v) { return Fixed(v, 2).Char('V'); }
+    TextWriter &Octaves(float oct) { return Fixed(oct, 1).Str(" oct"); }
+    TextWriter &Hz(float hz) { return Fixed(hz, 1).Str("Hz"); }
+    TextWriter &Cents(float c) { return Fixed(c, 1, true).Char('c'); }
+
+    const char *CStr() const { return buf_; }
+    size_t      Length() const { return len_; }
+
+  private:
+    char * buf_;
+    size_t size_;
+    size_t len_;
+};
+
+// one-shot version of TextWriter::Fixed; returns the length
+inline size_t FormatFixed(char * buf,
+                          size_t size,
+                          float  value,
+                          int    decimals,
+                          bool   plus = false)
+{
+    return TextWriter(buf, size).Fixed(value, decimals, plus).Length();
+}
+
+} // namespace daisyex
+
+#endif
@@ -0,0 +1,196 @@
+/**********************************************************
+   gate_out.h
+   Daisy side of gate_schedule.h: gate output edges on
+   their exact sample, from a timer interrupt
+
+   Writing the gate pin from the audio callback puts the
+   edge wherever the callback happens to be running, up to
+   a block away from the sample the note sounds on. Here
+   the callback only schedules: an edge at sample offset i
+   of the block being filled is converted to the tick at
+   which that sample plays, and a one-shot timer (TIM3 by
+   default; TIM2 is libDaisy's System clock and the apps
+   poll MIDI on TIM5) writes the pin then.
+
+       static GateOut gate;
+       gate.Init(GateOut::Config(), sr);  // PA10, 1 ms min
+       ...
+       // audio callback
+       gate.BeginBlock(size);             // first thing
+       gate.Retrigger(i);                 // NoteOn at i
+       gate.Set(i, false);                // last NoteOff
+
+   Minimum pulse width and retrigger gap are GateSchedule's.
+   The timer's period is at most one block (and 16 bits),
+   so while an edge is pending the interrupt runs at least
+   once per block and never has to be moved earlier under
+   the callback. Edges go from the callback to the
+   interrupt through an SpscQueue; the timer interrupt
+   should preempt the audio DMA one.
+
+   Edges land within the interrupt entry time (well under
+   a microsecond) of their sample. Late() counts edges the
+   interrupt found more than a sample overdue.
+**********************************************************/
+#pragma once
+#ifndef DAISYEX_GATE_OUT_H
+#define DAISYEX_GATE_OUT_H
+
+#include "daisy.h"
+#include "event_queue.h"
+#include "gate_schedule.h"
+
+namespace daisyex
+{
+class GateOut
+{
+  public:
+    struct Config
+    {
+        dsy_gpio_pin                          pin;
+        daisy::TimerHandle::Config::Peripheral periph;
+        float                                 min_width_ms;
+        float                                 retrig_gap_ms;
+
+        Config()
+        {
+            pin           = {DSY_GPIOA, 10}; // Patch gate out
+            periph        = daisy::TimerHandle::Config::Peripheral::TIM_3;
+            min_width_ms  = 1.f;
+            retrig_gap_ms = 1.f;
+        }
+    };
+
+    void Init(const Config &config, float samplerate)
+    {
+        pin_.pin  = config.pin;
+        pin_.mode = DSY_GPIO_MODE_OUTPUT_PP;
+        pin_.pull = DSY_GPIO_NOPULL;
+        dsy_gpio_init(&pin_);
+        dsy_gpio_write(&pin_, 0);
+
+        daisy::TimerHandle::Config tim_cfg;
+        tim_cfg.periph     = config.periph;
+        tim_cfg.dir        = daisy::TimerHandle::Config::CounterDir::UP;
+        tim_cfg.enable_irq = true;
+        tim_.Init(tim_cfg);
+        tim_.SetCallback(TimerCallback, this);
+
+        // the timer and System::GetTick() count the same
+        // 200 MHz APB1 timer clock
+        clock_.Init(samplerate, daisy::System::GetTickFreq());
+        sched_.Init(Samples(config.min_width_ms, samplerate),
+                    Samples(config.retrig_gap_ms, samplerate));
+        max_hop_     = 0xFFFF;
+        armed_       = false;
+        has_pending_ = false;
+        late_        = 0;
+        late_ticks_  = clock_.Ticks(1);
+    }
+
+    // first thing in the audio callback
+    void BeginBlock(size_t size)
+    {
+        clock_.BeginBlock(daisy::System::GetTick(), size);
+        uint32_t block = clock_.Ticks(size);
+        max_hop_       = block < 0xFFFF ? block : 0xFFFF;
+    }
+
+    // sample offsets within the block being filled
+    void Set(size_t offset, bool high)
+    {
+        GateEdge e[GateSchedule::kMaxEdges];
+        Push(e, sched_.Set(At(offset), high, e));
+    }
+    void Retrigger(size_t offset)
+    {
+        GateEdge e[GateSchedule::kMaxEdges];
+        Push(e, sched_.Retrigger(At(offset), e));
+    }
+    void Trigger(size_t offset, uint32_t width_samples)
+    {
+        GateEdge e[GateSchedule::kMaxEdges];
+        Push(e, sched_.Trigger(At(offset), width_samples, e));
+    }
+
+    // scheduled level (the pin follows when it's due)
+    bool     High() const { return sched_.High(); }
+    uint32_t Late() const { return late_; }
+    uint32_t Dropped() const { return queue_.Dropped(); }
+
+  private:
+    static uint32_t Samples(float ms, float samplerate)
+    {
+        return (uint32_t)(ms * 0.001f * samplerate + 0.5f);
+    }
+
+    uint32_t At(size_t offset) const
+    {
+        return clock_.BlockStart() + (uint32_t)offset;
+    }
+
+    // audio callback
+    void Push(GateEdge *e, size_t n)
+    {
+        for(size_t k = 0; k < n; k++)
+        {
+            e[k].at = clock_.TickOf(e[k].at);
+            queue_.Push(e[k]);
+        }
+        // idle timer: nothing queued before these, so the
+        // first is the next due
+        if(n > 0 && !armed_)
+        {
+            armed_ = true;
+            Arm((int32_t)(e[0].at - daisy::System::GetTick()));
+        }
+    }
+
+    void Arm(int32_t ticks)
+    {
+        uint32_t t = ticks < 1 ? 1 : (uint32_t)ticks;
+        if(t > max_hop_)
+            t = max_hop_;
+        tim_.SetPeriod(t - 1);
+        tim_.Start();
+    }
+
+    static void TimerCallback(void *data) { ((GateOut *)data)->OnTimer(); }
+
+    // timer interrupt: write every edge that's due, then
+    // sleep until the next one (or go idle)
+    void OnTimer()
+    {
+        tim_.Stop();
+        uint32_t now = daisy::System::GetTick();
+        while(has_pending_ || (has_pending_ = queue_.Pop(pending_)))
+        {
+            int32_t dt = (int32_t)(pending_.at - now);
+            if(dt > 0)
+            {
+                Arm(dt);
+                return;
+            }
+            if(-dt > (int32_t)late_ticks_)
+                late_++;
+            dsy_gpio_write(&pin_, pending_.high);
+            has_pending_ = false;
+        }
+        armed_ = false;
+    }
+
+    dsy_gpio                    pin_;
+    daisy::TimerHandle          tim_;
+    AudioTickClock              clock_;
+    GateSchedule                sched_;
+    SpscQueue<GateEdge, 32>     queue_;
+    GateEdge                    pending_; // popped, not yet due
+    bool                        has_pending_;
+    volatile bool               armed_;
+    uint32_t                    max_hop_, late_ticks_;
+    volatile uint32_t           late_;
+};
+
+} // namespace daisyex
+
+#endif
@@ -0,0 +1,186 @@
+/**********************************************************
+   gate_schedule.h
+   Gate edges in sample time, and sample time => timer
+   ticks
+
+   Hardware-independent half of the gate output engine
+   (gate_out.h is the Daisy side, utils/host/gate_check.cpp
+   checks both on the host stub layer).
+
+   GateSchedule  turns Set/Retrigger/Trigger requests at
+                 sample times into edges, with a minimum
+                 high time (pulse width) and a minimum low
+                 time (retrigger gap). An edge that would
+                 break either is moved later, never dropped,
+                 so edges come out in time order:
+
+       GateEdge e[GateSchedule::kMaxEdges];
+       size_t   n = sched.Retrigger(t, e);
+
+   AudioTickClock maps the sample a block will play to a
+                 free-running tick counter (System::GetTick(),
+                 200 MHz). Each callback gives its entry
+                 tick; the block it fills starts playing one
+                 block later (as in event_queue.h), so sample
+                 s of the stream plays at
+                     anchor + (s - anchor_sample) * ticks/sample
+                 The anchor (32.32, so the fraction of a tick
+                 per block isn't lost) follows the callback
+                 entries a 1/8 at a time, so their interrupt
+                 latency isn't copied onto the edges, and
+                 jumps on a skipped or late block.
+
+   Sample times are uint32_t and compared by difference,
+   so they wrap (after 24 h at 48 kHz) without a glitch.
+**********************************************************/
+#pragma once
+#ifndef DAISYEX_GATE_SCHEDULE_H
+#define DAISYEX_GATE_SCHEDULE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace daisyex
+{
+struct GateEdge
+{
+    uint32_t at;   // sample time (ticks once converted)
+    uint8_t  high; // level from 'at' on
+};
+
+// ----------------------------------------------------
+// GateSchedule
+// ----------------------------------------------------
+class GateSchedule
+{
+  public:
+    static const size_t kMaxEdges = 3; // per call
+
+    // in samples
+    void Init(uint32_t min_width, uint32_t retrig_gap)
+    {
+        min_width_  = min_width;
+        retrig_gap_ = retrig_gap;
+        level_      = false;
+        have_edge_  = false;
+        last_       = 0;
+    }
+
+    // the level from sample t on; returns the edges (0..1)
+    size_t Set(uint32_t t, bool high, GateEdge *out)
+    {
+        if(high == level_)
+            return 0;
+        if(have_edge_)
+        {
+            // high at least min_width, low at least the gap
+            uint32_t earliest = last_ + (level_ ? min_width_ : retrig_gap_);
+            if((int32_t)(t - earliest) < 0)
+                t = earliest;
+        }
+        out[0].at   = t;
+        out[0].high = high;
+        last_       = t;
+        level_      = high;
+        have_edge_  = true;
+        return 1;
+    }
+
+    // high from t; already high, low for the gap first so
+    // the next module sees a new gate (0..2 edges)
+    size_t Retrigger(uint32_t t, GateEdge *out)
+    {
+        size_t n = 0;
+        if(level_)
+            n += Set(t, false, out);
+        return n + Set(t, true, out + n);
+    }
+
+    // a pulse of 'width' samples from t (up to 3 edges)
+    size_t Trigger(uint32_t t, uint32_t width, GateEdge *out)
+    {
+        size_t n = Retrigger(t, out);
+        // counted from where the rise actually landed
+        return n + Set(last_ + width, false, out + n);
+    }
+
+    bool High() const { return level_; }
+
+  private:
+    uint32_t min_width_, retrig_gap_;
+    uint32_t last_; // time of the last edge
+    bool     level_, have_edge_;
+};
+
+// ----------------------------------------------------
+// AudioTickClock
+// ----------------------------------------------------
+class AudioTickClock
+{
+  public:
+    void Init(float samplerate, uint32_t tick_freq)
+    {
+        tps_       = (uint64_t)((double)tick_freq * 4294967296.0 / samplerate);
+        started_   = false;
+        next_      = 0;
+        start_     = 0;
+        anchor_    = 0;
+        anchor_at_ = 0;
+        resyncs_   = 0;
+    }
+
+    // First thing in the audio callback, with the tick
+    // counter read there
+    void BeginBlock(uint32_t entry_tick, size_t size)
+    {
+        start_            = next_;
+        next_             = start_ + (uint32_t)size;
+        uint64_t measured = ((uint64_t)entry_tick << 32) + size * tps_;
+        uint64_t expected = Fx(start_);
+        int64_t  err      = (int64_t)(measured - expected);
+        int64_t  limit    = (int64_t)(size * tps_ / 2);
+        if(!started_ || err > limit || err < -limit)
+        {
+            if(started_)
+                resyncs_++;
+            anchor_ = measured;
+        }
+        else
+            anchor_ = expected + err / 8;
+        anchor_at_ = start_;
+        started_   = true;
+    }
+
+    // sample time of offset 0 of the current block
+    uint32_t BlockStart() const { return start_; }
+
+    // tick at which sample time s plays
+    uint32_t TickOf(uint32_t s) const { return (uint32_t)(Fx(s) >> 32); }
+
+    uint32_t Ticks(size_t samples) const
+    {
+        return (uint32_t)((uint64_t)samples * tps_ >> 32);
+    }
+
+    // blocks that came too early or late to follow
+    uint32_t Resyncs() const { return resyncs_; }
+
+  private:
+    // 32.32 tick of sample s; wraps mod 2^64 like the
+    // tick counter does mod 2^32
+    uint64_t Fx(uint32_t s) const
+    {
+        int32_t d = (int32_t)(s - anchor_at_);
+        return anchor_ + (uint64_t)(int64_t)d * tps_;
+    }
+
+    uint64_t tps_;    // 32.32 ticks per sample
+    uint64_t anchor_; // 32.32 tick of anchor_at_
+    bool     started_;
+    uint32_t next_, start_, anchor_at_;
+    uint32_t resyncs_;
+};
+
+} // namespace daisyex
+
+#endif
@@ -0,0 +1,139 @@
+/**********************************************************
+   idle_stats.h
+   Idle blocks, sleep time and an estimate of the current
+   it saves
+
+   Two kinds of idle add up here:
+     - silent audio blocks: with no voice on and no event
+       due, the apps' callbacks clear the outputs with one
+       memset per channel and return, skipping the voice
+       loop and any DAC write that wouldn't change the
+       output
+     - main-loop sleep: Scheduler runs WFI when no task is
+       ready and counts the time in IdleUs()
+
+       g_idle.Init();                       // or Init(run, sleep)
+       ...
+       g_idle.Block(silent);                // audio callback
+       ...
+       g_idle.Update(System::GetUs(),       // main loop, ~1 s
+                     g_sched.IdleUs(),
+                     g_prof.AvgLoad());
+
+   The WFI time includes the interrupts that end it. Most
+   of the audio callback's time falls there (the UI tasks
+   are short), so its average load is taken off to get the
+   time the core actually slept. The current estimate is
+       saved = sleep% * (run_ma - sleep_ma)
+   against a core that never sleeps. The default figures
+   are rough STM32H750 numbers at 480 MHz (run from flash
+   with caches on, and sleep with the apps' peripherals
+   clocked); for a battery install, measure the supply
+   current with and without audio and pass those instead.
+**********************************************************/
+#pragma once
+#ifndef DAISYEX_IDLE_STATS_H
+#define DAISYEX_IDLE_STATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "fixed_format.h"
+
+namespace daisyex
+{
+class IdleStats
+{
+  public:
+    void Init(float run_ma = 110.f, float sleep_ma = 40.f)
+    {
+        run_ma_      = run_ma;
+        sleep_ma_    = sleep_ma;
+        blocks_      = 0;
+        idle_blocks_ = 0;
+        last_blocks_ = 0;
+        last_idle_   = 0;
+        last_us_     = 0;
+        last_wfi_us_ = 0;
+        started_     = false;
+        idle_pct_    = 0;
+        wfi_pct_     = 0;
+        sleep_pct_   = 0;
+    }
+
+    // audio callback, once per block
+    void Block(bool idle)
+    {
+        blocks_ = blocks_ + 1;
+        if(idle)
+            idle_blocks_ = idle_blocks_ + 1;
+    }
+
+    // main loop: figures over the time since the last call
+    // (the first call only starts the window)
+    void Update(uint32_t now_us, uint32_t wfi_us, uint32_t load_pct)
+    {
+        uint32_t blocks = blocks_, idle = idle_blocks_;
+        if(started_)
+        {
+            uint32_t db = blocks - last_blocks_;
+            uint32_t di = idle - last_idle_;
+            uint32_t dt = now_us - last_us_;
+            uint32_t dw = wfi_us - last_wfi_us_;
+            idle_pct_   = db ? (uint32_t)((uint64_t)di * 100 / db) : 0;
+            wfi_pct_    = dt ? (uint32_t)((uint64_t)dw * 100 / dt) : 0;
+            if(wfi_pct_ > 100)
+                wfi_pct_ = 100;
+            sleep_pct_ = wfi_pct_ > load_pct ? wfi_pct_ - load_pct : 0;
+        }
+        last_blocks_ = blocks;
+        last_idle_   = idle;
+        last_us_     = now_us;
+        last_wfi_us_ = wfi_us;
+        started_     = true;
+    }
+
+    // percent of audio blocks that took the silent path
+    uint32_t IdlePercent() const { return idle_pct_; }
+    // percent of the time in the scheduler's WFI
+    uint32_t WfiPercent() const { return wfi_pct_; }
+    // percent of the time the core slept
+    uint32_t SleepPercent() const { return sleep_pct_; }
+    // estimated core current saved, mA
+    float SavedMa() const
+    {
+        return (float)sleep_pct_ * 0.01f * (run_ma_ - sleep_ma_);
+    }
+
+    // one line for the Logger
+    template <typename PrintFn>
+    void Report(PrintFn print) const
+    {
+        char line[96];
+        TextWriter(line, sizeof(line))
+            .Str("idle ")
+            .Uint(idle_pct_)
+            .Str("% of blocks, wfi ")
+            .Uint(wfi_pct_)
+            .Str("%, asleep ")
+            .Uint(sleep_pct_)
+            .Str("%, ~")
+            .Fixed(SavedMa(), 1)
+            .Str(" mA saved (run ")
+            .Uint((uint32_t)run_ma_)
+            .Str(" sleep ")
+            .Uint((uint32_t)sleep_ma_)
+            .Str(" mA)");
+        print(line);
+    }
+
+  private:
+    float             run_ma_, sleep_ma_;
+    volatile uint32_t blocks_, idle_blocks_; // audio callback
+    uint32_t          last_blocks_, last_idle_, last_us_, last_wfi_us_;
+    bool              started_;
+    uint32_t          idle_pct_, wfi_pct_, sleep_pct_;
+};
+
+} // namespace daisyex
+
+#endif
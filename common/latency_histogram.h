@@ -0,0 +1,82 @@
+/**********************************************************
+   latency_histogram.h
+   Fixed-bin latency histogram with percentiles
+
+   Record() is cheap enough for the audio callback (one
+   divide, one increment). Percentile() walks the bins and
+   is meant for the main loop / display. Values above the
+   last bin land in the last bin, so p99 saturates rather
+   than wraps.
+**********************************************************/
+#pragma once
+#ifndef DAISYEX_LATENCY_HISTOGRAM_H
+#define DAISYEX_LATENCY_HISTOGRAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace daisyex
+{
+template <size_t Bins>
+class LatencyHistogram
+{
+  public:
+    // bin_us: width of one bin in microseconds
+    void Init(uint32_t bin_us)
+    {
+        bin_us_ = bin_us > 0 ? bin_us : 1;
+        Reset();
+    }
+
+    void Reset()
+    {
+        for(size_t i = 0; i < Bins; i++)
+            bins_[i] = 0;
+        count_  = 0;
+        max_us_ = 0;
+    }
+
+    void Record(uint32_t us)
+    {
+        size_t b = us / bin_us_;
+        if(b >= Bins)
+            b = Bins - 1;
+        bins_[b]++;
+        count_++;
+        if(us > max_us_)
+            max_us_ = us;
+    }
+
+    // p in [0..1], returns the upper edge of the bin (us)
+    uint32_t Percentile(float p) const
+    {
+        if(count_ == 0)
+            return 0;
+        uint32_t target = (uint32_t)(p * (float)count_);
+        if(target >= count_)
+            target = count_ - 1;
+        uint32_t seen = 0;
+        for(size_t i = 0; i < Bins; i++)
+        {
+            seen += bins_[i];
+            if(seen > target)
+                return (uint32_t)(i + 1) * bin_us_;
+        }
+        return (uint32_t)Bins * bin_us_;
+    }
+
+    uint32_t Count() const { return count_; }
+    uint32_t MaxUs() const { return max_us_; }
+    uint32_t BinUs() const { return bin_us_; }
+    uint32_t Bin(size_t i) const { return bins_[i]; }
+
+  private:
+    uint32_t bins_[Bins];
+    uint32_t bin_us_;
+    uint32_t count_;
+    uint32_t max_us_;
+};
+
+} // namespace daisyex
+
+#endif
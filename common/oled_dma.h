@@ -0,0 +1,206 @@
+/**********************************************************
+   oled_dma.h
+   Double-buffered SSD130x driver with dirty-page transfers
+
+   The app draws into a back buffer; Update() copies the
+   pages that changed into the front buffer and streams
+   them out asynchronously (DMA on hardware), so drawing
+   the next frame overlaps with the transfer.
+
+   - DrawPixel()/Fill() mark a page dirty only when a byte
+     actually changes, so redrawing identical content costs
+     no bus traffic.
+   - Update() sends the span first..last dirty page in one
+     transfer (horizontal addressing mode); pages between
+     two dirty ones are resent rather than splitting the
+     transfer into several DMA requests.
+   - Copying dirty pages back -> front (at most W*H/8
+     bytes) keeps the back buffer complete for retained
+     drawing, which a pointer swap would not.
+   - If the previous transfer is still running, Update()
+     waits for it (counted in Stats::waits). At 12.5 MHz a
+     full 128x64 frame takes well under a millisecond, far
+     less than the OLED frame interval.
+
+   Transport is hardware-free here. It must provide
+       typedef ... Config;
+       void Init(const Config &);
+       void Reset();
+       void SendCommand(uint8_t);          // blocking
+       void SendData(const uint8_t *buf,   // async, calls
+                     size_t size,          // done(ctx) on
+                     void (*done)(void *), // completion
+                     void *ctx);
+   See oled_spi_dma.h (SPI DMA) and oled_host.h (host).
+**********************************************************/
+#pragma once
+#ifndef DAISYEX_OLED_DMA_H
+#define DAISYEX_OLED_DMA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+namespace daisyex
+{
+template <size_t W, size_t H, typename Transport>
+class DoubleBufferedOledDriver
+{
+    static_assert(H % 8 == 0 && H <= 64, "height must be 8..64, multiple of 8");
+
+  public:
+    static const size_t kPages      = H / 8;
+    static const size_t kBufferSize = W * kPages;
+
+    struct Config
+    {
+        typename Transport::Config transport_config;
+        // kBufferSize bytes the transport can read while the
+        // app draws, e.g. DMA_BUFFER_MEM_SECTION on the Daisy
+        uint8_t *front_buffer;
+    };
+
+    struct Stats
+    {
+        uint32_t frames;  // transfers started
+        uint32_t skipped; // Update() with no changed pixels
+        uint32_t waits;   // Update() had to wait for the bus
+        uint32_t pages;   // pages transferred
+    };
+
+    void Init(const Config &config)
+    {
+        front_ = config.front_buffer;
+        busy_  = false;
+        stats_ = Stats{0, 0, 0, 0};
+        memset(back_, 0, kBufferSize);
+        memset(front_, 0, kBufferSize);
+
+        transport_.Init(config.transport_config);
+        transport_.Reset();
+
+        // same panel setup as libDaisy's SSD130x driver,
+        // but horizontal addressing for multi-page bursts
+        const uint8_t init[] = {
+            0xAE,              // display off
+            0xD5, 0x80,        // clock divide
+            0xA8, (uint8_t)(H - 1),
+            0xD3, 0x00,        // display offset
+            0x40,              // start line 0
+            0x8D, 0x14,        // charge pump on
+            0x20, 0x00,        // horizontal addressing
+            0xA1,              // segment remap
+            0xC8,              // COM scan decrement
+            0xDA, (uint8_t)(H == 64 ? 0x12 : 0x02),
+            0x81, 0x8F,        // contrast
+            0xD9, 0x25,        // precharge
+            0xDB, 0x34,        // VCOM detect
+            0xA4,              // resume from RAM
+            0xA6,              // normal (not inverted)
+            0xAF,              // display on
+        };
+        for(size_t i = 0; i < sizeof(init); i++)
+            transport_.SendCommand(init[i]);
+
+        // clear the panel on the first Update()
+        dirty_ = (uint8_t)((1u << kPages) - 1);
+    }
+
+    size_t Width() const { return W; }
+    size_t Height() const { return H; }
+
+    void DrawPixel(uint_fast8_t x, uint_fast8_t y, bool on)
+    {
+        if(x >= W || y >= H)
+            return;
+        size_t  page = y >> 3;
+        uint8_t bit  = (uint8_t)(1u << (y & 7));
+        uint8_t &b   = back_[x + page * W];
+        uint8_t nb   = on ? (uint8_t)(b | bit) : (uint8_t)(b & ~bit);
+        if(nb != b)
+        {
+            b = nb;
+            dirty_ |= (uint8_t)(1u << page);
+        }
+    }
+
+    void Fill(bool on)
+    {
+        uint8_t v = on ? 0xFF : 0x00;
+        for(size_t p = 0; p < kPages; p++)
+        {
+            uint8_t *row = back_ + p * W;
+            for(size_t x = 0; x < W; x++)
+            {
+                if(row[x] != v)
+                {
+                    memset(row, v, W);
+                    dirty_ |= (uint8_t)(1u << p);
+                    break;
+                }
+            }
+        }
+    }
+
+    void Update()
+    {
+        if(dirty_ == 0)
+        {
+            stats_.skipped++;
+            return;
+        }
+        if(busy_)
+        {
+            stats_.waits++;
+            while(busy_) {}
+        }
+
+        size_t first = 0, last = kPages - 1;
+        while(!(dirty_ & (1u << first)))
+            first++;
+        while(!(dirty_ & (1u << last)))
+            last--;
+        size_t offset = first * W;
+        size_t size   = (last - first + 1) * W;
+        memcpy(front_ + offset, back_ + offset, size);
+        dirty_ = 0;
+
+        const uint8_t span[] = {0x21,
+                                0x00,
+                                (uint8_t)(W - 1),
+                                0x22,
+                                (uint8_t)first,
+                                (uint8_t)last};
+        for(size_t i = 0; i < sizeof(span); i++)
+            transport_.SendCommand(span[i]);
+
+        stats_.frames++;
+        stats_.pages += (uint32_t)(last - first + 1);
+        busy_ = true;
+        transport_.SendData(front_ + offset, size, TransferDone, this);
+    }
+
+    bool         Busy() const { return busy_; }
+    uint8_t      DirtyPages() const { return dirty_; }
+    const Stats &GetStats() const { return stats_; }
+
+    const uint8_t *BackBuffer() const { return back_; }
+    Transport &    GetTransport() { return transport_; }
+
+  private:
+    static void TransferDone(void *ctx)
+    {
+        static_cast<DoubleBufferedOledDriver *>(ctx)->busy_ = false;
+    }
+
+    Transport     transport_;
+    uint8_t       back_[kBufferSize];
+    uint8_t *     front_;
+    uint8_t       dirty_; // bit per page
+    volatile bool busy_;
+    Stats         stats_;
+};
+
+} // namespace daisyex
+
+#endif
@@ -0,0 +1,177 @@
+/**********************************************************
+   oled_host.h
+   Host-side transport for oled_dma.h
+
+   Emulates the SSD130x display RAM for the commands the
+   driver uses (column/page ranges, horizontal addressing),
+   so frame content can be checked without hardware:
+
+       DoubleBufferedOledDriver<128, 64, HostOledTransport<128, 64>>
+
+   By default a transfer completes inside SendData(). With
+   SetManualComplete(true) it stays in flight until
+   Complete() is called, to exercise the double buffering.
+**********************************************************/
+#pragma once
+#ifndef DAISYEX_OLED_HOST_H
+#define DAISYEX_OLED_HOST_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace daisyex
+{
+template <size_t W, size_t H>
+class HostOledTransport
+{
+  public:
+    struct Config
+    {
+    };
+
+    void Init(const Config &)
+    {
+        memset(ram_, 0, sizeof(ram_));
+        col_lo_ = col_ = 0;
+        col_hi_        = W - 1;
+        page_lo_ = page_ = 0;
+        page_hi_         = H / 8 - 1;
+        pending_cmd_     = 0;
+        args_left_       = 0;
+        manual_          = false;
+        done_            = nullptr;
+        commands_ = data_bytes_ = transfers_ = 0;
+    }
+
+    void Reset() {}
+
+    void SendCommand(uint8_t cmd)
+    {
+        commands_++;
+        if(args_left_ > 0)
+        {
+            args_[2 - args_left_] = cmd;
+            if(--args_left_ == 0)
+                ApplyCommand();
+            return;
+        }
+        pending_cmd_ = cmd;
+        switch(cmd)
+        {
+            case 0x21:
+            case 0x22: args_left_ = 2; break;
+            case 0x20:
+            case 0x81:
+            case 0x8D:
+            case 0xA8:
+            case 0xD3:
+            case 0xD5:
+            case 0xD9:
+            case 0xDA:
+            case 0xDB: args_left_ = 1; break;
+            default: break;
+        }
+    }
+
+    void SendData(const uint8_t *buf,
+                  size_t         size,
+                  void (*done)(void *),
+                  void *ctx)
+    {
+        transfers_++;
+        data_bytes_ += (uint32_t)size;
+        // the panel reads the buffer as the bytes go out;
+        // in manual mode that happens at Complete()
+        buf_      = buf;
+        size_     = size;
+        done_     = done;
+        done_ctx_ = ctx;
+        if(!manual_)
+            Complete();
+    }
+
+    void SetManualComplete(bool manual) { manual_ = manual; }
+    bool InFlight() const { return done_ != nullptr; }
+
+    // finish the transfer in flight
+    void Complete()
+    {
+        if(!done_)
+            return;
+        for(size_t i = 0; i < size_; i++)
+            WriteData(buf_[i]);
+        void (*done)(void *) = done_;
+        done_                = nullptr;
+        done(done_ctx_);
+    }
+
+    bool Pixel(size_t x, size_t y) const
+    {
+        return (ram_[x + (y / 8) * W] >> (y & 7)) & 1;
+    }
+    const uint8_t *Ram() const { return ram_; }
+
+    uint32_t Commands() const { return commands_; }
+    uint32_t DataBytes() const { return data_bytes_; }
+    uint32_t Transfers() const { return transfers_; }
+
+    // one text line per pixel row, '#' = on
+    void Dump(FILE *f) const
+    {
+        char line[W + 2];
+        for(size_t y = 0; y < H; y++)
+        {
+            for(size_t x = 0; x < W; x++)
+                line[x] = Pixel(x, y) ? '#' : '.';
+            line[W]     = '\n';
+            line[W + 1] = 0;
+            fputs(line, f);
+        }
+    }
+
+  private:
+    void ApplyCommand()
+    {
+        if(pending_cmd_ == 0x21)
+        {
+            col_lo_ = col_ = args_[0] < W ? args_[0] : W - 1;
+            col_hi_        = args_[1] < W ? args_[1] : W - 1;
+        }
+        else if(pending_cmd_ == 0x22)
+        {
+            page_lo_ = page_ = args_[0] < H / 8 ? args_[0] : H / 8 - 1;
+            page_hi_         = args_[1] < H / 8 ? args_[1] : H / 8 - 1;
+        }
+    }
+
+    // horizontal addressing: column first, then page
+    void WriteData(uint8_t b)
+    {
+        ram_[col_ + page_ * W] = b;
+        if(col_ < col_hi_)
+        {
+            col_++;
+            return;
+        }
+        col_  = col_lo_;
+        page_ = page_ < page_hi_ ? page_ + 1 : page_lo_;
+    }
+
+    uint8_t        ram_[W * H / 8];
+    size_t         col_lo_, col_hi_, col_;
+    size_t         page_lo_, page_hi_, page_;
+    uint8_t        pending_cmd_, args_[2];
+    int            args_left_;
+    bool           manual_;
+    const uint8_t *buf_;
+    size_t         size_;
+    void (*done_)(void *);
+    void *         done_ctx_;
+    uint32_t       commands_, data_bytes_, transfers_;
+};
+
+} // namespace daisyex
+
+#endif
@@ -0,0 +1,154 @@
+/**********************************************************
+   oled_spi_dma.h
+   Daisy side of oled_dma.h: SPI DMA transport and an
+   OledDisplay-style wrapper
+
+   PatchOled is a drop-in for patch.display (same drawing
+   API from OneBitGraphicsDisplayImpl) whose Update() no
+   longer blocks on the SPI transfer:
+
+       static uint8_t DMA_BUFFER_MEM_SECTION oled_front[1024];
+       PatchOled oled;
+       ...
+       PatchOled::Config cfg;
+       cfg.driver_config.front_buffer = oled_front;
+       oled.Init(cfg);
+
+   The front buffer must live in D2 SRAM (DMA1/2 can't
+   reach the DTCM where .bss goes; libDaisy maps SRAM1
+   non-cacheable, so no cache maintenance is needed).
+   Pins and SPI settings default to the Patch OLED.
+**********************************************************/
+#pragma once
+#ifndef DAISYEX_OLED_SPI_DMA_H
+#define DAISYEX_OLED_SPI_DMA_H
+
+#include "daisy.h"
+#include "oled_dma.h"
+
+namespace daisyex
+{
+class SpiDmaOledTransport
+{
+  public:
+    struct Config
+    {
+        daisy::SpiHandle::Config spi_config;
+        struct
+        {
+            dsy_gpio_pin dc;
+            dsy_gpio_pin reset;
+        } pin_config;
+
+        Config()
+        {
+            typedef daisy::SpiHandle::Config Spi;
+            spi_config.periph          = Spi::Peripheral::SPI_1;
+            spi_config.mode            = Spi::Mode::MASTER;
+            spi_config.direction       = Spi::Direction::TWO_LINES_TX_ONLY;
+            spi_config.datasize        = 8;
+            spi_config.clock_polarity  = Spi::ClockPolarity::LOW;
+            spi_config.clock_phase     = Spi::ClockPhase::ONE_EDGE;
+            spi_config.nss             = Spi::NSS::HARD_OUTPUT;
+            spi_config.baud_prescaler  = Spi::BaudPrescaler::PS_8;
+            spi_config.pin_config.sclk = {DSY_GPIOG, 11};
+            spi_config.pin_config.miso = {DSY_GPIOX, 0};
+            spi_config.pin_config.mosi = {DSY_GPIOB, 5};
+            spi_config.pin_config.nss  = {DSY_GPIOG, 10};
+            pin_config.dc              = {DSY_GPIOB, 4};
+            pin_config.reset           = {DSY_GPIOB, 15};
+        }
+    };
+
+    void Init(const Config &config)
+    {
+        pin_dc_.mode    = DSY_GPIO_MODE_OUTPUT_PP;
+        pin_dc_.pin     = config.pin_config.dc;
+        pin_reset_.mode = DSY_GPIO_MODE_OUTPUT_PP;
+        pin_reset_.pin  = config.pin_config.reset;
+        dsy_gpio_init(&pin_dc_);
+        dsy_gpio_init(&pin_reset_);
+        spi_.Init(config.spi_config);
+    }
+
+    void Reset()
+    {
+        dsy_gpio_write(&pin_reset_, 0);
+        daisy::System::Delay(10);
+        dsy_gpio_write(&pin_reset_, 1);
+        daisy::System::Delay(10);
+    }
+
+    void SendCommand(uint8_t cmd)
+    {
+        dsy_gpio_write(&pin_dc_, 0);
+        spi_.BlockingTransmit(&cmd, 1);
+    }
+
+    void SendData(const uint8_t *buf,
+                  size_t         size,
+                  void (*done)(void *),
+                  void *ctx)
+    {
+        done_     = done;
+        done_ctx_ = ctx;
+        dsy_gpio_write(&pin_dc_, 1);
+        if(spi_.DmaTransmit(const_cast<uint8_t *>(buf),
+                            size,
+                            nullptr,
+                            DmaDone,
+                            this)
+           != daisy::SpiHandle::Result::OK)
+            done(ctx); // don't leave the driver waiting
+    }
+
+  private:
+    static void DmaDone(void *ctx, daisy::SpiHandle::Result result)
+    {
+        SpiDmaOledTransport *t = static_cast<SpiDmaOledTransport *>(ctx);
+        t->done_(t->done_ctx_);
+    }
+
+    daisy::SpiHandle spi_;
+    dsy_gpio         pin_dc_, pin_reset_;
+    void (*done_)(void *);
+    void *done_ctx_;
+};
+
+// ----------------------------------------------------
+// Same shape as daisy::OledDisplay, plus access to the
+// driver for stats
+// ----------------------------------------------------
+template <typename Driver>
+class AsyncOledDisplay
+: public daisy::OneBitGraphicsDisplayImpl<AsyncOledDisplay<Driver>>
+{
+  public:
+    struct Config
+    {
+        typename Driver::Config driver_config;
+    };
+
+    void Init(const Config &config) { driver_.Init(config.driver_config); }
+
+    uint16_t Height() const override { return driver_.Height(); }
+    uint16_t Width() const override { return driver_.Width(); }
+    void     Fill(bool on) override { driver_.Fill(on); }
+    void     DrawPixel(uint_fast8_t x, uint_fast8_t y, bool on) override
+    {
+        driver_.DrawPixel(x, y, on);
+    }
+    void Update() override { driver_.Update(); }
+
+    Driver &GetDriver() { return driver_; }
+
+  private:
+    Driver driver_;
+};
+
+typedef DoubleBufferedOledDriver<128, 64, SpiDmaOledTransport> PatchOledDriver;
+typedef AsyncOledDisplay<PatchOledDriver>                     PatchOled;
+
+} // namespace daisyex
+
+#endif
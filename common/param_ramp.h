@@ -0,0 +1,88 @@
+/**********************************************************
+   param_ramp.h
+   Per-block linear parameter ramps
+
+   Controls are read once per block. Applying the new value
+   as a step at the block boundary zippers (audible on
+   amplitude); recomputing/setting it every sample costs a
+   setter call per sample. A LinearRamp goes from the
+   previous block's value to the new one across the block
+   instead:
+
+       amp.Begin(knob, size);       // block boundary
+       ...render out[] unscaled...
+       amp.Multiply(out, size);     // one multiply-add pass
+
+   Sample i of the block (0-based) gets
+       start + step * (i + 1)
+   so the last sample lands exactly on the target and the
+   next block starts from there without a discontinuity.
+**********************************************************/
+#pragma once
+#ifndef DAISYEX_PARAM_RAMP_H
+#define DAISYEX_PARAM_RAMP_H
+
+#include <stddef.h>
+
+namespace daisyex
+{
+class LinearRamp
+{
+  public:
+    void Init(float value)
+    {
+        start_  = value;
+        target_ = value;
+        step_   = 0.f;
+    }
+
+    // ramp from the current end value to 'target' over n samples
+    void Begin(float target, size_t n) { Begin(target_, target, n); }
+
+    // ramp from an explicit start value
+    void Begin(float start, float target, size_t n)
+    {
+        start_  = start;
+        target_ = target;
+        step_   = n > 0 ? (target - start) / (float)n : 0.f;
+        if(n == 0)
+            start_ = target;
+    }
+
+    // value at sample i of the ramp (i < n)
+    float At(size_t i) const { return start_ + step_ * (float)(i + 1); }
+
+    bool  Flat() const { return step_ == 0.f; }
+    float Start() const { return start_; }
+    float Target() const { return target_; }
+    float Step() const { return step_; }
+
+    // out[i] = ramp value at i
+    void Fill(float *out, size_t n) const
+    {
+        const float s = start_, d = step_;
+        for(size_t i = 0; i < n; i++)
+            out[i] = s + d * (float)(i + 1);
+    }
+
+    // buf[i] *= ramp value at i
+    void Multiply(float *buf, size_t n) const
+    {
+        const float s = start_, d = step_;
+        if(d == 0.f)
+        {
+            for(size_t i = 0; i < n; i++)
+                buf[i] *= s;
+            return;
+        }
+        for(size_t i = 0; i < n; i++)
+            buf[i] *= s + d * (float)(i + 1);
+    }
+
+  private:
+    float start_, target_, step_;
+};
+
+} // namespace daisyex
+
+#endif
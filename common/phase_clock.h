@@ -0,0 +1,237 @@
+/**********************************************************
+   phase_clock.h
+   Fixed-point phase accumulator and sample timer for step,
+   note and loop timing
+
+   A float accumulator (phase += inc; if(phase >= 1) ...)
+   rounds on every add, so its period drifts with the
+   value of the phase, and at a large phase the increment
+   falls below one ulp. These count in integers instead:
+
+   PhaseAccumulator  32-bit phase, one turn = 2^32. The add
+                     wraps by itself and the carry is the
+                     wrap, so there is no compare-subtract
+                     and no drift: the only error is the
+                     rate rounding to 1/2^32 of a turn.
+   SampleTimer       time to the next event in samples,
+                     32.32 fixed point. Periodic ("every P
+                     samples", fractional P kept exactly) or
+                     one-shot ("fire in k samples").
+
+   Both run per sample (Tick(), true on the sample of the
+   event) or per block (Advance(), which writes the sample
+   offsets of the events in the block and costs one step
+   per event rather than per sample):
+
+       uint16_t at[8];
+       size_t   n = timer.Advance(size, at, 8);
+       for(size_t e = 0; e < n; e++)
+           ... event on sample at[e] of this block
+
+   Tick() and Advance() agree sample for sample; see
+   utils/bench/phase_check.cpp, which soaks both over
+   simulated hours against closed-form event times.
+**********************************************************/
+#pragma once
+#ifndef DAISYEX_PHASE_CLOCK_H
+#define DAISYEX_PHASE_CLOCK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace daisyex
+{
+// ----------------------------------------------------
+// PhaseAccumulator
+// ----------------------------------------------------
+class PhaseAccumulator
+{
+  public:
+    PhaseAccumulator() : phase_(0), inc_(0) {}
+
+    void Reset(uint32_t phase = 0) { phase_ = phase; }
+
+    // increment for a rate in turns per sample, [0, 0.5)
+    static uint32_t IncFor(float turnsPerSample)
+    {
+        if(turnsPerSample <= 0.f)
+            return 0;
+        if(turnsPerSample >= 0.5f)
+            return 0x80000000u;
+        return (uint32_t)(turnsPerSample * 4294967296.f);
+    }
+
+    void SetInc(uint32_t inc) { inc_ = inc; }
+    void SetRate(float turnsPerSample) { inc_ = IncFor(turnsPerSample); }
+    void SetFreq(float hz, float samplerate) { SetRate(hz / samplerate); }
+
+    // one sample; true if the phase wrapped on it
+    inline bool Tick()
+    {
+        uint32_t prev = phase_;
+        phase_ += inc_;
+        return phase_ < prev;
+    }
+
+    // Ticks until the next wrap, counting the wrapping one
+    // (inc > 0)
+    uint32_t SamplesToWrap() const { return ~phase_ / inc_ + 1; }
+
+    // n samples at once; writes the offsets of the samples
+    // that wrap (up to max, the rest are dropped) and
+    // returns how many were written
+    size_t Advance(size_t n, uint16_t *offsets = nullptr, size_t max = 0)
+    {
+        size_t count = 0;
+        size_t pos   = 0;
+        while(inc_ != 0)
+        {
+            uint32_t k = SamplesToWrap();
+            if(k > n - pos)
+                break;
+            pos += k;
+            phase_ += inc_ * k;
+            if(count < max)
+                offsets[count++] = (uint16_t)(pos - 1);
+        }
+        phase_ += inc_ * (uint32_t)(n - pos);
+        return count;
+    }
+
+    // phase k samples ahead, without advancing
+    uint32_t RawAt(uint32_t k) const { return phase_ + inc_ * k; }
+
+    uint32_t Raw() const { return phase_; }
+    uint32_t Inc() const { return inc_; }
+    // [0, 1)
+    float Phase() const { return (float)(phase_ >> 8) * (1.f / 16777216.f); }
+
+  private:
+    uint32_t phase_, inc_;
+};
+
+// ----------------------------------------------------
+// SampleTimer
+// ----------------------------------------------------
+class SampleTimer
+{
+  public:
+    static const uint64_t kOne = 1ull << 32; // one sample
+
+    SampleTimer() : left_(0), period_(0), armed_(false) {}
+
+    // 32.32 samples from a float count (>= 1)
+    static uint64_t Samples(float samples)
+    {
+        if(samples < 1.f)
+            samples = 1.f;
+        uint32_t whole = (uint32_t)samples;
+        return ((uint64_t)whole << 32)
+               | (uint32_t)((samples - (float)whole) * 4294967296.f);
+    }
+
+    // periodic, first event one period from now
+    void Start(uint64_t period)
+    {
+        period_ = period < kOne ? kOne : period;
+        left_   = period_ - kOne;
+        armed_  = true;
+    }
+    void StartSeconds(float seconds, float samplerate)
+    {
+        Start(Samples(seconds * samplerate));
+    }
+
+    // New period for a running timer. The current cycle
+    // keeps the time already elapsed, so the pending event
+    // moves by the change (to the next sample at the
+    // earliest, if the new period has already passed). A
+    // one-shot becomes periodic after its event.
+    void SetPeriod(uint64_t period)
+    {
+        if(period < kOne)
+            period = kOne;
+        if(armed_ && period_ != 0)
+        {
+            if(period >= period_)
+                left_ += period - period_;
+            else
+                left_ = left_ > period_ - period ? left_ - (period_ - period)
+                                                 : 0;
+        }
+        period_ = period;
+    }
+
+    // one-shot on the k-th Tick from now (k >= 1)
+    void FireIn(uint32_t k)
+    {
+        left_   = (uint64_t)(k > 0 ? k - 1 : 0) << 32;
+        period_ = 0;
+        armed_  = true;
+    }
+
+    void Stop() { armed_ = false; }
+    bool Armed() const { return armed_; }
+
+    // Ticks until the next event, counting the event's
+    // (0 when stopped)
+    uint32_t SamplesLeft() const
+    {
+        return armed_ ? (uint32_t)(left_ >> 32) + 1 : 0;
+    }
+
+    // one sample; true on the sample of an event
+    inline bool Tick()
+    {
+        if(!armed_)
+            return false;
+        if(left_ >= kOne)
+        {
+            left_ -= kOne;
+            return false;
+        }
+        Fire();
+        return true;
+    }
+
+    // n samples at once, as PhaseAccumulator::Advance()
+    size_t Advance(size_t n, uint16_t *offsets = nullptr, size_t max = 0)
+    {
+        size_t count = 0;
+        size_t pos   = 0;
+        while(armed_)
+        {
+            uint64_t at = pos + (left_ >> 32); // event sample
+            if(at >= n)
+            {
+                left_ -= (uint64_t)(n - pos) << 32;
+                return count;
+            }
+            if(count < max)
+                offsets[count++] = (uint16_t)at;
+            left_ &= kOne - 1;
+            Fire();
+            pos = (size_t)at + 1;
+        }
+        return count;
+    }
+
+  private:
+    // left_ < kOne: the event falls in this sample; the
+    // fraction carries into the next period
+    inline void Fire()
+    {
+        if(period_ == 0)
+            armed_ = false;
+        else
+            left_ += period_ - kOne;
+    }
+
+    uint64_t left_;   // 32.32 samples to the next event
+    uint64_t period_; // 32.32, 0 = one-shot
+    bool     armed_;
+};
+
+} // namespace daisyex
+
+#endif
@@ -0,0 +1,141 @@
+/**********************************************************
+   pitch_tables.h
+   Shared pitch helpers for the patch/pod pitch apps
+   (Randos, FractalZoom, JustInTone)
+
+   - 128-entry MIDI note => Hz table, built at compile time
+   - Exact power-of-two octave scaling by exponent edit
+   - Just intonation ratio tables used by the apps
+
+   None of the lookups call powf/log2f at run time.
+**********************************************************/
+#pragma once
+#ifndef DAISYEX_PITCH_TABLES_H
+#define DAISYEX_PITCH_TABLES_H
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+namespace daisyex
+{
+// ----------------------------------------------------
+// Compile-time 2^x for x in [0..1]
+//   exp(x * ln2) as a Taylor series, evaluated in double.
+//   Only used to build the table below.
+// ----------------------------------------------------
+constexpr double ConstExp2Frac(double x)
+{
+    double term = 1.0;
+    double sum  = 1.0;
+    for(int k = 1; k < 30; k++)
+    {
+        term = term * (x * 0.69314718055994530942) / k;
+        sum += term;
+    }
+    return sum;
+}
+
+// ----------------------------------------------------
+// MIDI note => Hz, 440 Hz at note 69
+// ----------------------------------------------------
+struct MidiFreqTable
+{
+    float hz[128];
+
+    constexpr MidiFreqTable() : hz()
+    {
+        for(int n = 0; n < 128; n++)
+        {
+            // offset by 10 octaves so the division stays positive
+            int    rel  = n - 69 + 120;
+            int    oct  = rel / 12 - 10;
+            int    semi = rel % 12;
+            double f    = 440.0 * ConstExp2Frac(semi / 12.0);
+            for(int o = 0; o < oct; o++)
+                f *= 2.0;
+            for(int o = 0; o > oct; o--)
+                f *= 0.5;
+            hz[n] = (float)f;
+        }
+    }
+};
+
+static constexpr MidiFreqTable kMidiFreq{};
+
+// ----------------------------------------------------
+// Just intonation ratios shared by the apps
+// ----------------------------------------------------
+// major scale incl. octave (Randos)
+static constexpr float kJustMajor8[8] = {
+    1.f,      // unison
+    9.f/8.f,  // major 2nd
+    5.f/4.f,  // major 3rd
+    4.f/3.f,  // perfect 4th
+    3.f/2.f,  // perfect 5th
+    5.f/3.f,  // major 6th
+    15.f/8.f, // major 7th
+    2.f       // octave
+};
+
+// 12 chromatic just ratios (JustInTone)
+static constexpr float kJustChromatic12[12] = {
+    1.0f,          // Unison
+    16.0f/15.0f,   // minor 2nd
+    9.0f/8.0f,     // major 2nd
+    6.0f/5.0f,     // minor 3rd
+    5.0f/4.0f,     // major 3rd
+    4.0f/3.0f,     // perfect 4th
+    45.0f/32.0f,   // Tritone (one possibility)
+    3.0f/2.0f,     // perfect 5th
+    8.0f/5.0f,     // minor 6th
+    5.0f/3.0f,     // major 6th
+    9.0f/5.0f,     // minor 7th
+    15.0f/8.0f     // major 7th
+};
+
+// log2 of the above, i.e. the same intervals in volts (1V/oct)
+static constexpr float kJustChromatic12Log2[12] = {
+    0.0f,
+    0.09310940439148145f,
+    0.16992500144231237f,
+    0.2630344058337938f,
+    0.32192809488736235f,
+    0.41503749927884376f,
+    0.4918530963296747f,
+    0.5849625007211562f,
+    0.6780719051126377f,
+    0.7369655941662062f,
+    0.8479969065549501f,
+    0.9068905956085185f
+};
+
+// ----------------------------------------------------
+// Lookups
+// ----------------------------------------------------
+inline float MidiToFreq(int note)
+{
+    if(note < 0)   note = 0;
+    if(note > 127) note = 127;
+    return kMidiFreq.hz[note];
+}
+
+// f * 2^octaves, exact: only the exponent field changes.
+// Falls back to ldexpf() for zero/denormal/inf or
+// if the result would leave the normal range.
+inline float ScaleOctaves(float f, int octaves)
+{
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    int e = (int)((bits >> 23) & 0xFF);
+    int n = e + octaves;
+    if(e == 0 || e == 255 || n <= 0 || n >= 255)
+        return ldexpf(f, octaves);
+    bits += (uint32_t)octaves << 23;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+} // namespace daisyex
+
+#endif
@@ -0,0 +1,265 @@
+/**********************************************************
+   scheduler.h
+   Small cooperative scheduler for the apps' main loops
+
+   Tasks run to completion in the main context, highest
+   priority first. A task is ready when
+     - its period has elapsed (periodic tasks), or
+     - Signal() was called for it (event tasks, ISR-safe)
+   and at least min_interval has passed since it last
+   started (caps e.g. the OLED frame rate).
+
+   Each release gets a deadline (default: one period, or
+   'deadline' after the signal). Finishing late, or having
+   a whole period pass before the task gets to run, counts
+   as a missed deadline. Run time per task is tracked as
+   runs / total / max in microseconds.
+
+   When nothing is ready the idle hook runs; by default it
+   is WFI on the M7, so the core sleeps until the next
+   interrupt (SysTick, audio DMA, MIDI timer, ...).
+   IdleUs() adds up the time spent in it, interrupts
+   taken on the way out included (idle_stats.h turns that
+   into a sleep fraction).
+**********************************************************/
+#pragma once
+#ifndef DAISYEX_SCHEDULER_H
+#define DAISYEX_SCHEDULER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+#if defined(DAISY_HOST)
+// utils/host: moves the simulated clock to the next interrupt
+namespace daisyhost
+{
+void WaitForInterrupt();
+}
+#endif
+
+namespace daisyex
+{
+// Sleep until the next interrupt
+inline void WaitForInterrupt()
+{
+#if defined(__arm__)
+    __asm__ volatile("wfi");
+#elif defined(DAISY_HOST)
+    daisyhost::WaitForInterrupt();
+#endif
+}
+
+template <size_t MaxTasks>
+class Scheduler
+{
+  public:
+    typedef void (*TaskFn)(void *ctx);
+    typedef uint32_t (*ClockFn)();
+    typedef void (*IdleFn)();
+
+    struct TaskStats
+    {
+        const char *name;
+        uint32_t    runs;
+        uint32_t    missed;   // deadlines missed
+        uint32_t    total_us; // wraps after ~71 min of run time
+        uint32_t    max_us;
+        uint32_t    last_us;
+    };
+
+    // now_us: free-running microsecond clock, e.g. System::GetUs
+    void Init(ClockFn now_us, IdleFn idle = WaitForInterrupt)
+    {
+        now_us_     = now_us;
+        idle_       = idle;
+        num_tasks_  = 0;
+        idle_loops_ = 0;
+        idle_us_    = 0;
+    }
+
+    // period_us > 0; deadline_us = 0 => one period
+    int AddPeriodic(const char *name,
+                    TaskFn      fn,
+                    uint32_t    period_us,
+                    uint8_t     priority,
+                    void *      ctx         = nullptr,
+                    uint32_t    deadline_us = 0)
+    {
+        int id = Add(name, fn, priority, ctx);
+        if(id < 0)
+            return id;
+        Task &t       = tasks_[id];
+        t.period_us   = period_us;
+        t.deadline_us = deadline_us ? deadline_us : period_us;
+        t.release_us  = now_us_() + period_us;
+        return id;
+    }
+
+    // runs only after Signal(); deadline measured from the signal
+    int AddEvent(const char *name,
+                 TaskFn      fn,
+                 uint8_t     priority,
+                 uint32_t    deadline_us,
+                 void *      ctx = nullptr)
+    {
+        int id = Add(name, fn, priority, ctx);
+        if(id < 0)
+            return id;
+        tasks_[id].deadline_us = deadline_us;
+        return id;
+    }
+
+    // lower bound between two starts of a task
+    void SetMinInterval(int id, uint32_t us)
+    {
+        tasks_[id].min_interval_us = us;
+    }
+
+    // ISR-safe; repeated signals before the task runs merge
+    void Signal(int id)
+    {
+        Task &t = tasks_[id];
+        if(!t.signaled.load(std::memory_order_relaxed))
+            t.signal_us = now_us_();
+        t.signaled.store(true, std::memory_order_release);
+    }
+
+    // Run the highest-priority ready task.
+    // Returns false if nothing was ready.
+    bool RunOnce()
+    {
+        uint32_t now  = now_us_();
+        int      best = -1;
+        for(size_t i = 0; i < num_tasks_; i++)
+        {
+            Task &t = tasks_[i];
+            if(!Ready(t, now))
+                continue;
+            if(best < 0 || t.priority > tasks_[best].priority)
+                best = (int)i;
+        }
+        if(best < 0)
+            return false;
+
+        Task &t = tasks_[best];
+
+        // which release are we serving?
+        uint32_t deadline;
+        if(t.signaled.load(std::memory_order_acquire))
+        {
+            t.signaled.store(false, std::memory_order_relaxed);
+            deadline = t.signal_us + t.deadline_us;
+            // this run also covers a periodic release that is due
+            if(t.period_us && (int32_t)(now - t.release_us) >= 0)
+                t.release_us = now + t.period_us;
+        }
+        else
+        {
+            deadline = t.release_us + t.deadline_us;
+            // skipped whole periods are missed releases
+            uint32_t late = now - t.release_us;
+            if(late >= t.period_us)
+            {
+                uint32_t skipped = late / t.period_us;
+                t.stats.missed += skipped;
+                t.release_us += skipped * t.period_us;
+                deadline = t.release_us + t.deadline_us;
+            }
+            t.release_us += t.period_us;
+        }
+
+        t.last_start_us = now;
+        t.fn(t.ctx);
+        uint32_t end = now_us_();
+        uint32_t ran = end - now;
+
+        t.stats.runs++;
+        t.stats.total_us += ran;
+        t.stats.last_us = ran;
+        if(ran > t.stats.max_us)
+            t.stats.max_us = ran;
+        if(t.deadline_us && (int32_t)(end - deadline) > 0)
+            t.stats.missed++;
+        return true;
+    }
+
+    // never returns, so main() can end with it
+    [[noreturn]] void Run()
+    {
+        while(1)
+        {
+            if(!RunOnce())
+            {
+                idle_loops_++;
+                uint32_t t0 = now_us_();
+                idle_();
+                idle_us_ += now_us_() - t0;
+            }
+        }
+    }
+
+    size_t           NumTasks() const { return num_tasks_; }
+    const TaskStats &Stats(int id) const { return tasks_[id].stats; }
+    uint32_t         IdleLoops() const { return idle_loops_; }
+    // wraps after ~71 min; take differences
+    uint32_t IdleUs() const { return idle_us_; }
+
+  private:
+    struct Task
+    {
+        TaskFn            fn;
+        void *            ctx;
+        uint8_t           priority;
+        uint32_t          period_us;   // 0 => event only
+        uint32_t          deadline_us; // relative; 0 => none
+        uint32_t          min_interval_us;
+        uint32_t          release_us; // next periodic release
+        uint32_t          signal_us;
+        uint32_t          last_start_us;
+        std::atomic<bool> signaled;
+        TaskStats         stats;
+    };
+
+    int Add(const char *name, TaskFn fn, uint8_t priority, void *ctx)
+    {
+        if(num_tasks_ >= MaxTasks)
+            return -1;
+        Task &t           = tasks_[num_tasks_];
+        t.fn              = fn;
+        t.ctx             = ctx;
+        t.priority        = priority;
+        t.period_us       = 0;
+        t.deadline_us     = 0;
+        t.min_interval_us = 0;
+        t.release_us      = 0;
+        t.signal_us       = 0;
+        t.last_start_us   = 0;
+        t.signaled.store(false);
+        t.stats = TaskStats{name, 0, 0, 0, 0, 0};
+        return (int)num_tasks_++;
+    }
+
+    bool Ready(Task &t, uint32_t now) const
+    {
+        bool due = t.signaled.load(std::memory_order_acquire)
+                   || (t.period_us && (int32_t)(now - t.release_us) >= 0);
+        if(!due)
+            return false;
+        if(t.min_interval_us && t.stats.runs
+           && now - t.last_start_us < t.min_interval_us)
+            return false;
+        return true;
+    }
+
+    Task     tasks_[MaxTasks];
+    size_t   num_tasks_;
+    ClockFn  now_us_;
+    IdleFn   idle_;
+    uint32_t idle_loops_;
+    uint32_t idle_us_;
+};
+
+} // namespace daisyex
+
+#endif
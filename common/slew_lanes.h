@@ -0,0 +1,101 @@
+/**********************************************************
+   slew_lanes.h
+   N slew limiters processed side by side
+
+   The apps' SlewLimiter moves value_ by diff/(time*sr)
+   per sample and snaps when that step overshoots, i.e.
+   a one-pole lag with k = min(1, 1/(time*sr)). With equal
+   rise/fall times every lane shares k, so a block of
+   voices is one branch-free multiply-add per lane.
+
+   Values are kept structure-of-arrays so the lane loop
+   vectorises on hosts with SIMD; on the M7 it is a tight
+   FMA loop with no per-voice branches.
+
+   ProcessBlock(n) advances n samples at once in closed
+   form (k_n = 1 - (1 - k)^n), for destinations that only
+   change at block boundaries; pair it with LinearRamp
+   (param_ramp.h) to interpolate inside the block.
+**********************************************************/
+#pragma once
+#ifndef DAISYEX_SLEW_LANES_H
+#define DAISYEX_SLEW_LANES_H
+
+#include <stddef.h>
+#include <math.h>
+
+namespace daisyex
+{
+template <size_t N>
+class SlewLanes
+{
+  public:
+    void Init(float samplerate)
+    {
+        sr_      = samplerate;
+        k_       = 1.f;
+        block_n_      = 0;
+        block_from_k_ = 1.f;
+        block_k_      = 1.f;
+        for(size_t i = 0; i < N; i++)
+        {
+            value_[i] = 0.f;
+            dest_[i]  = 0.f;
+        }
+    }
+
+    // same time for rise and fall, in seconds
+    void SetTime(float t)
+    {
+        float n = t * sr_;
+        k_      = (n > 1.f) ? 1.f / n : 1.f;
+    }
+
+    void SetValue(size_t lane, float v)
+    {
+        value_[lane] = v;
+        dest_[lane]  = v;
+    }
+    void SetDest(size_t lane, float d) { dest_[lane] = d; }
+    // move a lane without touching its destination
+    void SetCurrent(size_t lane, float v) { value_[lane] = v; }
+
+    // advance all lanes by one sample
+    void Process()
+    {
+        const float k = k_;
+        for(size_t i = 0; i < N; i++)
+            value_[i] += (dest_[i] - value_[i]) * k;
+    }
+
+    // advance all lanes by n samples (same result as n
+    // Process() calls while the destinations hold still)
+    void ProcessBlock(size_t n)
+    {
+        if(n != block_n_ || k_ != block_from_k_)
+        {
+            block_n_      = n;
+            block_from_k_ = k_;
+            block_k_      = 1.f - powf(1.f - k_, (float)n);
+        }
+        const float k = block_k_;
+        for(size_t i = 0; i < N; i++)
+            value_[i] += (dest_[i] - value_[i]) * k;
+    }
+
+    float        Value(size_t lane) const { return value_[lane]; }
+    const float *Values() const { return value_; }
+
+  private:
+    float  sr_;
+    float  k_;
+    size_t block_n_; // ProcessBlock() coefficient cache
+    float  block_from_k_;
+    float  block_k_;
+    float  value_[N];
+    float  dest_[N];
+};
+
+} // namespace daisyex
+
+#endif
@@ -0,0 +1,100 @@
+/**********************************************************
+   tcm.h
+   Tags for placing hot code in ITCM and hot state in DTCM
+
+   The H750 runs code from ITCM and reads DTCM at core
+   speed with no wait states and no cache in the way; flash
+   code and AXI SRAM data go through the L1 caches, so a
+   miss in the audio callback costs flash wait states or
+   an AXI round trip. Tag what the callback touches:
+
+       DAISYEX_ITCM static void AudioCallback(...);
+       static FractalNoise1D g_noise DAISYEX_DTCM;
+
+   and build with a placement:
+
+       make TCM=3        (see the app Makefile)
+
+   TCM  code      data
+    0   flash     AXI SRAM   (libDaisy's layout, default)
+    1   ITCM      AXI SRAM
+    2   flash     DTCM
+    3   ITCM      DTCM
+
+   TCM=1..3 links with daisy_tcm.lds and defines
+   DAISYEX_TCM; otherwise, and on the host, the tags are
+   empty. The apps' PROFILE_LOG report starts with
+   TcmPlacement(), so the callback cycles of each build can
+   be compared side by side.
+
+   DAISYEX_DTCM objects are zeroed and DAISYEX_DTCM_DATA
+   ones copied by TcmStartup(), a constructor that runs
+   before the default-priority ones, so objects with
+   constructors work. DMA can't reach DTCM: keep DMA
+   buffers out of it. Include from one translation unit
+   (the apps are one .cpp each).
+**********************************************************/
+#pragma once
+#ifndef DAISYEX_TCM_H
+#define DAISYEX_TCM_H
+
+#include <stdint.h>
+
+#ifndef DAISYEX_TCM
+#define DAISYEX_TCM 0
+#endif
+
+#if defined(__arm__) && (DAISYEX_TCM & 1)
+// long_call: ITCM (0x0000_0000) is out of BL range of flash
+#define DAISYEX_ITCM __attribute__((section(".itcm_text"), long_call))
+#else
+#define DAISYEX_ITCM
+#endif
+
+#if defined(__arm__) && (DAISYEX_TCM & 2)
+#define DAISYEX_DTCM __attribute__((section(".dtcm_bss")))
+#define DAISYEX_DTCM_DATA __attribute__((section(".dtcm_data")))
+#else
+#define DAISYEX_DTCM
+#define DAISYEX_DTCM_DATA
+#endif
+
+namespace daisyex
+{
+inline const char *TcmPlacement()
+{
+#if defined(__arm__)
+    static const char *const kNames[4] = {"tcm 0 flash+axi",
+                                          "tcm 1 itcm+axi",
+                                          "tcm 2 flash+dtcm",
+                                          "tcm 3 itcm+dtcm"};
+    return kNames[DAISYEX_TCM & 3];
+#else
+    return "tcm host";
+#endif
+}
+
+#if defined(__arm__) && DAISYEX_TCM
+// symbols from daisy_tcm.lds
+extern "C" uint32_t _siitcm_text, _sitcm_text, _eitcm_text;
+extern "C" uint32_t _sidtcm_data, _sdtcm_data, _edtcm_data;
+extern "C" uint32_t _sdtcm_bss, _edtcm_bss;
+
+__attribute__((constructor(101))) static void TcmStartup()
+{
+    const uint32_t *src = &_siitcm_text;
+    for(uint32_t *dst = &_sitcm_text; dst < &_eitcm_text;)
+        *dst++ = *src++;
+    src = &_sidtcm_data;
+    for(uint32_t *dst = &_sdtcm_data; dst < &_edtcm_data;)
+        *dst++ = *src++;
+    for(uint32_t *dst = &_sdtcm_bss; dst < &_edtcm_bss;)
+        *dst++ = 0;
+    // new code in ITCM: drain writes before it is fetched
+    __asm__ volatile("dsb\n\tisb" ::: "memory");
+}
+#endif
+
+} // namespace daisyex
+
+#endif
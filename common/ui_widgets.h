@@ -0,0 +1,202 @@
+/**********************************************************
+   ui_widgets.h
+   Retained-mode OLED layer with dirty tracking
+
+   Screens are built once from widgets:
+     - text widgets: fixed position, font and width in
+       characters; SetText() marks dirty only if the
+       string actually changed
+     - region widgets: a rectangle drawn by a callback
+       (plots etc.), marked dirty by the app. With
+       clear = false the rectangle isn't wiped first, so
+       the callback can update it incrementally (e.g. an
+       overlay on top of another region)
+   Render() clears and redraws only the dirty widgets and
+   calls display.Update() only when something was drawn,
+   so an unchanged frame costs a few strcmp()s instead of
+   a full redraw and SPI transfer.
+
+   Display is the libDaisy OledDisplay type, Font is
+   FontDef (templated so this header stays hardware-free).
+**********************************************************/
+#pragma once
+#ifndef DAISYEX_UI_WIDGETS_H
+#define DAISYEX_UI_WIDGETS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+namespace daisyex
+{
+template <typename Display, typename Font, size_t MaxWidgets>
+class RetainedUi
+{
+  public:
+    typedef void (*DrawFn)(Display &display, void *ctx);
+
+    struct Stats
+    {
+        uint32_t frames_drawn;   // frames sent to the display
+        uint32_t frames_skipped; // Render() calls with nothing dirty
+        uint32_t widgets_drawn;
+    };
+
+    static const size_t  kMaxText = 24;
+    static const uint8_t kWidth   = 128; // SSD1306 columns
+
+    void Init()
+    {
+        num_   = 0;
+        stats_ = Stats{0, 0, 0};
+    }
+
+    // text widget, 'chars' wide (longer text is cut there);
+    // returns its id
+    int AddText(uint8_t x, uint8_t y, const Font &font, uint8_t chars)
+    {
+        if(num_ >= MaxWidgets)
+            return -1;
+        // WriteString() drops characters that don't fit
+        uint32_t width = chars * font.FontWidth;
+        if(x + width > kWidth)
+            width = kWidth - x;
+        Widget &w = w_[num_];
+        w.x       = x;
+        w.y       = y;
+        w.w       = (uint8_t)width;
+        w.h       = font.FontHeight;
+        w.font    = &font;
+        w.draw    = nullptr;
+        w.ctx     = nullptr;
+        w.clear   = true;
+        w.text[0] = 0;
+        w.dirty   = true;
+        return (int)num_++;
+    }
+
+    // custom-drawn rectangle; returns its id
+    int AddRegion(uint8_t x,
+                  uint8_t y,
+                  uint8_t w,
+                  uint8_t h,
+                  DrawFn  fn,
+                  void *  ctx,
+                  bool    clear = true)
+    {
+        if(num_ >= MaxWidgets)
+            return -1;
+        Widget &r = w_[num_];
+        r.x       = x;
+        r.y       = y;
+        r.w       = w;
+        r.h       = h;
+        r.font    = nullptr;
+        r.draw    = fn;
+        r.ctx     = ctx;
+        r.clear   = clear;
+        r.text[0] = 0;
+        r.dirty   = true;
+        return (int)num_++;
+    }
+
+    void SetText(int id, const char *text)
+    {
+        Widget &w = w_[id];
+        if(strncmp(w.text, text, kMaxText - 1) == 0)
+            return;
+        // bounded copy; longer text is cut at kMaxText - 1
+        size_t n = 0;
+        while(n < kMaxText - 1 && text[n])
+            n++;
+        memcpy(w.text, text, n);
+        w.text[n] = 0;
+        w.dirty   = true;
+    }
+
+    void Invalidate(int id) { w_[id].dirty = true; }
+    void InvalidateAll()
+    {
+        for(size_t i = 0; i < num_; i++)
+            w_[i].dirty = true;
+    }
+
+    bool IsDirty() const
+    {
+        for(size_t i = 0; i < num_; i++)
+            if(w_[i].dirty)
+                return true;
+        return false;
+    }
+
+    // Redraw dirty widgets; returns true if the display was updated
+    bool Render(Display &display)
+    {
+        if(!IsDirty())
+        {
+            stats_.frames_skipped++;
+            return false;
+        }
+        for(size_t i = 0; i < num_; i++)
+        {
+            Widget &w = w_[i];
+            if(!w.dirty)
+                continue;
+            if(w.clear && w.w > 0 && w.h > 0)
+                display.DrawRect(
+                    w.x, w.y, w.x + w.w - 1, w.y + w.h - 1, false, true);
+            if(w.draw)
+            {
+                w.draw(display, w.ctx);
+            }
+            else
+            {
+                // only the characters inside the cleared
+                // rectangle, so none is left behind later
+                char   text[kMaxText];
+                size_t n = w.w / w.font->FontWidth;
+                size_t k = 0;
+                for(; k < n && w.text[k]; k++)
+                    text[k] = w.text[k];
+                text[k] = 0;
+                display.SetCursor(w.x, w.y);
+                display.WriteString(text, *w.font, true);
+            }
+            w.dirty = false;
+            stats_.widgets_drawn++;
+        }
+        display.Update();
+        stats_.frames_drawn++;
+        return true;
+    }
+
+    const Stats &GetStats() const { return stats_; }
+
+    // percentage of Render() calls that were skipped
+    uint32_t SkippedPercent() const
+    {
+        uint32_t total = stats_.frames_drawn + stats_.frames_skipped;
+        return total ? (uint32_t)((uint64_t)stats_.frames_skipped * 100 / total)
+                     : 0;
+    }
+
+  private:
+    struct Widget
+    {
+        uint8_t     x, y, w, h;
+        const Font *font; // null for regions
+        DrawFn      draw;
+        void *      ctx;
+        bool        clear; // wipe the rect before drawing
+        char        text[kMaxText];
+        bool        dirty;
+    };
+
+    Widget w_[MaxWidgets];
+    size_t num_;
+    Stats  stats_;
+};
+
+} // namespace daisyex
+
+#endif
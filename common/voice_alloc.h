@@ -0,0 +1,183 @@
+/**********************************************************
+   voice_alloc.h
+   Fixed-size MIDI voice allocator
+
+   - Up to N voices, polyphony can be lowered at run time
+     (SetPolyphony(1) gives the old single-note behaviour)
+   - A retriggered key reuses its own voice
+   - Otherwise the longest-free voice is used, and when
+     all are busy the oldest sounding voice is stolen
+   - Keeps simple counters so apps can show steals etc.
+**********************************************************/
+#pragma once
+#ifndef DAISYEX_VOICE_ALLOC_H
+#define DAISYEX_VOICE_ALLOC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace daisyex
+{
+template <size_t N>
+class VoiceAllocator
+{
+  public:
+    struct Stats
+    {
+        uint32_t note_ons;   // NoteOns handled
+        uint32_t steals;     // NoteOns that took a sounding voice
+        uint32_t retriggers; // NoteOns for a key already sounding
+        uint8_t  peak;       // most voices sounding at once
+    };
+
+    void Init()
+    {
+        for(size_t i = 0; i < N; i++)
+        {
+            note_[i] = 0;
+            on_[i]   = false;
+            age_[i]  = 0;
+        }
+        clock_ = 0;
+        poly_  = N;
+        stats_ = Stats{0, 0, 0, 0};
+    }
+
+    // number of voices in use, 1..N
+    void SetPolyphony(size_t n)
+    {
+        if(n < 1) n = 1;
+        if(n > N) n = N;
+        poly_ = n;
+        // release voices that are now out of range
+        for(size_t i = poly_; i < N; i++)
+            on_[i] = false;
+    }
+    size_t Polyphony() const { return poly_; }
+
+    // Returns the voice index to (re)start for this key.
+    // 'stolen' is set when a different sounding key was cut.
+    int NoteOn(uint8_t note, bool &stolen)
+    {
+        stolen = false;
+        stats_.note_ons++;
+        clock_++;
+
+        int slot = -1;
+        // same key already sounding => retrigger it
+        for(size_t i = 0; i < poly_; i++)
+        {
+            if(on_[i] && note_[i] == note)
+            {
+                slot = (int)i;
+                stats_.retriggers++;
+                break;
+            }
+        }
+        // longest-free voice
+        if(slot < 0)
+        {
+            uint32_t best = 0;
+            for(size_t i = 0; i < poly_; i++)
+            {
+                uint32_t idle = clock_ - age_[i];
+                if(!on_[i] && (slot < 0 || idle > best))
+                {
+                    slot = (int)i;
+                    best = idle;
+                }
+            }
+        }
+        // steal the oldest sounding voice
+        if(slot < 0)
+        {
+            uint32_t best = 0;
+            for(size_t i = 0; i < poly_; i++)
+            {
+                uint32_t held = clock_ - age_[i];
+                if(slot < 0 || held > best)
+                {
+                    slot = (int)i;
+                    best = held;
+                }
+            }
+            stolen = true;
+            stats_.steals++;
+        }
+
+        note_[slot] = note;
+        on_[slot]   = true;
+        age_[slot]  = clock_;
+
+        uint8_t active = (uint8_t)NumActive();
+        if(active > stats_.peak)
+            stats_.peak = active;
+        return slot;
+    }
+
+    // Returns the voice that was released, or -1
+    int NoteOff(uint8_t note)
+    {
+        for(size_t i = 0; i < poly_; i++)
+        {
+            if(on_[i] && note_[i] == note)
+            {
+                Release(i);
+                return (int)i;
+            }
+        }
+        return -1;
+    }
+
+    // voice ended on its own (e.g. a fixed-length note)
+    void Release(size_t voice)
+    {
+        if(voice >= N || !on_[voice])
+            return;
+        clock_++;
+        on_[voice]  = false;
+        age_[voice] = clock_;
+    }
+
+    bool    IsOn(size_t voice) const { return on_[voice]; }
+    uint8_t Note(size_t voice) const { return note_[voice]; }
+
+    size_t NumActive() const
+    {
+        size_t n = 0;
+        for(size_t i = 0; i < N; i++)
+            n += on_[i] ? 1 : 0;
+        return n;
+    }
+
+    // most recently started voice that is still on, or -1
+    int Newest() const
+    {
+        int      slot = -1;
+        uint32_t best = 0;
+        for(size_t i = 0; i < poly_; i++)
+        {
+            uint32_t held = clock_ - age_[i];
+            if(on_[i] && (slot < 0 || held < best))
+            {
+                slot = (int)i;
+                best = held;
+            }
+        }
+        return slot;
+    }
+
+    const Stats &GetStats() const { return stats_; }
+
+  private:
+    uint8_t  note_[N];
+    bool     on_[N];
+    uint32_t age_[N]; // clock_ value of the last start/release
+    uint32_t clock_;
+    size_t   poly_;
+    Stats    stats_;
+};
+
+} // namespace daisyex
+
+#endif
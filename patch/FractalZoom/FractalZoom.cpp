@@ -13,143 +13,79 @@
    - Knob2 => Slew Time in [0..1s]
    - Knob3 => VCA amplitude
 
+   Encoder press => Poly / Mono
+
    Each Note On => we read the current ZoomFactor/ZoomPoint,
-   store them. Then for the next 5s, we evaluate:
+   store them in a voice. Then for the next 5s, we evaluate:
        fBm((time + zoomPoint)*zoomFactor)
    in the audio callback. This fractal value is then mapped to
    a frequency domain for pitch, and we slews for a smooth effect.
 
-   If performance is too high, you can reduce calls to fBm by
-   stepping at a lower rate or reducing octaves.
+   Poly: up to 4 voices, each with its own zoom snapshot;
+   voice n plays on out n. Mono: one voice, all four
+   oscillators mixed on every out (the original behaviour).
+
+   fBm is evaluated once per audio block for all active voices
+   in a single batched call (see fractal_voices.h). If
+   performance is too high, reduce octaves.
+
+   FBM_TABLE=1 builds (see the Makefile) read fBm from a
+   table baked on the host and flashed to QSPI instead
+   (fbm_table.h); the splash says which one is running.
 
 ***************************************************************/
 
 #include "daisysp.h"
 #include "daisy_patch.h"
+#include "audio_profile.h"
+#include "control_snapshot.h"
+#include "cycle_profiler.h"
+#include "event_queue.h"
+#include "fbm_table.h"
+#include "fractal_voices.h"
+#include "gate_out.h"
+#include "idle_stats.h"
+#include "latency_histogram.h"
+#include "param_ramp.h"
+#include "scheduler.h"
+#include "tcm.h"
+#include "oled_spi_dma.h"
+#include "ui_widgets.h"
 #include <cmath>
+#include <cstdio>
+#include <cstring>
 
 //--------------------------------------------------
 // Namespaces
 //--------------------------------------------------
 using namespace daisy;
 using namespace daisysp;
+using namespace daisyex;
 
 //--------------------------------------------------
-// We'll implement a 1D Perlin + fBm approach
-// - We'll keep a static permutation table
-// - We'll define PerlinNoise1D()
-// - We'll define fBm1D()
-//--------------------------------------------------
-
-static uint8_t s_perm[512]; // we fill this at init
-
-// A standard reference permutation for 256 values:
-static const uint8_t s_permRef[256] = {
-    151,160,137,91,90,15,131,13,201,95,96,53,194,233,7,225,
-    140,36,103,30,69,142,8,99,37,240,21,10,23,190, 6,148,
-    247,120,234,75, 0,26,197,62,94,252,219,203,117,35,11,32,
-    57,177,33, 88,237,149,56,87,174,20,125,136,171,168, 68,
-    175, 74,165,71,134,139,48,27,166,77,146,158,231, 83,111,
-    229,122,60,211,133,230,220,105,92,41,55,46,245,40,244,
-    102,143,54, 65,25,63,161, 1,216,80,73,209,76,132,187,
-    208, 89,18,169,200,196,135,130,116,188,159,86,164,100,
-    109,198,173,186, 3,64,52,217,226,250,124,123, 5,202,
-    38,147,118,126,255,82,85,212,207,206,59,227,47,16,58,
-    17,182,189,28,42,223,183,170,213,119,248,152,  2,44,
-    154,163,70,221,153,101,155,167, 43,172,  9,129,22,39,
-    253,19, 98,108,110,79,113,224,232,178,185,112,104,218,
-    246,97,228,251,34,242,193,238,210,144,12,191,179,162,
-    241,81,51,145,235,249,14,239,107, 49,192,214,31,181,
-    199,106,157,184,84,204,176,115,121, 50,45,127,  4,
-    150,254,138,236,205,93,222,114,67,29,24,72,243,141,
-    128,195,78,66,215
-};
-
-static void InitPerlinPermutation()
-{
-    // Duplicate s_permRef[] in s_perm[] 2x
-    for(int i = 0; i < 256; i++)
-    {
-        s_perm[i]       = s_permRef[i];
-        s_perm[i+256]   = s_permRef[i];
-    }
-}
-
-// Fade function: 6t^5 - 15t^4 + 10t^3
-static inline float Fade(float t)
-{
-    return t*t*t*(t*(t*6.f -15.f)+10.f);
-}
-
-// We only need a 1D gradient => sign flip
-static inline float Grad1D(int hash, float x)
-{
-    // If (hash & 1) => +x else => -x
-    return ((hash & 1) ? x : -x);
-}
-
-// Return noise in range ~[-1..1]
-static float PerlinNoise1D(float x)
-{
-    int xi   = (int)floorf(x);
-    float xf = x - (float)xi;
-    int X    = xi & 255;
-
-    float u = Fade(xf);
-
-    int hashA = s_perm[X];
-    int hashB = s_perm[X+1];
-
-    float g1 = Grad1D(hashA, xf);
-    float g2 = Grad1D(hashB, xf - 1.f);
-
-    float val = (1.f - u)*g1 + u*g2;
-    return val;
-}
-
-// Simple fBm with ~4..6 octaves typical
-static float fBm1D(float x, int octaves, float lacunarity, float gain)
-{
-    float sum  = 0.f;
-    float freq = 1.f;
-    float amp  = 1.f;
-
-    for(int i = 0; i < octaves; i++)
-    {
-        float p = PerlinNoise1D(x * freq);
-        sum += p * amp;
-        freq *= lacunarity;
-        amp  *= gain;
-    }
-    return sum;
-}
+// 1D Perlin + fBm lives in fbm.h (shared with pod)
+//--------------------------------------------------
+static FractalNoise1D g_noise DAISYEX_DTCM;
 
 //--------------------------------------------------
-// We'll define a small "ActiveNote" with a 5s duration
-// (You can make it user-adjustable easily).
+// Voices: each NoteOn gets a 5s note with its own
+// zoom snapshot (fractal_voices.h)
 //--------------------------------------------------
-struct ActiveNote
-{
-    bool  on;
-    float phase;      // 0..duration
-    float duration;   // default 5s
-};
+static const size_t kNumVoices = 4;
 
-static ActiveNote g_note = {false, 0.f, 5.f};
+static FractalVoices<kNumVoices> g_voices DAISYEX_DTCM;
+static volatile bool             g_polyOn = true; // applied in the audio callback
 
 //--------------------------------------------------
-// Gate pin
+// Gate out (PA10): high while any note sounds, a NoteOn
+// retriggers it; edges land on their sample (gate_out.h)
 //--------------------------------------------------
-static dsy_gpio gatePin;
-static void SetGate(bool high)
-{
-    dsy_gpio_write(&gatePin, high);
-}
+static GateOut g_gate;
 
 //--------------------------------------------------
 // We'll define 4 oscillators for demonstration
 //--------------------------------------------------
-static Oscillator osc[4];
+static Oscillator osc[4] DAISYEX_DTCM;
 
 //--------------------------------------------------
 // Daisy hardware
@@ -157,136 +93,102 @@ static Oscillator osc[4];
 static DaisyPatch      patch;
 static MidiUartHandler midi;
 
-// We'll define a pitch slew for the final freq
-class SlewLimiter
-{
-  public:
-    void Init(float samplerate)
-    {
-        sr_    = samplerate;
-        value_ = 0.f;
-        dest_  = 0.f;
-        rise_  = 0.01f;
-        fall_  = 0.01f;
-    }
-    void SetRiseTime(float t) { rise_ = t; }
-    void SetFallTime(float t) { fall_ = t; }
-    void SetValue(float v)    { value_ = v; dest_ = v; }
-    void SetDest(float d)     { dest_  = d; }
-
-    float Process()
-    {
-        float diff = dest_ - value_;
-        if(diff > 0.f)
-        {
-            float step = diff / (rise_ * sr_);
-            if(fabsf(step) > fabsf(diff))
-                value_ = dest_;
-            else
-                value_ += step;
-        }
-        else if(diff < 0.f)
-        {
-            float step = diff / (fall_ * sr_);
-            if(fabsf(step) > fabsf(diff))
-                value_ = dest_;
-            else
-                value_ += step;
-        }
-        return value_;
-    }
-
-  private:
-    float sr_;
-    float value_;
-    float dest_;
-    float rise_;
-    float fall_;
-};
-
-static SlewLimiter pitchSlew;
-
 //--------------------------------------------------
-// For demonstration, let's do a simple "quantize"
-// mapping fractal value in [-N..+N] => freq in [50..2000]
-//
-// If you want 12TET or Just, you can adapt the "Randos"
-// approach: turn the fractVal => semitone => freq
+// Knobs, acquired once per audio block and readable
+// from any context (control_snapshot.h)
 //--------------------------------------------------
-static float QuantizeFractal(float val)
-{
-    // val in ~[-2..+2] if we have e.g. 4..5 octaves
-    // clamp
-    if(val < -2.f) val = -2.f;
-    if(val >  2.f) val =  2.f;
-    // shift to [0..4]
-    float shifted = val + 2.f; // now in [0..4]
-    // map [0..4] => [50..2000] or any range you like
-    float freq = 50.f + shifted * (1950.f/4.f); // [50..2000]
-    return freq;
-}
+static Snapshot<PatchControls> g_controls;
 
 //--------------------------------------------------
 // We'll define "zoomFactor" and "zoomPoint"
 // that we read from knobs on NOTE ON.
+// (audio callback only; the OLED gets them via g_view)
 //--------------------------------------------------
 static float g_zoomFactor = 1.f;
 static float g_zoomPoint  = 0.f; // in [0..5]
 
+// What the OLED draws, published by the audio callback
+// once per block so the curve and the playhead always
+// come from the same voice (control_snapshot.h)
+struct ViewState
+{
+    float zoomFactor, zoomPoint; // newest voice's, or the last NoteOn's
+    float phase;                 // seconds into its note, < 0 = none
+};
+static Snapshot<ViewState> g_view;
+
 // fBm parameters
 static int   g_octaves    = 5;    // you can make this user adjustable
 static float g_lacunarity = 2.f;
 static float g_gain       = 0.5f;
 
+//--------------------------------------------------
+// Baked fBm in memory-mapped QSPI (FBM_TABLE builds):
+// 'make FBM_TABLE=1' builds a BOOT_SRAM app,
+// 'make program-fbm-table' bakes and flashes the table
+// to FBM_TABLE_ADDR. A missing or stale table (other
+// settings, bad CRC) is refused and fBm is computed.
+//--------------------------------------------------
+#ifndef FBM_TABLE
+#define FBM_TABLE 0
+#endif
+#ifndef FBM_TABLE_ADDR
+#define FBM_TABLE_ADDR 0x90400000
+#endif
+static FbmTable g_fbmTable;
+
+static inline float EvalFbm(float x)
+{
+    if(g_fbmTable.Matches(g_octaves, g_lacunarity, g_gain))
+        return g_fbmTable.Eval(x);
+    return g_noise.FBm(x, g_octaves, g_lacunarity, g_gain);
+}
+
 //--------------------------------------------------
 // MIDI handling:
-//   - If we get NoteOn, we start a new "5s fractal"
-//     using the current zoom knobs.
+//   - A 4 kHz timer interrupt parses the UART bytes,
+//     timestamps and queues events, so NoteOns no longer
+//     wait for the OLED redraw + 50ms main loop delay.
+//   - The audio callback applies them at their sample
+//     offset (event_queue.h). On NoteOn we start a new
+//     "5s fractal" using the current zoom knobs.
 //--------------------------------------------------
+static SpscQueue<NoteEvent, 64> g_events;
+static BlockEvents<16>          g_blockEvents;
+static TimerHandle              midiTimer;
+static const uint32_t           kMidiPollHz = 4000;
+
+// NoteOn => sound latency, 0.1 ms bins up to 25.6 ms
+static LatencyHistogram<256> g_noteLatency;
+
 static void HandleMidi(MidiUartHandler &m)
 {
     while(m.HasEvents())
     {
-        auto msg = m.PopEvent();
+        auto      msg = m.PopEvent();
+        NoteEvent ev;
+        ev.channel = msg.channel;
+        ev.data0   = msg.data[0] & 0x7F;
+        ev.data1   = msg.data[1] & 0x7F;
+        ev.time_us = System::GetUs();
         switch(msg.type)
         {
             case NoteOn:
-            {
-                uint8_t n   = msg.data[0] & 0x7F;
-                uint8_t vel = msg.data[1] & 0x7F;
-                if(vel > 0)
-                {
-                    g_note.on    = true;
-                    g_note.phase = 0.f;
-                    // read knob0 => zoom factor in [1..3]
-                    {
-                        float k0 = patch.controls[0].Process(); // 0..1
-                        // let's do 1 * (3^(k0)) => [1..3]
-                        g_zoomFactor = powf(3.f, k0);
-                    }
-                    // read knob1 => zoom point in [0..5]
-                    {
-                        float k1 = patch.controls[1].Process(); // 0..1
-                        g_zoomPoint = k1 * 5.f;
-                    }
-
-                    SetGate(true);
-                }
-                else
-                {
-                    // velocity=0 => note off
-                    g_note.on = false;
-                    SetGate(false);
-                }
-            }
-            break;
+                // velocity=0 => note off
+                ev.type = ev.data1 > 0 ? NoteEvent::NOTE_ON
+                                       : NoteEvent::NOTE_OFF;
+                g_events.Push(ev);
+                break;
 
             case NoteOff:
-            {
-                g_note.on = false;
-                SetGate(false);
-            }
-            break;
+                ev.type = NoteEvent::NOTE_OFF;
+                g_events.Push(ev);
+                break;
+
+            case ControlChange:
+                ev.type = NoteEvent::CC;
+                g_events.Push(ev);
+                break;
 
             default:
                 break;
@@ -294,6 +196,116 @@ static void HandleMidi(MidiUartHandler &m)
     }
 }
 
+// timer interrupt
+static void MidiTimerCallback(void *data)
+{
+    midi.Listen();
+    HandleMidi(midi);
+}
+
+// audio callback only, at sample offset i
+static void ApplyEvent(const NoteEvent &ev, size_t i)
+{
+    switch(ev.type)
+    {
+        case NoteEvent::NOTE_ON:
+        {
+            // knobs as acquired at the start of this block
+            PatchControls ctl = g_controls.Read();
+            // read knob0 => zoom factor in [1..3]
+            {
+                float k0 = ctl.knob[0]; // 0..1
+                // let's do 1 * (3^(k0)) => [1..3]
+                g_zoomFactor = powf(3.f, k0);
+            }
+            // read knob1 => zoom point in [0..5]
+            {
+                float k1 = ctl.knob[1]; // 0..1
+                g_zoomPoint = k1 * 5.f;
+            }
+            g_voices.NoteOn(ev.data0, g_zoomFactor, g_zoomPoint);
+        }
+        break;
+
+        case NoteEvent::NOTE_OFF: g_voices.NoteOff(ev.data0); break;
+
+        case NoteEvent::CC:
+            // 120 = All Sound Off, 123 = All Notes Off
+            if(ev.data0 == 120 || ev.data0 == 123)
+                g_voices.AllNotesOff();
+            break;
+
+        default: return; // clock events aren't queued here
+    }
+    if(ev.type == NoteEvent::NOTE_ON)
+        g_gate.Retrigger(i);
+    else
+        g_gate.Set(i, g_voices.AnyOn());
+}
+
+//--------------------------------------------------
+// Per-block parameter ramps (param_ramp.h): the VCA
+// gain ramps across each block, and the oscillators get a
+// new frequency per sample only while a voice's pitch is
+// gliding; otherwise once at the block boundary.
+//--------------------------------------------------
+static LinearRamp g_ampRamp;
+
+//--------------------------------------------------
+// Profiling (cycle_profiler.h): callback load shows on
+// the OLED status line. Build with
+//   C_DEFS += -DPROFILE_LOG=1
+// to also print per-section cycles and the load
+// histogram over USB (Logger) every 5s.
+//--------------------------------------------------
+#ifndef PROFILE_LOG
+#define PROFILE_LOG 0
+#endif
+static CycleProfiler<4> g_prof;
+static int              g_secFbm, g_secOsc, g_secVca;
+
+// silent blocks and main-loop sleep (idle_stats.h),
+// over one-second windows
+static IdleStats g_idle;
+
+// Measurement mode (audio_profile.h, make MEASURE=1):
+// round trip through a cable from out 4 to in 1, callback
+// overhead and headroom over USB every 2s
+#ifndef AUDIO_MEASURE
+#define AUDIO_MEASURE 0
+#endif
+#if AUDIO_MEASURE
+static AudioMeasure g_measure;
+#endif
+
+// end of every callback
+static void PublishView()
+{
+    ViewState vs = {g_zoomFactor, g_zoomPoint, -1.f};
+    int       v  = g_voices.Newest();
+    if(v >= 0)
+    {
+        vs.zoomFactor = g_voices.ZoomFactor(v);
+        vs.zoomPoint  = g_voices.ZoomPoint(v);
+        vs.phase      = g_voices.Phase(v);
+    }
+    g_view.Publish(vs);
+}
+
+static void SetOscFreqs(size_t poly)
+{
+    if(poly > 1)
+    {
+        for(size_t v = 0; v < kNumVoices; v++)
+            osc[v].SetFreq(g_voices.Freq(v));
+    }
+    else
+    {
+        for(int c=0; c<4; c++)
+            osc[c].SetFreq(g_voices.Freq(0));
+    }
+}
+
 //--------------------------------------------------
 // Audio callback
 //   knobs:
@@ -303,52 +315,118 @@ static void HandleMidi(MidiUartHandler &m)
 //    - knob2 => slew time
 //    - knob3 => amplitude
 //--------------------------------------------------
+DAISYEX_ITCM
 static void AudioCallback(AudioHandle::InputBuffer  in,
                           AudioHandle::OutputBuffer out,
                           size_t                    size)
 {
-    patch.ProcessAnalogControls();
+    g_prof.BeginCallback();
+    g_gate.BeginBlock(size);
+
+    // events queued since the last block
+    g_blockEvents.BeginBlock(System::GetUs());
+    g_blockEvents.Collect(g_events, size);
+
+    // the only place the analog controls are processed
+    static uint32_t block = 0;
+    PatchControls   ctl;
+    AcquirePatchControls(patch, block++, ctl);
+    g_controls.Publish(ctl);
+
+    // Poly/Mono from the UI
+    size_t poly = g_polyOn ? kNumVoices : 1;
+    if(g_voices.Polyphony() != poly)
+    {
+        g_voices.SetPolyphony(poly);
+        g_gate.Set(0, g_voices.AnyOn());
+    }
 
-    float slewK = patch.controls[2].Process(); // [0..1]
-    float ampK  = patch.controls[3].Process(); // [0..1]
+    float slewK = ctl.knob[2]; // [0..1]
+    float ampK  = ctl.knob[3]; // [0..1]
 
     // set pitch slew times
-    pitchSlew.SetRiseTime(slewK * 1.f);
-    pitchSlew.SetFallTime(slewK * 1.f);
+    g_voices.SetSlewTime(slewK * 1.f);
 
-    float sr = patch.AudioSampleRate();
-    float inc = 1.f / sr; // each sample => +1/sr
+    // NoteOns due at the very start of the block go in
+    // before the batch so they sound from their offset
+    NoteEvent ev;
+    while(g_blockEvents.Due(0, ev))
+    {
+        ApplyEvent(ev, 0);
+        if(ev.type == NoteEvent::NOTE_ON)
+            g_noteLatency.Record(g_blockEvents.LatencyUs(ev, 0, size));
+    }
+
+    // one batched fBm evaluation for all active voices,
+    // pitch ramps for the whole block
+    FbmParams fp = {g_octaves, g_lacunarity, g_gain};
+    g_prof.Begin(g_secFbm);
+    g_voices.BeginBlock(fp, size);
+    g_prof.End(g_secFbm);
+    SetOscFreqs(poly);
 
+    // amplitude ramps from the last block's knob value
+    g_ampRamp.Begin(ampK, size);
+
+    // Silent block: no voice on and no event due. One
+    // memset per output instead of the oscillator loop
+    if(!g_voices.AnyOn() && g_blockEvents.Count() == 0)
+    {
+        g_voices.Skip(size);
+        for(size_t c = 0; c < 4; c++)
+            memset(out[c], 0, size * sizeof(float));
+        PublishView();
+        g_idle.Block(true);
+        g_prof.EndCallback();
+        return;
+    }
+
+    g_prof.Begin(g_secOsc);
     for(size_t i = 0; i < size; i++)
     {
-        float sig = 0.f;
-        if(g_note.on)
+        while(g_blockEvents.Due(i, ev))
         {
-            // increment
-            g_note.phase += inc;
-            // If we pass 5s, end
-            if(g_note.phase >= g_note.duration)
+            ApplyEvent(ev, i);
+            // a new voice needs its first fractal value now
+            if(ev.type == NoteEvent::NOTE_ON)
             {
-                g_note.on = false;
-                SetGate(false);
+                g_voices.BeginBlock(fp, size - i);
+                SetOscFreqs(poly);
+                g_noteLatency.Record(g_blockEvents.LatencyUs(ev, i, size));
             }
-            else
-            {
-                // real-time fBm
-                // domain = ( (phase + zoomPoint) * zoomFactor )
-                float domainX = (g_note.phase + g_zoomPoint) * g_zoomFactor;
-
-                // evaluate fractal
-                float fractVal = fBm1D(domainX, g_octaves, g_lacunarity, g_gain);
+        }
 
-                // quantize => freq
-                float freq = QuantizeFractal(fractVal);
-                pitchSlew.SetDest(freq);
-                float freqNow = pitchSlew.Process();
+        // advance phases; a voice past its 5s ends here
+        if(g_voices.Process() && !g_voices.AnyOn())
+            g_gate.Set(i, false);
 
-                // set 4 oscillators
-                for(int c=0; c<4; c++)
-                    osc[c].SetFreq(freqNow);
+        if(poly > 1)
+        {
+            // voice n => osc n => out n
+            for(size_t v = 0; v < kNumVoices; v++)
+            {
+                float sig = 0.f;
+                if(g_voices.IsOn(v))
+                {
+                    if(g_voices.Gliding(v))
+                        osc[v].SetFreq(g_voices.Freq(v));
+                    sig = osc[v].Process();
+                }
+                out[v][i] = sig;
+            }
+        }
+        else
+        {
+            float sig = 0.f;
+            if(g_voices.IsOn(0))
+            {
+                // set 4 oscillators while the pitch moves
+                if(g_voices.Gliding(0))
+                {
+                    float freqNow = g_voices.Freq(0);
+                    for(int c=0; c<4; c++)
+                        osc[c].SetFreq(freqNow);
+                }
 
                 // produce audio
                 float s0 = osc[0].Process();
@@ -356,18 +434,55 @@ static void AudioCallback(AudioHandle::InputBuffer  in,
                 float s2 = osc[2].Process();
                 float s3 = osc[3].Process();
                 // mix them
-                float mix = (s0 + s1 + s2 + s3)*0.25f;
-                sig = mix * ampK;
+                sig = (s0 + s1 + s2 + s3)*0.25f;
             }
+            out[0][i] = sig;
+            out[1][i] = sig;
+            out[2][i] = sig;
+            out[3][i] = sig;
         }
-
-        out[0][i] = sig;
-        out[1][i] = sig;
-        out[2][i] = sig;
-        out[3][i] = sig;
     }
+
+    g_prof.End(g_secOsc);
+
+    // VCA: one multiply pass per output
+    g_prof.Begin(g_secVca);
+    for(size_t c = 0; c < 4; c++)
+        g_ampRamp.Multiply(out[c], size);
+    g_prof.End(g_secVca);
+
+    PublishView();
+    g_idle.Block(false);
+    g_prof.EndCallback();
 }
 
+#if AUDIO_MEASURE
+// the app, then the loopback click on out 4
+static void MeasureCallback(AudioHandle::InputBuffer  in,
+                            AudioHandle::OutputBuffer out,
+                            size_t                    size)
+{
+    AudioCallback(in, out, size);
+    g_measure.Process(in[0], out[3], size);
+}
+#endif
+
+//--------------------------------------------------
+// Main-loop tasks (scheduler.h)
+//   ctrl => encoder, 1 kHz
+//   oled => fractal plot, every 50 ms (20 fps)
+//   idle => idle/sleep figures, 1 Hz
+//   (+ prof, meas with PROFILE_LOG / AUDIO_MEASURE)
+//--------------------------------------------------
+static Scheduler<5> g_sched;
+static int          g_oledTask;
+
+// The app's OLED: double-buffered, only changed pages go
+// out over SPI DMA (oled_spi_dma.h). patch.display is
+// only used for the splash screen before this takes over.
+static uint8_t DMA_BUFFER_MEM_SECTION g_oledFront[PatchOledDriver::kBufferSize];
+static PatchOled                      g_oled;
+
 //--------------------------------------------------
 // We'll do a small function to draw the fractal
 // on the OLED in near-real-time, just like before.
@@ -375,26 +490,38 @@ static void AudioCallback(AudioHandle::InputBuffer  in,
 // We'll sample ~32 points from t=0..5,
 // do fBm((t + zoomPoint)*zoomFactor), and draw lines.
 //--------------------------------------------------
-static void DrawFractalOnOled()
+// Retained widgets (ui_widgets.h): the title, the curve
+// and the status line are redrawn only when they change.
+//
+// The curve is computed into a cache only when a NoteOn
+// picked up new zoom knobs; redraws use the cached points.
+// The playhead (newest voice's position in its note) is
+// an overlay: moving it erases the old column, redraws the
+// few cached curve segments it crossed and draws the new
+// column, so a steady-state frame costs no fBm at all.
+static RetainedUi<PatchOled, FontDef, 4> g_ui;
+static int   w_title, w_curve, w_playhead, w_status;
+static float g_drawnFactor = -1.f, g_drawnPoint = -1.f;
+
+// We'll pick 32 steps from 0..5
+static const int kCurveSteps  = 32;
+static const int kCurveTop    = 12;
+static const int kCurveBottom = 52;
+
+static uint8_t g_curveX[kCurveSteps], g_curveY[kCurveSteps];
+static bool    g_curveRedrawn = false;
+static int     g_playheadX    = -1; // column on screen, -1 = none
+static int     g_playheadNext = -1;
+
+static void UpdateCurveCache()
 {
-    patch.display.Fill(false);
-
-    patch.display.SetCursor(0,0);
-    patch.display.WriteString("fBm FractalZoom", Font_7x10, true);
-
-    // We'll pick 32 steps from 0..5
-    const int steps = 32;
-    float stepSize  = 5.f / (steps-1);
-
-    int lastX = 0;
-    int lastY = 32;
-
-    for(int i=0; i<steps; i++)
+    float stepSize = 5.f / (kCurveSteps-1);
+    for(int i=0; i<kCurveSteps; i++)
     {
         float t = i*stepSize;
         // domain
-        float domainX = (t + g_zoomPoint) * g_zoomFactor;
-        float val = fBm1D(domainX, g_octaves, g_lacunarity, g_gain);
+        float domainX = (t + g_drawnPoint) * g_drawnFactor;
+        float val = EvalFbm(domainX);
         // val in ~[-2..2], shift => [0..4], then => 0..1
         float mapped = (val + 2.f)*0.25f;
         if(mapped < 0.f) mapped=0.f;
@@ -402,42 +529,222 @@ static void DrawFractalOnOled()
 
         // screen x ~ [0..127], let's do i in [0..31]
         // screen y ~ [0..63]
-        int x = (int)((float)i * (128.f / (steps-1)));
-        int y = (int)((1.f - mapped) * 40.f) + 12; // shift so it's visible
+        int x = (int)((float)i * (128.f / (kCurveSteps-1)));
+        // shift so it's visible
+        int y = (int)((1.f - mapped) * 40.f) + kCurveTop;
+        if(x > 127) x = 127;
+        g_curveX[i] = (uint8_t)x;
+        g_curveY[i] = (uint8_t)y;
+    }
+}
 
-        // draw line from last => current
-        patch.display.DrawLine(lastX, lastY, x, y, true);
+// line from point i-1 => i (point -1 is the old (0,32) start)
+static void DrawCurveSegment(PatchOled &display, int i)
+{
+    int x0 = i > 0 ? g_curveX[i - 1] : 0;
+    int y0 = i > 0 ? g_curveY[i - 1] : 32;
+    display.DrawLine(x0, y0, g_curveX[i], g_curveY[i], true);
+}
+
+static void DrawCurve(PatchOled &display, void *ctx)
+{
+    for(int i=0; i<kCurveSteps; i++)
+        DrawCurveSegment(display, i);
+    g_curveRedrawn = true;
+}
 
-        lastX = x;
-        lastY = y;
+static void DrawPlayhead(PatchOled &display, void *ctx)
+{
+    // erase the old column unless the curve was just redrawn
+    // (that already wiped it), then repair the curve there
+    if(g_playheadX >= 0 && !g_curveRedrawn)
+    {
+        display.DrawLine(
+            g_playheadX, kCurveTop, g_playheadX, kCurveBottom, false);
+        for(int i=0; i<kCurveSteps; i++)
+        {
+            int x0 = i > 0 ? g_curveX[i - 1] : 0;
+            if(x0 <= g_playheadX && g_playheadX <= g_curveX[i])
+                DrawCurveSegment(display, i);
+        }
     }
+    // dotted, so the curve stays visible underneath
+    if(g_playheadNext >= 0)
+        for(int y = kCurveTop; y <= kCurveBottom; y += 2)
+            display.DrawPixel(g_playheadNext, y, true);
 
-    patch.display.Update();
+    g_playheadX    = g_playheadNext;
+    g_curveRedrawn = false;
+}
+
+static void InitOled()
+{
+    g_ui.Init();
+    w_title    = g_ui.AddText(0, 0, Font_7x10, 15);
+    w_curve    = g_ui.AddRegion(0, 10, 128, 44, DrawCurve, nullptr);
+    w_playhead = g_ui.AddRegion(0, 10, 128, 44, DrawPlayhead, nullptr, false);
+    w_status   = g_ui.AddText(0, 54, Font_6x8, 21);
+    g_ui.SetText(w_title, "fBm FractalZoom");
+    PatchOled::Config cfg;
+    cfg.driver_config.front_buffer = g_oledFront;
+    g_oled.Init(cfg); // panel is cleared by the first Render()
+}
+
+static void DrawFractalOnOled()
+{
+    // one consistent copy of the callback's view
+    ViewState vs = g_view.Read();
+    if(vs.zoomFactor != g_drawnFactor || vs.zoomPoint != g_drawnPoint)
+    {
+        g_drawnFactor = vs.zoomFactor;
+        g_drawnPoint  = vs.zoomPoint;
+        UpdateCurveCache();
+        g_ui.Invalidate(w_curve);
+        g_ui.Invalidate(w_playhead);
+    }
+
+    // playhead follows the newest voice (the one whose zoom
+    // snapshot is on screen); same t => x mapping as the curve
+    g_playheadNext = -1;
+    if(vs.phase >= 0.f)
+    {
+        int x = (int)(vs.phase * (128.f / 5.f));
+        g_playheadNext = x < 127 ? x : 127;
+    }
+    if(g_playheadNext != g_playheadX)
+        g_ui.Invalidate(w_playhead);
+
+    // bottom line rotates every 2s: voice / stealing
+    // metrics, NoteOn latency, callback load, idle/current
+    // saved, OLED task
+    char buf[32];
+    switch((System::GetNow() / 2000) % 5)
+    {
+        case 0:
+        {
+            auto m = g_voices.GetMetrics();
+            snprintf(buf,
+                     sizeof(buf),
+                     "%s %u/%u st%lu pk%u",
+                     g_polyOn ? "Poly" : "Mono",
+                     (unsigned)m.active,
+                     (unsigned)g_voices.Polyphony(),
+                     (unsigned long)m.alloc.steals,
+                     (unsigned)m.alloc.peak);
+        }
+        break;
+
+        case 1:
+        {
+            uint32_t p50 = g_noteLatency.Percentile(0.5f) / 100; // 0.1 ms
+            uint32_t p99 = g_noteLatency.Percentile(0.99f) / 100;
+            snprintf(buf,
+                     sizeof(buf),
+                     "p50 %lu.%lu p99 %lu.%lums",
+                     (unsigned long)(p50 / 10),
+                     (unsigned long)(p50 % 10),
+                     (unsigned long)(p99 / 10),
+                     (unsigned long)(p99 % 10));
+        }
+        break;
+
+        case 2:
+            TextWriter(buf, sizeof(buf))
+                .Str("cpu avg ")
+                .Uint(g_prof.AvgLoad())
+                .Str("% max ")
+                .Uint(g_prof.MaxLoad())
+                .Char('%');
+            break;
+
+        case 3:
+            // silent blocks, estimated core current saved
+            TextWriter(buf, sizeof(buf))
+                .Str("idle ")
+                .Uint(g_idle.IdlePercent())
+                .Str("% saves ")
+                .Uint((uint32_t)(g_idle.SavedMa() + 0.5f))
+                .Str("mA");
+            break;
+
+        default:
+        {
+            auto &st = g_sched.Stats(g_oledTask);
+            snprintf(buf,
+                     sizeof(buf),
+                     "oled %lums skip %lu%%",
+                     (unsigned long)(st.max_us / 1000),
+                     (unsigned long)g_ui.SkippedPercent());
+        }
+        break;
+    }
+    g_ui.SetText(w_status, buf);
+
+    g_ui.Render(g_oled);
+}
+
+static void ControlsTask(void *ctx)
+{
+    // encoder press => Poly / Mono
+    patch.ProcessDigitalControls();
+    if(patch.encoder.RisingEdge())
+    {
+        g_polyOn = !g_polyOn;
+        g_sched.Signal(g_oledTask);
+    }
+}
+
+static void OledTask(void *ctx)
+{
+    // draw fractal on OLED
+    DrawFractalOnOled();
+}
+
+static void IdleTask(void *ctx)
+{
+    g_idle.Update(System::GetUs(), g_sched.IdleUs(), g_prof.AvgLoad());
 }
 
+#if AUDIO_MEASURE
+static void MeasureTask(void *ctx)
+{
+    g_measure.Report(g_prof,
+                     [](const char *line) { DaisySeed::PrintLine("%s", line); });
+}
+#endif
+
+#if PROFILE_LOG
+static void ProfileLogTask(void *ctx)
+{
+    DaisySeed::PrintLine("%s", TcmPlacement());
+#if FBM_TABLE
+    DaisySeed::PrintLine(g_fbmTable.Valid() ? "fbm table" : "fbm computed");
+#endif
+    g_prof.Report([](const char *line) { DaisySeed::PrintLine("%s", line); });
+    g_idle.Report([](const char *line) { DaisySeed::PrintLine("%s", line); });
+}
+#endif
+
 //--------------------------------------------------
 // Main
 //--------------------------------------------------
 int main(void)
 {
     patch.Init();
+    ApplyAudioProfile(patch);
     float sr = patch.AudioSampleRate();
 
-    // gate pin
-    dsy_gpio_pin gateP = {DSY_GPIOA, 10};
-    gatePin.pin  = gateP;
-    gatePin.mode = DSY_GPIO_MODE_OUTPUT_PP;
-    gatePin.pull = DSY_GPIO_NOPULL;
-    dsy_gpio_init(&gatePin);
-    SetGate(false);
+    // gate out, low
+    g_gate.Init(GateOut::Config(), sr);
 
     // MIDI
     MidiUartHandler::Config midi_cfg;
     midi.Init(midi_cfg);
     midi.StartReceive();
+    g_noteLatency.Init(100);
 
     // init perlin table
-    InitPerlinPermutation();
+    g_noise.Init();
 
     // init oscillators
     for(int i=0; i<4; i++)
@@ -449,30 +756,75 @@ int main(void)
                                     Oscillator::WAVE_SAW);
         osc[i].SetAmp(1.f);
     }
-    // init slew
-    pitchSlew.Init(sr);
-    pitchSlew.SetValue(220.f);
+    // init voices (slews start at 220 Hz)
+    g_voices.Init(sr, &g_noise);
+#if FBM_TABLE
+    if(g_fbmTable.Init((const void *)FBM_TABLE_ADDR,
+                       g_octaves,
+                       g_lacunarity,
+                       g_gain))
+        g_voices.SetTable(&g_fbmTable);
+#endif
+    g_ampRamp.Init(0.f);
+    g_blockEvents.Init(sr);
+
+    // block deadline in CPU cycles
+    g_prof.Init(System::GetSysClkFreq(), sr, patch.AudioBlockSize());
+    g_secFbm = g_prof.AddSection("fbm");
+    g_secOsc = g_prof.AddSection("osc", true);
+    g_secVca = g_prof.AddSection("vca", true);
+    g_idle.Init();
+#if AUDIO_MEASURE
+    g_measure.Init(sr, patch.AudioBlockSize());
+#endif
+#if PROFILE_LOG || AUDIO_MEASURE
+    patch.seed.StartLog(false);
+#endif
 
     // splash
     patch.display.Fill(false);
     patch.display.SetCursor(0,0);
     patch.display.WriteString("FractalZoom fBm", Font_7x10, true);
+#if FBM_TABLE
+    patch.display.SetCursor(0, 12);
+    patch.display.WriteString(g_fbmTable.Valid() ? "fBm table" : "no table",
+                              Font_7x10,
+                              true);
+#endif
     patch.display.Update();
     patch.DelayMs(1000);
 
     // Start audio
     patch.StartAdc();
+#if AUDIO_MEASURE
+    patch.StartAudio(MeasureCallback);
+#else
     patch.StartAudio(AudioCallback);
-
-    while(1)
-    {
-        midi.Listen();
-        HandleMidi(midi);
-
-        // draw fractal on OLED
-        DrawFractalOnOled();
-
-        patch.DelayMs(50);
-    }
+#endif
+
+    // MIDI is serviced from a timer interrupt from here on
+    TimerHandle::Config tim_cfg;
+    tim_cfg.periph     = TimerHandle::Config::Peripheral::TIM_5;
+    tim_cfg.dir        = TimerHandle::Config::CounterDir::UP;
+    tim_cfg.enable_irq = true;
+    midiTimer.Init(tim_cfg);
+    midiTimer.SetPeriod(midiTimer.GetFreq() / kMidiPollHz);
+    midiTimer.SetCallback(MidiTimerCallback);
+    midiTimer.Start();
+
+    // Main loop: UI tasks, WFI when idle
+    InitOled();
+    g_sched.Init(System::GetUs);
+    g_sched.AddPeriodic("ctrl", ControlsTask, 1000, 2);
+    g_oledTask = g_sched.AddPeriodic("oled", OledTask, 50000, 1);
+    g_sched.SetMinInterval(g_oledTask, 33333);
+    g_sched.AddPeriodic("idle", IdleTask, 1000000, 0);
+#if PROFILE_LOG
+    g_sched.AddPeriodic("prof", ProfileLogTask, 5000000, 0);
+#endif
+#if AUDIO_MEASURE
+    g_sched.AddPeriodic("meas", MeasureTask, 2000000, 0);
+#endif
+    g_sched.Run();
     return 0;
 }
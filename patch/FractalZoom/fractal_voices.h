@@ -0,0 +1,307 @@
+/***************************************************************
+   fractal_voices.h
+   Polyphonic note engine for patch FractalZoom
+
+   Each NoteOn takes a voice (VoiceAllocator) and snapshots the
+   current zoomFactor/zoomPoint into it. The voice then plays
+   for 'duration' seconds (5s default) or until its NoteOff:
+       fBm((phase + zoomPoint) * zoomFactor)
+   quantized to a frequency and slewed per voice.
+
+   The fractal is evaluated once per block for all active
+   voices with one FBmBatch() call, so polyphony adds one
+   noise lookup per octave per voice per block rather than per
+   sample. The pitch slews then advance the whole block in
+   closed form and each voice's frequency is a linear ramp
+   across it (param_ramp.h); Gliding() tells the caller
+   whether the oscillator needs a new frequency per sample
+   or only at the block boundary.
+
+   Note time is counted in whole samples and each voice's
+   end is a SampleTimer (phase_clock.h), so a note lasts
+   exactly its duration however long the module has run;
+   the float phase += 1/sr this replaces ended a 60s note
+   seconds late.
+
+   With SetTable() pointing at a baked table for the
+   current fBm settings (fbm_table.h, FBM_TABLE builds)
+   the batch reads the table instead of the noise; any
+   other settings fall back to FBmBatch().
+***************************************************************/
+#pragma once
+#ifndef FRACTAL_VOICES_H
+#define FRACTAL_VOICES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include "fbm.h"
+#include "fbm_table.h"
+#include "param_ramp.h"
+#include "phase_clock.h"
+#include "slew_lanes.h"
+#include "tcm.h"
+#include "voice_alloc.h"
+
+namespace daisyex
+{
+//--------------------------------------------------
+// For demonstration, let's do a simple "quantize"
+// mapping fractal value in [-N..+N] => freq in [50..2000]
+//
+// If you want 12TET or Just, you can adapt the "Randos"
+// approach: turn the fractVal => semitone => freq
+//--------------------------------------------------
+inline float QuantizeFractal(float val)
+{
+    // val in ~[-2..+2] if we have e.g. 4..5 octaves
+    // clamp
+    if(val < -2.f) val = -2.f;
+    if(val >  2.f) val =  2.f;
+    // shift to [0..4]
+    float shifted = val + 2.f; // now in [0..4]
+    // map [0..4] => [50..2000] or any range you like
+    float freq = 50.f + shifted * (1950.f/4.f); // [50..2000]
+    return freq;
+}
+
+// fBm parameters shared by all voices
+struct FbmParams
+{
+    int   octaves;
+    float lacunarity;
+    float gain;
+};
+
+template <size_t N>
+class FractalVoices
+{
+  public:
+    void Init(float samplerate, const FractalNoise1D *noise)
+    {
+        noise_    = noise;
+        table_    = nullptr;
+        sr_       = samplerate;
+        inc_      = 1.f / samplerate; // seconds per sample
+        now_      = 0;
+        SetDuration(5.f);
+        alloc_.Init();
+        slew_.Init(samplerate);
+        for(size_t v = 0; v < N; v++)
+        {
+            start_[v]  = 0;
+            active_[v] = 0.f;
+            end_[v].Stop();
+            zoomF_[v]  = 1.f;
+            zoomP_[v]  = 0.f;
+            slew_.SetValue(v, 220.f);
+            freq_[v].Init(220.f);
+        }
+        pos_     = 0;
+        batches_ = 0;
+        evals_   = 0;
+        expired_ = 0;
+    }
+
+    void SetPolyphony(size_t n)
+    {
+        alloc_.SetPolyphony(n);
+        for(size_t v = alloc_.Polyphony(); v < N; v++)
+            Stop(v);
+    }
+    size_t Polyphony() const { return alloc_.Polyphony(); }
+
+    // baked fBm, used while it matches the FbmParams
+    void SetTable(const FbmTable *table) { table_ = table; }
+
+    // for the notes started from here on
+    void SetDuration(float seconds)
+    {
+        duration_   = seconds;
+        float n     = ceilf(seconds * sr_);
+        durSamples_ = n > 1.f ? (uint32_t)n : 1;
+    }
+    void SetSlewTime(float t) { slew_.SetTime(t); }
+
+    // start a voice with its own zoom snapshot
+    int NoteOn(uint8_t note, float zoomFactor, float zoomPoint)
+    {
+        bool stolen;
+        int  v     = alloc_.NoteOn(note, stolen);
+        start_[v]  = now_;
+        active_[v] = 1.f;
+        end_[v].FireIn(durSamples_);
+        zoomF_[v]  = zoomFactor;
+        zoomP_[v]  = zoomPoint;
+        return v;
+    }
+
+    int NoteOff(uint8_t note)
+    {
+        int v = alloc_.NoteOff(note);
+        if(v >= 0)
+            Stop(v);
+        return v;
+    }
+
+    // MIDI All Notes Off
+    void AllNotesOff()
+    {
+        for(size_t v = 0; v < N; v++)
+        {
+            if(alloc_.IsOn(v))
+                alloc_.Release(v);
+            Stop(v);
+        }
+    }
+
+    // Evaluate every active voice's fractal in one batch,
+    // set the slew destinations and ramp each voice's
+    // frequency over the next n samples. Called at the
+    // block start with n = blocksize, and again after a
+    // mid-block NoteOn with the samples left.
+    DAISYEX_ITCM void BeginBlock(const FbmParams &p, size_t n_samples)
+    {
+        // ramps restart from where the voices are now
+        for(size_t v = 0; v < N; v++)
+            slew_.SetCurrent(v, Freq(v));
+        pos_ = 0;
+
+        float  x[N];
+        float  val[N];
+        size_t idx[N];
+        size_t n = 0;
+        for(size_t v = 0; v < N; v++)
+        {
+            if(active_[v] == 0.f)
+                continue;
+            // domain = ( (phase + zoomPoint) * zoomFactor )
+            x[n]   = (Phase(v) + zoomP_[v]) * zoomF_[v];
+            idx[n] = v;
+            n++;
+        }
+        if(n > 0)
+        {
+            if(table_ && table_->Matches(p.octaves, p.lacunarity, p.gain))
+                table_->EvalBatch(x, val, n);
+            else
+                noise_->FBmBatch(
+                    x, val, n, p.octaves, p.lacunarity, p.gain);
+            for(size_t k = 0; k < n; k++)
+                slew_.SetDest(idx[k], QuantizeFractal(val[k]));
+            batches_++;
+            evals_ += n;
+        }
+
+        // slew the whole block at once, then interpolate
+        float start[N];
+        for(size_t v = 0; v < N; v++)
+            start[v] = slew_.Value(v);
+        slew_.ProcessBlock(n_samples);
+        for(size_t v = 0; v < N; v++)
+        {
+            // a settled slew creeps by fractions of an ulp;
+            // snap so the oscillator can keep its frequency
+            float end = slew_.Value(v);
+            if(fabsf(end - start[v]) < 1e-3f)
+                start[v] = end;
+            freq_[v].Begin(start[v], end, n_samples);
+        }
+    }
+
+    // Advance one sample. Returns true if a voice reached
+    // the end of its duration on this sample.
+    bool Process()
+    {
+        now_++;
+        bool ended = false;
+        for(size_t v = 0; v < N; v++)
+        {
+            // the sample that completes the duration ends it
+            if(end_[v].Tick())
+            {
+                active_[v] = 0.f;
+                alloc_.Release(v);
+                expired_++;
+                ended = true;
+            }
+        }
+
+        pos_++;
+        return ended;
+    }
+
+    // A block with no voice on: time moves on as n calls
+    // to Process() would, without the per-sample loop.
+    void Skip(size_t n_samples)
+    {
+        now_ += (uint32_t)n_samples;
+        pos_ += n_samples;
+    }
+
+    bool  IsOn(size_t v) const { return active_[v] != 0.f; }
+    bool  AnyOn() const { return alloc_.NumActive() > 0; }
+    int   Newest() const { return alloc_.Newest(); }
+    // frequency for the sample just processed
+    float Freq(size_t v) const
+    {
+        return pos_ > 0 ? freq_[v].At(pos_ - 1) : freq_[v].Start();
+    }
+    // false => Freq() is constant for the rest of the block
+    bool Gliding(size_t v) const { return !freq_[v].Flat(); }
+    // seconds into the note
+    float Phase(size_t v) const { return (float)(now_ - start_[v]) * inc_; }
+    // zoom knobs as snapshotted at the voice's NoteOn
+    float ZoomFactor(size_t v) const { return zoomF_[v]; }
+    float ZoomPoint(size_t v) const { return zoomP_[v]; }
+    float Duration() const { return duration_; }
+
+    // voice-stealing / load metrics
+    struct Metrics
+    {
+        typename VoiceAllocator<N>::Stats alloc;
+        uint32_t active;   // voices sounding now
+        uint32_t expired;  // voices that ran their full duration
+        uint32_t batches;  // FBmBatch calls
+        uint32_t evals;    // voice evaluations inside those batches
+    };
+
+    Metrics GetMetrics() const
+    {
+        Metrics m;
+        m.alloc   = alloc_.GetStats();
+        m.active  = (uint32_t)alloc_.NumActive();
+        m.expired = expired_;
+        m.batches = batches_;
+        m.evals   = evals_;
+        return m;
+    }
+
+  private:
+    void Stop(size_t v)
+    {
+        active_[v] = 0.f;
+        end_[v].Stop();
+    }
+
+    const FractalNoise1D *noise_;
+    const FbmTable *      table_;
+    VoiceAllocator<N>     alloc_;
+    SlewLanes<N>          slew_;
+    LinearRamp            freq_[N];   // per-block pitch ramps
+    size_t                pos_;       // samples into the ramps
+    uint32_t              now_;       // samples since Init()
+    uint32_t              start_[N];  // now_ at NoteOn
+    SampleTimer           end_[N];    // fires at the duration
+    float                 active_[N]; // 1 while sounding
+    float                 zoomF_[N];  // snapshot at NoteOn
+    float                 zoomP_[N];
+    float                 sr_, inc_;
+    float                 duration_;
+    uint32_t              durSamples_;
+    uint32_t              batches_, evals_, expired_;
+};
+
+} // namespace daisyex
+
+#endif
@@ -1,79 +1,197 @@
 #include "daisy_patch.h"
 #include "daisysp.h"
+#include "audio_profile.h"
+#include "pitch_tables.h"
+#include "control_snapshot.h"
+#include "cycle_profiler.h"
+#include "fixed_format.h"
+#include "idle_stats.h"
+#include "scheduler.h"
+#include "oled_spi_dma.h"
+#include "ui_widgets.h"
+#include "quantize_cv.h"
 #include <cstdio>
 #include <cmath>
+#include <cstring>
 
 using namespace daisy;
 using namespace daisysp;
+using namespace daisyex;
 
 DaisyPatch patch;
 
-// Global variables (updated in the audio callback)
-volatile float g_inputCV = 0.0f;
-volatile float g_eqCV    = 0.0f;
-volatile float g_justCV  = 0.0f;
-
-float QuantizeCV(float inputCV, bool useJustIntonation)
+// Updated in the audio callback; the OLED task reads a
+// consistent set through the snapshot (control_snapshot.h)
+struct CvState
 {
-    int octave = static_cast<int>(std::floor(inputCV));
-    float frac = inputCV - octave;
-    int semitoneIndex = static_cast<int>(std::round(frac * 12.0f));
-    if(semitoneIndex >= 12)
-    {
-        semitoneIndex = 0;
-        octave += 1;
-    }
-
-    if(!useJustIntonation)
-        return octave + (semitoneIndex / 12.0f);
-    else
-    {
-        static const float justRatios[12] = {
-            1.0f,          // Unison
-            16.0f/15.0f,   // minor 2nd
-            9.0f/8.0f,     // major 2nd
-            6.0f/5.0f,     // minor 3rd
-            5.0f/4.0f,     // major 3rd
-            4.0f/3.0f,     // perfect 4th
-            45.0f/32.0f,   // Tritone (one possibility)
-            3.0f/2.0f,     // perfect 5th
-            8.0f/5.0f,     // minor 6th
-            5.0f/3.0f,     // major 6th
-            9.0f/5.0f,     // minor 7th
-            15.0f/8.0f     // major 7th
-        };
-        float ratio = justRatios[semitoneIndex];
-        float justFracCV = std::log2(ratio);
-        return octave + justFracCV;
-    }
-}
+    float input, eq, just;
+};
+static Snapshot<CvState> g_cv;
+
+// Callback load in cycles (cycle_profiler.h)
+static CycleProfiler<3> g_prof;
+static int              g_secQuantize, g_secDac;
+
+// Blocks where neither quantized output moved, and
+// main-loop sleep (idle_stats.h), over one-second windows
+static IdleStats g_idle;
+
+// Measurement mode (audio_profile.h, make MEASURE=1):
+// round trip through a cable from out 4 to in 1, callback
+// overhead and headroom over USB every 2s. All of this
+// app's callback work is per block.
+#ifndef AUDIO_MEASURE
+#define AUDIO_MEASURE 0
+#endif
+#if AUDIO_MEASURE
+static AudioMeasure g_measure;
+#endif
 
 void AudioCallback(AudioHandle::InputBuffer in, AudioHandle::OutputBuffer out, size_t size)
 {
+    g_prof.BeginCallback();
     patch.ProcessAllControls();
     float knob_val = patch.GetKnobValue(DaisyPatch::CTRL_1);
     float inputCV = knob_val * 8.0f; // simulate 0-8V
+    g_prof.Begin(g_secQuantize);
     float eqCV   = QuantizeCV(inputCV, false);
     float justCV = QuantizeCV(inputCV, true);
-    g_inputCV = inputCV;
-    g_eqCV    = eqCV;
-    g_justCV  = justCV;
+    g_prof.End(g_secQuantize);
+    g_cv.Publish(CvState{inputCV, eqCV, justCV});
 
+    g_prof.Begin(g_secDac);
     // Map voltages to DAC code (assume 0-8V ~ 0-4095)
     uint16_t eqDac   = static_cast<uint16_t>(std::round((eqCV/8.0f)*4095.0f));
     uint16_t justDac = static_cast<uint16_t>(std::round((justCV/8.0f)*4095.0f));
-    patch.seed.dac.WriteValue(DacHandle::Channel::ONE, eqDac);
-    patch.seed.dac.WriteValue(DacHandle::Channel::TWO, justDac);
+    // the quantized outputs hold between knob moves: only
+    // write a channel when its code changes
+    static uint16_t lastEq = 0xFFFF, lastJust = 0xFFFF;
+    bool            idle   = eqDac == lastEq && justDac == lastJust;
+    if(eqDac != lastEq)
+        patch.seed.dac.WriteValue(DacHandle::Channel::ONE, eqDac);
+    if(justDac != lastJust)
+        patch.seed.dac.WriteValue(DacHandle::Channel::TWO, justDac);
+    lastEq   = eqDac;
+    lastJust = justDac;
+    g_prof.End(g_secDac);
+
+    // no audio: one memset per output
+    for(size_t c = 0; c < 4; c++)
+        memset(out[c], 0, size * sizeof(float));
+    g_idle.Block(idle);
+    g_prof.EndCallback();
+}
+
+#if AUDIO_MEASURE
+// the app, then the loopback click on out 4
+static void MeasureCallback(AudioHandle::InputBuffer  in,
+                            AudioHandle::OutputBuffer out,
+                            size_t                    size)
+{
+    AudioCallback(in, out, size);
+    g_measure.Process(in[0], out[3], size);
+}
+#endif
+
+// Main-loop tasks (scheduler.h): the OLED every 100 ms,
+// idle/sleep figures every second (+ measurement every
+// 2s), WFI in between
+static Scheduler<3> g_sched;
+static int          g_oledTask;
+
+// The app's OLED: double-buffered, only changed pages go
+// out over SPI DMA (oled_spi_dma.h). patch.display is
+// only used for the splash screen before this takes over.
+static uint8_t DMA_BUFFER_MEM_SECTION g_oledFront[PatchOledDriver::kBufferSize];
+static PatchOled                      g_oled;
+
+// Retained widgets (ui_widgets.h): a line is redrawn only
+// when its text changes, and a frame with no changes is
+// not sent to the display
+static RetainedUi<PatchOled, FontDef, 4> g_ui;
+static int w_in, w_eq, w_just, w_status;
+
+static void InitOled()
+{
+    g_ui.Init();
+    w_in     = g_ui.AddText(0, 0, Font_7x10, 12);
+    w_eq     = g_ui.AddText(0, 12, Font_7x10, 12);
+    w_just   = g_ui.AddText(0, 24, Font_7x10, 12);
+    w_status = g_ui.AddText(0, 54, Font_6x8, 21);
+    PatchOled::Config cfg;
+    cfg.driver_config.front_buffer = g_oledFront;
+    g_oled.Init(cfg); // panel is cleared by the first Render()
+}
+
+static void OledTask(void *ctx)
+{
+    char    buf[32];
+    CvState cv = g_cv.Read();
+
+    TextWriter(buf, sizeof(buf)).Str("In: ").Volts(cv.input);
+    g_ui.SetText(w_in, buf);
+
+    TextWriter(buf, sizeof(buf)).Str("Eq: ").Volts(cv.eq);
+    g_ui.SetText(w_eq, buf);
 
-    for(size_t i = 0; i < size; i++)
+    TextWriter(buf, sizeof(buf)).Str("Just: ").Volts(cv.just);
+    g_ui.SetText(w_just, buf);
+
+    // rotates every 2s: callback load, idle/current
+    // saved, OLED task stats
+    switch((System::GetNow() / 2000) % 3)
     {
-        out[0][i] = out[1][i] = out[2][i] = out[3][i] = 0.0f;
+        case 0:
+            TextWriter(buf, sizeof(buf))
+                .Str("cpu avg ")
+                .Uint(g_prof.AvgLoad())
+                .Str("% max ")
+                .Uint(g_prof.MaxLoad())
+                .Char('%');
+            break;
+
+        case 1:
+            TextWriter(buf, sizeof(buf))
+                .Str("idle ")
+                .Uint(g_idle.IdlePercent())
+                .Str("% saves ")
+                .Uint((uint32_t)(g_idle.SavedMa() + 0.5f))
+                .Str("mA");
+            break;
+
+        default:
+        {
+            auto &st = g_sched.Stats(g_oledTask);
+            snprintf(buf,
+                     sizeof(buf),
+                     "oled %lums skip %lu%%",
+                     (unsigned long)(st.max_us / 1000),
+                     (unsigned long)g_ui.SkippedPercent());
+        }
+        break;
     }
+    g_ui.SetText(w_status, buf);
+
+    g_ui.Render(g_oled);
+}
+
+static void IdleTask(void *ctx)
+{
+    g_idle.Update(System::GetUs(), g_sched.IdleUs(), g_prof.AvgLoad());
+}
+
+#if AUDIO_MEASURE
+static void MeasureTask(void *ctx)
+{
+    g_measure.Report(g_prof,
+                     [](const char *line) { DaisySeed::PrintLine("%s", line); });
 }
+#endif
 
 int main(void)
 {
     patch.Init();
+    ApplyAudioProfile(patch);
 
     // Write an initial message to the display before starting audio
     patch.display.Fill(false);
@@ -83,28 +201,31 @@ int main(void)
     patch.display.WriteString("Eq & Just", Font_7x10, true);
     patch.display.Update();
 
+    g_prof.Init(System::GetSysClkFreq(),
+                patch.AudioSampleRate(),
+                patch.AudioBlockSize());
+    g_secQuantize = g_prof.AddSection("quantize");
+    g_secDac      = g_prof.AddSection("dac");
+    g_idle.Init();
+#if AUDIO_MEASURE
+    g_measure.Init(patch.AudioSampleRate(), patch.AudioBlockSize());
+    patch.seed.StartLog(false);
+#endif
+
     patch.StartAdc();
+#if AUDIO_MEASURE
+    patch.StartAudio(MeasureCallback);
+#else
     patch.StartAudio(AudioCallback);
-
-    // Now update the display in the main loop (only text, no graphics)
-    while(1)
-    {
-        patch.display.Fill(false);
-        char buf[32];
-
-        patch.display.SetCursor(0, 0);
-        snprintf(buf, sizeof(buf), "In: %.2fV", g_inputCV);
-        patch.display.WriteString(buf, Font_7x10, true);
-
-        patch.display.SetCursor(0, 12);
-        snprintf(buf, sizeof(buf), "Eq: %.2fV", g_eqCV);
-        patch.display.WriteString(buf, Font_7x10, true);
-
-        patch.display.SetCursor(0, 24);
-        snprintf(buf, sizeof(buf), "Just: %.2fV", g_justCV);
-        patch.display.WriteString(buf, Font_7x10, true);
-
-        patch.display.Update();
-        patch.DelayMs(100);
-    }
+#endif
+
+    // Now update the display from the main loop (only text, no graphics)
+    InitOled();
+    g_sched.Init(System::GetUs);
+    g_oledTask = g_sched.AddPeriodic("oled", OledTask, 100000, 1);
+    g_sched.AddPeriodic("idle", IdleTask, 1000000, 0);
+#if AUDIO_MEASURE
+    g_sched.AddPeriodic("meas", MeasureTask, 2000000, 0);
+#endif
+    g_sched.Run();
 }
@@ -0,0 +1,43 @@
+/**********************************************************
+   quantize_cv.h
+   V/oct quantizer for JustInTone
+
+   Kept out of JustInTone.cpp so the host benchmarks
+   (utils/bench/dsp_bench.cpp) time the same code the
+   module runs.
+**********************************************************/
+#pragma once
+#ifndef QUANTIZE_CV_H
+#define QUANTIZE_CV_H
+
+#include <math.h>
+#include "pitch_tables.h"
+
+namespace daisyex
+{
+// inputCV in volts (1 V/oct) => the nearest semitone,
+// equal tempered or as the just ratio of that degree
+inline float QuantizeCV(float inputCV, bool useJustIntonation)
+{
+    int octave = static_cast<int>(floorf(inputCV));
+    float frac = inputCV - octave;
+    int semitoneIndex = static_cast<int>(roundf(frac * 12.0f));
+    if(semitoneIndex >= 12)
+    {
+        semitoneIndex = 0;
+        octave += 1;
+    }
+
+    if(!useJustIntonation)
+        return octave + (semitoneIndex / 12.0f);
+    else
+    {
+        // log2 of the just ratios is precomputed (pitch_tables.h)
+        float justFracCV = kJustChromatic12Log2[semitoneIndex];
+        return octave + justFracCV;
+    }
+}
+
+} // namespace daisyex
+
+#endif
@@ -2,10 +2,33 @@
    Randos.cpp
    Pseudo-random stepwise generator for Daisy Patch
    (Root in [None, C..B], plus Just On/Off, no ADSR)
+
+   Poly: up to RANDOS_VOICES voices (default 4). Voice n
+   plays on audio out (n % 4); CV1/CV2 follow the newest
+   voice. With Poly=OFF one voice drives all four outs.
+
+   Steps follow the rate knob, MIDI clock or gate in 1
+   ([Sync] mode, clock_sync.h).
 **********************************************************/
 
 #include "daisysp.h"
 #include "daisy_patch.h"
+#include "audio_profile.h"
+#include "clock_sync.h"
+#include "control_snapshot.h"
+#include "cycle_profiler.h"
+#include "event_queue.h"
+#include "fixed_format.h"
+#include "gate_out.h"
+#include "idle_stats.h"
+#include "latency_histogram.h"
+#include "param_ramp.h"
+#include "randos_voices.h"
+#include "scheduler.h"
+#include "tcm.h"
+#include "oled_spi_dma.h"
+#include "ui_widgets.h"
+#include <cstring>
 #include <string>
 
 // ----------------------------------------------------
@@ -13,84 +36,20 @@
 // ----------------------------------------------------
 using namespace daisy;
 using namespace daisysp;
+using namespace daisyex;
 
 // ----------------------------------------------------
-// A simple linear-congruential generator (LCG)
-// ----------------------------------------------------
-static uint32_t LCG_Next(uint32_t &seed)
-{
-    seed = seed * 1664525u + 1013904223u;
-    return seed;
-}
-static float Rand01(uint32_t &seed)
-{
-    uint32_t r = (LCG_Next(seed) >> 8);
-    return float(r) * (1.0f / 16777216.0f);
-}
-
-// ----------------------------------------------------
-// We'll store a single active note (MIDI-driven)
-// ----------------------------------------------------
-struct ActiveNote
-{
-    bool     on;
-    uint8_t  midinote;
-    uint32_t seed;
-    float    phase; // step logic accumulator
-};
-
-static ActiveNote g_note = {false, 0, 0, 0.f};
-
-// ----------------------------------------------------
-// Simple linear slew limiter for pitch/CV
+// Voices: 4 by default, 8 with C_DEFS += -DRANDOS_VOICES=8
+// (pairs of voices then share an output, each at half
+// level so the sum stays within full scale)
 // ----------------------------------------------------
-class SlewLimiter
-{
-  public:
-    void Init(float samplerate)
-    {
-        sr_    = samplerate;
-        value_ = 0.f;
-        dest_  = 0.f;
-        rise_  = 0.01f;
-        fall_  = 0.01f;
-    }
-    void SetRiseTime(float t) { rise_ = t; }
-    void SetFallTime(float t) { fall_ = t; }
-    void SetValue(float v)    { value_ = v; dest_ = v; }
-    void SetDest(float d)     { dest_  = d; }
-
-    float Process()
-    {
-        float diff = dest_ - value_;
-        if(diff > 0.f)
-        {
-            float step = diff / (rise_ * sr_);
-            if(fabsf(step) > fabsf(diff))
-                value_ = dest_;
-            else
-                value_ += step;
-        }
-        else if(diff < 0.f)
-        {
-            float step = diff / (fall_ * sr_);
-            if(fabsf(step) > fabsf(diff))
-                value_ = dest_;
-            else
-                value_ += step;
-        }
-        return value_;
-    }
+#ifndef RANDOS_VOICES
+#define RANDOS_VOICES 4
+#endif
+static const size_t kNumVoices = RANDOS_VOICES;
+static const float  kVoiceGain = 1.f / (float)((kNumVoices + 3) / 4);
 
-  private:
-    float sr_;
-    float value_;
-    float dest_;
-    float rise_;
-    float fall_;
-};
-
-static SlewLimiter pitchSlew, cvSlew1, cvSlew2;
+static RandosVoices<kNumVoices> g_voices DAISYEX_DTCM;
 
 // ----------------------------------------------------
 // Root choices: 0 => "None", 1=>C, 2=>C#, ..., 12=>B
@@ -102,46 +61,33 @@ static const char* ROOT_NAMES[13] = {
     "F#","G","G#","A","A#","B"
 };
 
-// We'll define major scale offsets for 12-TET major scale
-static const int MAJOR_OFFSETS[8] = {0,2,4,5,7,9,11,12};
-
-// We'll also define a Just Major scale (interval ratios)
-static float JUST_MAJOR[] = {
-    1.f,      // unison
-    9.f/8.f,  // major 2nd
-    5.f/4.f,  // major 3rd
-    4.f/3.f,  // perfect 4th
-    3.f/2.f,  // perfect 5th
-    5.f/3.f,  // major 6th
-    15.f/8.f, // major 7th
-    2.f       // octave
-};
-
 // ----------------------------------------------------
 // We'll keep these global state variables:
 //   g_rootIndex => 0..12 => "None", "C", "C#", etc.
 //   g_octRange  => in [0.5..6]
 //   g_justOn    => bool
-//   g_uiMode    => 0..3 => which UI param we are editing
+//   g_polyOn    => bool, all voices or just one
+//   g_uiMode    => 0..5 => which UI param we are editing
 // ----------------------------------------------------
 static int   g_rootIndex = 0;   // 0 => None, 1..12 => C..B
 static float g_octRange  = 1.f; // 0.5..6
 static bool  g_justOn    = false;
-static int   g_uiMode    = 0;   // 0=>root,1=>range,2=>just,3=>idle
+static volatile bool g_polyOn = true; // applied in the audio callback
+static int   g_uiMode    = 0;   // root,range,just,poly,sync,idle
 
 // ----------------------------------------------------
-// Gate output pin
+// Gate out (PA10): high while any key is held, a NoteOn
+// retriggers it. Edges are set from the audio callback at
+// a sample offset and written by a timer on that sample
+// (gate_out.h).
 // ----------------------------------------------------
-static dsy_gpio gatePin;
-static void SetGate(bool high)
-{
-    dsy_gpio_write(&gatePin, high);
-}
+static GateOut g_gate;
 
 // ----------------------------------------------------
-// Four oscillators for audio out
+// One oscillator per voice; voice n uses the waveform
+// of its output (sin, square, tri, saw)
 // ----------------------------------------------------
-static Oscillator osc[4];
+static Oscillator osc[kNumVoices] DAISYEX_DTCM;
 
 // ----------------------------------------------------
 // Daisy hardware objects
@@ -159,163 +105,262 @@ static uint16_t VoltsToDac(float volts)
     return (uint16_t)((volts / 5.f) * 4095.f);
 }
 
-// ----------------------------------------------------
-// MIDI->freq
-// ----------------------------------------------------
-static float MidiToFreq(int note)
+// Both CV outs, every sample as the lanes slew; a channel
+// is only written when its code changes, so a settled or
+// silent Randos leaves the DAC alone
+static void WriteCvOuts(float volts1, float volts2)
 {
-    return 440.f * powf(2.f, (note - 69.f) / 12.f);
+    static uint16_t last[2] = {0xFFFF, 0xFFFF};
+    uint16_t        code[2] = {VoltsToDac(volts1), VoltsToDac(volts2)};
+    const DacHandle::Channel ch[2]
+        = {DacHandle::Channel::ONE, DacHandle::Channel::TWO};
+    for(int c = 0; c < 2; c++)
+    {
+        if(code[c] == last[c])
+            continue;
+        patch.seed.dac.WriteValue(ch[c], code[c]);
+        last[c] = code[c];
+    }
 }
 
 // ----------------------------------------------------
-// Just scale around a "base frequency" derived from root
-// We'll treat baseFreq = MidiToFreq(48 + (rootIndex-1))
-//  if rootIndex>0, or just 220 if you prefer a standard A3.
-// Then we pick from JUST_MAJOR plus random octaves
-// up to g_octRange
+// MIDI->freq and the random pitch pickers live in
+// pitch_tables.h / randos_voices.h
 // ----------------------------------------------------
-static float JustRandomFreq(uint32_t &seed, float baseFreq)
-{
-    const int scaleSize = 8; // length of JUST_MAJOR
-    // pick one ratio
-    float r1 = Rand01(seed);
-    int   idx = (int)(r1 * scaleSize);
-    if(idx >= scaleSize) idx = scaleSize - 1;
-
-    // pick an integer octave in [0.. floor(g_octRange)]
-    float r2       = Rand01(seed);
-    int   maxOctI  = (int)g_octRange; // floor
-    int   octPicked = (int)(r2 * (maxOctI+1));
-    if(octPicked > maxOctI) octPicked = maxOctI;
-
-    float ratio = JUST_MAJOR[idx] * powf(2.f, (float)octPicked);
-    return baseFreq * ratio;
-}
 
 // ----------------------------------------------------
-// A function that picks a random frequency based on
-//   1) g_rootIndex: 0 => none, 1..12 => semitone root
-//   2) g_octRange
-//   3) g_justOn => if true, pick from a Just scale
-//                  else pick from a 12TET major scale
+// Step clock (clock_sync.h)
+//   Int  => the step rate knob, per voice from its NoteOn
+//   MIDI => MIDI clock, 24 per quarter, with Start/Stop/
+//           Continue; a step every 'pulses' clocks
+//   Gate => rising edges on gate in 1, 'steps' steps
+//           every 'pulses' edges
+//   Synced, all held voices step together. The [Sync]
+//   UI mode picks the entry and shows the jitter
+//   measurement (RMS jitter of the pulses and of the
+//   steps since the entry was picked).
 // ----------------------------------------------------
-static float RandomQuantizedFreq(uint32_t &seed)
+enum SyncSource
 {
-    // If root=0 => "None" => unquantized
-    if(g_rootIndex == 0)
-    {
-        // 50..2000 Hz
-        float r = Rand01(seed);
-        return 50.f + 1950.f * r;
-    }
+    SYNC_INT,
+    SYNC_MIDI,
+    SYNC_GATE,
+};
 
-    // else we have a root
-    int rootSemitone = (g_rootIndex - 1); // 0..11 => C..B
-    float baseFreq    = MidiToFreq(48 + rootSemitone);
-        // e.g. around C3 if rootSemitone=0 => C
+struct SyncMode
+{
+    const char *name;
+    SyncSource  source;
+    uint8_t     steps, pulses;
+};
 
-    // If "Just" is ON => pick from Just scale
-    if(g_justOn)
-    {
-        return JustRandomFreq(seed, baseFreq);
-    }
-    else
-    {
-        // 12TET major scale quant
-        // e.g. pick random semitones up to 12*g_octRange
-        float r = Rand01(seed);
-        float maxSemisF = 12.f * g_octRange;
-        float pickF     = r * maxSemisF;
-        int   pickI     = (int)pickF; // integer semitones
-        int   fullOct   = pickI / 12;
-        int   leftover  = pickI % 12;
-        if(leftover < 0) leftover += 12;
-
-        // snap leftover to major scale
-        int chosen = 0;
-        for(int i=0; i<8; i++)
-        {
-            if(MAJOR_OFFSETS[i] <= leftover)
-                chosen = MAJOR_OFFSETS[i];
-            else
-                break;
-        }
-        int totalSemis = fullOct * 12 + chosen + rootSemitone;
-        int midinote   = 48 + totalSemis; // ~C3-based
-        if(midinote < 0)   midinote = 0;
-        if(midinote > 127) midinote = 127;
-        return MidiToFreq(midinote);
-    }
-}
+static const SyncMode kSyncModes[] = {
+    {"Int", SYNC_INT, 1, 1},
+    {"MIDI 1/4", SYNC_MIDI, 1, 24},
+    {"MIDI 1/8", SYNC_MIDI, 1, 12},
+    {"MIDI 1/8T", SYNC_MIDI, 1, 8},
+    {"MIDI 1/16", SYNC_MIDI, 1, 6},
+    {"MIDI 1/16T", SYNC_MIDI, 1, 4},
+    {"MIDI 1/32", SYNC_MIDI, 1, 3},
+    {"Gate x1", SYNC_GATE, 1, 1},
+    {"Gate x2", SYNC_GATE, 2, 1},
+    {"Gate x4", SYNC_GATE, 4, 1},
+    {"Gate /2", SYNC_GATE, 1, 2},
+    {"Gate /4", SYNC_GATE, 1, 4},
+};
+static const int kNumSyncModes = sizeof(kSyncModes) / sizeof(kSyncModes[0]);
+
+static volatile int g_syncIndex = 0; // UI => audio callback, timer
+static ClockSync    g_clock DAISYEX_DTCM; // audio callback only
+static Snapshot<ClockSync::JitterStats> g_clockStats;
 
 // ----------------------------------------------------
 // MIDI handling
+//   A 4 kHz timer interrupt parses the UART bytes and
+//   timestamps/queues events; the audio callback owns
+//   the voices and applies each event at its sample
+//   offset (event_queue.h). The main loop never sees MIDI.
 // ----------------------------------------------------
+static SpscQueue<NoteEvent, 64> g_events;
+static BlockEvents<16>          g_blockEvents;
+static TimerHandle              midiTimer;
+static const uint32_t           kMidiPollHz = 4000;
+
+// NoteOn => sound latency, 0.1 ms bins up to 25.6 ms
+static LatencyHistogram<256> g_noteLatency;
+
 static void HandleMidi(MidiUartHandler &m)
 {
     while(m.HasEvents())
     {
-        auto msg = m.PopEvent();
+        auto      msg = m.PopEvent();
+        NoteEvent ev;
+        ev.channel = msg.channel;
+        ev.data0   = msg.data[0] & 0x7F;
+        ev.data1   = msg.data[1] & 0x7F;
+        ev.time_us = System::GetUs();
         switch(msg.type)
         {
             case NoteOn:
-            {
-                uint8_t n   = msg.data[0] & 0x7F;
-                uint8_t vel = msg.data[1] & 0x7F;
-                if(vel > 0)
-                {
-                    g_note.on       = true;
-                    g_note.midinote = n;
-                    // Deterministic seed
-                    g_note.seed     = (n * 12345u) + 99999u;
-                    g_note.phase    = 0.f;
-
-                    SetGate(true);
-                }
-                else
-                {
-                    // velocity=0 => note off
-                    if(g_note.midinote == n)
-                    {
-                        g_note.on = false;
-                        SetGate(false);
-                    }
-                }
-            }
-            break;
+                // velocity=0 => note off
+                ev.type = ev.data1 > 0 ? NoteEvent::NOTE_ON
+                                       : NoteEvent::NOTE_OFF;
+                g_events.Push(ev);
+                break;
 
             case NoteOff:
-            {
-                uint8_t n = msg.data[0] & 0x7F;
-                if(g_note.on && g_note.midinote == n)
+                ev.type = NoteEvent::NOTE_OFF;
+                g_events.Push(ev);
+                break;
+
+            case ControlChange:
+                ev.type = NoteEvent::CC;
+                g_events.Push(ev);
+                break;
+
+            case SystemRealTime:
+                switch(msg.srt_type)
                 {
-                    g_note.on = false;
-                    SetGate(false);
+                    case SystemRealTimeType::TimingClock:
+                        ev.type = NoteEvent::CLOCK;
+                        break;
+                    case SystemRealTimeType::Start:
+                        ev.type = NoteEvent::START;
+                        break;
+                    case SystemRealTimeType::Continue:
+                        ev.type = NoteEvent::CONTINUE;
+                        break;
+                    case SystemRealTimeType::Stop:
+                        ev.type = NoteEvent::STOP;
+                        break;
+                    default: continue;
                 }
-            }
-            break;
+                // only queued for a MIDI synced clock
+                if(kSyncModes[g_syncIndex].source == SYNC_MIDI)
+                    g_events.Push(ev);
+                break;
 
             default: break;
         }
     }
 }
 
+// timer interrupt
+static void MidiTimerCallback(void *data)
+{
+    midi.Listen();
+    HandleMidi(midi);
+
+    // gate clock edges, timestamped on the same 4 kHz
+    // poll as MIDI (the PLL smooths the 250 us grid)
+    if(patch.gate_input[DaisyPatch::GATE_IN_1].Trig()
+       && kSyncModes[g_syncIndex].source == SYNC_GATE)
+    {
+        NoteEvent ev = {};
+        ev.type      = NoteEvent::GATE_CLOCK;
+        ev.time_us   = System::GetUs();
+        g_events.Push(ev);
+    }
+}
+
+// audio callback only, at sample offset i; clock events
+// on the sample before the clock's Tick()
+static void ApplyEvent(const NoteEvent &ev, size_t i, SyncSource sync)
+{
+    switch(ev.type)
+    {
+        case NoteEvent::NOTE_ON: g_voices.NoteOn(ev.data0); break;
+        case NoteEvent::NOTE_OFF: g_voices.NoteOff(ev.data0); break;
+        case NoteEvent::CC:
+            // 120 = All Sound Off, 123 = All Notes Off
+            if(ev.data0 == 120 || ev.data0 == 123)
+                g_voices.AllNotesOff();
+            break;
+
+        // queued for the source picked when they arrived
+        case NoteEvent::CLOCK:
+            if(sync == SYNC_MIDI)
+                g_clock.Pulse();
+            return;
+        case NoteEvent::START:
+            if(sync == SYNC_MIDI)
+                g_clock.Start();
+            return;
+        case NoteEvent::CONTINUE:
+            if(sync == SYNC_MIDI)
+                g_clock.Continue();
+            return;
+        case NoteEvent::STOP:
+            if(sync == SYNC_MIDI)
+                g_clock.Stop();
+            return;
+        case NoteEvent::GATE_CLOCK:
+            if(sync == SYNC_GATE)
+                g_clock.Pulse();
+            return;
+    }
+    if(ev.type == NoteEvent::NOTE_ON)
+        g_gate.Retrigger(i);
+    else
+        g_gate.Set(i, g_voices.AnyOn());
+}
+
+// ----------------------------------------------------
+// Profiling (cycle_profiler.h): callback load on the
+// OLED; C_DEFS += -DPROFILE_LOG=1 also prints the
+// per-section cycles and load histogram over USB
+// (Logger) every 5s
+// ----------------------------------------------------
+#ifndef PROFILE_LOG
+#define PROFILE_LOG 0
+#endif
+static CycleProfiler<3> g_prof;
+static int              g_secVoices, g_secVca;
+
+// silent blocks and main-loop sleep (idle_stats.h),
+// over one-second windows
+static IdleStats g_idle;
+
+// Measurement mode (audio_profile.h, make MEASURE=1):
+// round trip through a cable from out 4 to in 1, callback
+// overhead and headroom over USB every 2s
+#ifndef AUDIO_MEASURE
+#define AUDIO_MEASURE 0
+#endif
+#if AUDIO_MEASURE
+static AudioMeasure g_measure;
+#endif
+
+// ----------------------------------------------------
+// Main-loop tasks (scheduler.h)
+//   ctrl => encoder, 1 kHz
+//   oled => on UI change (max 30 fps) or every 100 ms
+//   idle => idle/sleep figures, 1 Hz
+//   (+ prof, meas with PROFILE_LOG / AUDIO_MEASURE)
+// ----------------------------------------------------
+static Scheduler<5> g_sched;
+static int          g_oledTask;
+
 // ----------------------------------------------------
 // Encoder UI
-//   Press cycles 4 states: 0=root,1=range,2=justOn,3=idle
-//   Turn changes root, range, or toggles just
+//   Press cycles 6 states: 0=root,1=range,2=justOn,3=poly,
+//   4=sync,5=idle
+//   Turn changes root, range, sync, or toggles just/poly
+//   Returns true if anything on screen changed
 // ----------------------------------------------------
 static bool g_prevPress = false;
-static void UpdateEncoderUI()
+static bool UpdateEncoderUI()
 {
     patch.ProcessDigitalControls();
     Encoder &enc = patch.encoder;
 
+    bool changed = false;
     bool pressed = enc.Pressed();
     // detect rising edge
     if(!g_prevPress && pressed)
     {
-        g_uiMode = (g_uiMode + 1) % 4; // now 4 states
+        g_uiMode = (g_uiMode + 1) % 6;
+        changed  = true;
     }
     g_prevPress = pressed;
 
@@ -349,54 +394,245 @@ static void UpdateEncoderUI()
                     g_justOn = !g_justOn;
                 break;
             }
-            case 3: // idle
+            case 3: // toggling Poly
+            {
+                g_polyOn = !g_polyOn;
+                break;
+            }
+            case 4: // step clock source / division
+            {
+                int s = g_syncIndex + inc;
+                if(s < 0) s = 0;
+                if(s >= kNumSyncModes) s = kNumSyncModes - 1;
+                g_syncIndex = s;
+                break;
+            }
+            case 5: // idle
             default:
                 // do nothing
                 break;
         }
+        changed = true;
     }
+    return changed;
 }
 
+// The app's OLED: double-buffered, only changed pages go
+// out over SPI DMA (oled_spi_dma.h). patch.display is
+// only used for the splash screen before this takes over.
+static uint8_t DMA_BUFFER_MEM_SECTION g_oledFront[PatchOledDriver::kBufferSize];
+static PatchOled                      g_oled;
+
 // ----------------------------------------------------
 // Simple OLED display
+//   Retained widgets (ui_widgets.h): only lines whose
+//   text changed are redrawn, and the frame is not sent
+//   at all if nothing changed.
 // ----------------------------------------------------
+typedef RetainedUi<PatchOled, FontDef, 8> Ui;
+
+static Ui  g_ui;
+static int w_title, w_root, w_poly, w_range, w_just, w_mode, w_status;
+
+static void InitOled()
+{
+    g_ui.Init();
+    w_title  = g_ui.AddText(0, 0, Font_7x10, 18);
+    w_root   = g_ui.AddText(0, 15, Font_7x10, 10);
+    w_poly   = g_ui.AddText(80, 15, Font_7x10, 4);
+    w_range  = g_ui.AddText(0, 30, Font_7x10, 16);
+    w_just   = g_ui.AddText(0, 45, Font_7x10, 8);
+    w_mode   = g_ui.AddText(80, 45, Font_7x10, 7);
+    w_status = g_ui.AddText(0, 56, Font_6x8, 21);
+    g_ui.SetText(w_title, "Randos + Root/Just");
+    PatchOled::Config cfg;
+    cfg.driver_config.front_buffer = g_oledFront;
+    g_oled.Init(cfg); // panel is cleared by the first Render()
+}
+
 static void UpdateOled()
 {
-    patch.display.Fill(false);
+    char buf[32];
 
-    patch.display.SetCursor(0, 0);
-    patch.display.WriteString("Randos + Root/Just", Font_7x10, true);
+    // title, or the sync entry while it's being edited
+    if(g_uiMode == 4)
+    {
+        snprintf(buf, sizeof(buf), "Sync: %s", kSyncModes[g_syncIndex].name);
+        g_ui.SetText(w_title, buf);
+    }
+    else
+        g_ui.SetText(w_title, "Randos + Root/Just");
 
     // Root
-    patch.display.SetCursor(0, 15);
-    patch.display.WriteString("Root: ", Font_7x10, true);
-    patch.display.WriteString(ROOT_NAMES[g_rootIndex], Font_7x10, true);
+    snprintf(buf, sizeof(buf), "Root: %s", ROOT_NAMES[g_rootIndex]);
+    g_ui.SetText(w_root, buf);
+
+    // poly
+    g_ui.SetText(w_poly, g_polyOn ? "Poly" : "Mono");
 
     // range
-    patch.display.SetCursor(0, 30);
-    char rbuf[32];
-    sprintf(rbuf, "Range: %.1f oct", (double)g_octRange);
-    patch.display.WriteString(rbuf, Font_7x10, true);
+    TextWriter(buf, sizeof(buf)).Str("Range: ").Octaves(g_octRange);
+    g_ui.SetText(w_range, buf);
 
     // Just status
-    patch.display.SetCursor(0, 45);
-    if(g_justOn)
-        patch.display.WriteString("Just=ON ", Font_7x10, true);
-    else
-        patch.display.WriteString("Just=OFF", Font_7x10, true);
+    g_ui.SetText(w_just, g_justOn ? "Just=ON" : "Just=OFF");
 
     // mode
-    patch.display.SetCursor(80, 45);
-    switch(g_uiMode)
+    static const char *MODE_NAMES[6]
+        = {"[Root]", "[Range]", "[Just]", "[Poly]", "[Sync]", "[Idle]"};
+    g_ui.SetText(w_mode, MODE_NAMES[g_uiMode]);
+
+    // bottom line rotates every 2s: NoteOn => sound
+    // latency, callback load, idle/current saved, OLED
+    // task stats; in [Sync] the clock's jitter and tempo
+    // instead
+    static const int kRotation[4] = {0, 1, 6, 2};
+    int status = kRotation[(System::GetNow() / 2000) % 4];
+    if(g_uiMode == 4)
+        status = kSyncModes[g_syncIndex].source == SYNC_INT
+                     ? 5
+                     : 3 + (System::GetNow() / 2000) % 2;
+    switch(status)
     {
-        case 0: patch.display.WriteString("[Root]",  Font_7x10, true); break;
-        case 1: patch.display.WriteString("[Range]", Font_7x10, true); break;
-        case 2: patch.display.WriteString("[Just]",  Font_7x10, true); break;
-        case 3: patch.display.WriteString("[Idle]",  Font_7x10, true); break;
+        case 0:
+        {
+            uint32_t p50 = g_noteLatency.Percentile(0.5f) / 100; // 0.1 ms
+            uint32_t p99 = g_noteLatency.Percentile(0.99f) / 100;
+            snprintf(buf,
+                     sizeof(buf),
+                     "p50 %lu.%lu p99 %lu.%lums",
+                     (unsigned long)(p50 / 10),
+                     (unsigned long)(p50 % 10),
+                     (unsigned long)(p99 / 10),
+                     (unsigned long)(p99 % 10));
+        }
+        break;
+
+        case 1:
+            TextWriter(buf, sizeof(buf))
+                .Str("cpu avg ")
+                .Uint(g_prof.AvgLoad())
+                .Str("% max ")
+                .Uint(g_prof.MaxLoad())
+                .Char('%');
+            break;
+
+        case 3:
+        {
+            // RMS: pulse and step intervals vs the period
+            ClockSync::JitterStats js = g_clockStats.Read();
+            TextWriter(buf, sizeof(buf))
+                .Str("in ")
+                .Uint((uint32_t)js.in_us)
+                .Str(" out ")
+                .Uint((uint32_t)js.out_us)
+                .Str(js.locked ? "us lock" : "us ----");
+        }
+        break;
+
+        case 4:
+        {
+            // tempo and RMS phase error
+            ClockSync::JitterStats js = g_clockStats.Read();
+            float hz = js.period_us > 0.f ? 1e6f / js.period_us : 0.f;
+            TextWriter w(buf, sizeof(buf));
+            if(kSyncModes[g_syncIndex].source == SYNC_MIDI)
+                w.Fixed(hz * 60.f / 24.f, 1).Str("bpm");
+            else
+                w.Hz(hz);
+            w.Str(" ph ").Uint((uint32_t)js.phase_us).Str("us");
+        }
+        break;
+
+        case 5: snprintf(buf, sizeof(buf), "step rate: knob 1"); break;
+
+        case 6:
+            // silent blocks, estimated core current saved
+            TextWriter(buf, sizeof(buf))
+                .Str("idle ")
+                .Uint(g_idle.IdlePercent())
+                .Str("% saves ")
+                .Uint((uint32_t)(g_idle.SavedMa() + 0.5f))
+                .Str("mA");
+            break;
+
+        default:
+        {
+            auto &st = g_sched.Stats(g_oledTask);
+            snprintf(buf,
+                     sizeof(buf),
+                     "oled %lums skip %lu%%",
+                     (unsigned long)(st.max_us / 1000),
+                     (unsigned long)g_ui.SkippedPercent());
+        }
+        break;
     }
+    g_ui.SetText(w_status, buf);
 
-    patch.display.Update();
+    g_ui.Render(g_oled);
+}
+
+static void ControlsTask(void *ctx)
+{
+    if(UpdateEncoderUI())
+        g_sched.Signal(g_oledTask);
+}
+
+static void OledTask(void *ctx)
+{
+    UpdateOled();
+}
+
+static void IdleTask(void *ctx)
+{
+    g_idle.Update(System::GetUs(), g_sched.IdleUs(), g_prof.AvgLoad());
+}
+
+#if AUDIO_MEASURE
+static void MeasureTask(void *ctx)
+{
+    g_measure.Report(g_prof,
+                     [](const char *line) { DaisySeed::PrintLine("%s", line); });
 }
+#endif
+
+#if PROFILE_LOG
+static void ProfileLogTask(void *ctx)
+{
+    DaisySeed::PrintLine("%s", TcmPlacement());
+    g_prof.Report([](const char *line) { DaisySeed::PrintLine("%s", line); });
+    g_idle.Report([](const char *line) { DaisySeed::PrintLine("%s", line); });
+    const SyncMode &sm = kSyncModes[g_syncIndex];
+    if(sm.source != SYNC_INT)
+    {
+        ClockSync::JitterStats js = g_clockStats.Read();
+        char                   buf[96];
+        TextWriter(buf, sizeof(buf))
+            .Str("sync ")
+            .Str(sm.name)
+            .Str(js.locked ? " locked" : " unlocked")
+            .Str(", period ")
+            .Fixed(js.period_us, 1)
+            .Str("us, jitter in ")
+            .Fixed(js.in_us, 1)
+            .Str("us out ")
+            .Fixed(js.out_us, 1)
+            .Str("us, phase ")
+            .Fixed(js.phase_us, 1)
+            .Str("us, ")
+            .Uint(js.steps)
+            .Str(" steps");
+        DaisySeed::PrintLine("%s", buf);
+    }
+}
+#endif
+
+// Knobs, acquired once per audio block and readable
+// from any context (control_snapshot.h)
+static Snapshot<PatchControls> g_controls;
+
+// amplitude ramp across each block (param_ramp.h)
+static LinearRamp g_ampRamp;
 
 // ----------------------------------------------------
 // Audio callback
@@ -405,16 +641,51 @@ static void UpdateOled()
 //   - Controller 2 => CV out2
 //   - Controller 3 => slew time  [0..1s]
 // ----------------------------------------------------
+DAISYEX_ITCM
 static void AudioCallback(AudioHandle::InputBuffer  in,
                           AudioHandle::OutputBuffer out,
                           size_t                    size)
 {
-    patch.ProcessAnalogControls();
+    g_prof.BeginCallback();
+    g_gate.BeginBlock(size);
+
+    // events queued since the last block
+    g_blockEvents.BeginBlock(System::GetUs());
+    g_blockEvents.Collect(g_events, size);
+
+    // the only place the analog controls are processed
+    static uint32_t block = 0;
+    PatchControls   ctl;
+    AcquirePatchControls(patch, block++, ctl);
+    g_controls.Publish(ctl);
+
+    // step clock entry from the UI: a new source starts
+    // the clock over, a new division keeps its tempo
+    static int      syncApplied = -1;
+    int             syncIndex   = g_syncIndex;
+    const SyncMode &sm          = kSyncModes[syncIndex];
+    if(syncIndex != syncApplied)
+    {
+        if(syncApplied < 0 || kSyncModes[syncApplied].source != sm.source)
+            g_clock.Init(patch.AudioSampleRate());
+        g_clock.SetRatio(sm.steps, sm.pulses);
+        g_clock.ResetStats();
+        syncApplied = syncIndex;
+    }
+    bool synced = sm.source != SYNC_INT;
+
+    // Poly/Mono from the UI
+    size_t poly = g_polyOn ? kNumVoices : 1;
+    if(g_voices.Polyphony() != poly)
+    {
+        g_voices.SetPolyphony(poly);
+        g_gate.Set(0, g_voices.AnyOn());
+    }
 
-    float ctrl0 = patch.controls[0].Process(); // step rate
-    float ctrl1 = patch.controls[1].Process(); // amplitude + CV1
-    float ctrl2 = patch.controls[2].Process(); // CV2
-    float ctrl3 = patch.controls[3].Process(); // slew time
+    float ctrl0 = ctl.knob[0]; // step rate
+    float ctrl1 = ctl.knob[1]; // amplitude + CV1
+    float ctrl2 = ctl.knob[2]; // CV2
+    float ctrl3 = ctl.knob[3]; // slew time
 
     // Step rate
     float minFreq  = 0.3333f; // ~1 step every 3s
@@ -425,116 +696,167 @@ static void AudioCallback(AudioHandle::InputBuffer  in,
     // Slew time 0..1s
     float maxSlew = 1.f;
     float slewT   = ctrl3 * maxSlew;
-    pitchSlew.SetRiseTime(slewT);
-    pitchSlew.SetFallTime(slewT);
-    cvSlew1.SetRiseTime(slewT);
-    cvSlew1.SetFallTime(slewT);
-    cvSlew2.SetRiseTime(slewT);
-    cvSlew2.SetFallTime(slewT);
+    g_voices.SetSlewTime(slewT);
 
     float sr  = patch.AudioSampleRate();
     float inc = stepFreq / sr;
+    g_voices.SetStepInc(synced ? 0.f : inc);
 
+    PitchSettings ps = {g_rootIndex, g_octRange, g_justOn};
+    int           lead = g_voices.Newest();
+
+    // amplitude ramps from the last block's knob value
+    // instead of stepping at the block boundary
+    g_ampRamp.Begin(ctrl1, size);
+
+    // Silent block: no note held and none due. One memset
+    // per output instead of the voice loop; the step
+    // clock still counts the samples, to keep the tempo
+    if(lead < 0 && g_blockEvents.Count() == 0)
+    {
+        for(size_t c = 0; c < 4; c++)
+            memset(out[c], 0, size * sizeof(float));
+        if(synced)
+        {
+            for(size_t i = 0; i < size; i++)
+                g_clock.Tick();
+            g_clockStats.Publish(g_clock.Stats());
+        }
+        WriteCvOuts(0.f, 0.f);
+        g_idle.Block(true);
+        g_prof.EndCallback();
+        return;
+    }
+
+    g_prof.Begin(g_secVoices);
     for(size_t i = 0; i < size; i++)
     {
-        if(!g_note.on)
+        NoteEvent ev;
+        bool      changed = false;
+        while(g_blockEvents.Due(i, ev))
+        {
+            ApplyEvent(ev, i, sm.source);
+            if(ev.type == NoteEvent::NOTE_ON)
+                g_noteLatency.Record(g_blockEvents.LatencyUs(ev, i, size));
+            changed = true;
+        }
+        if(changed)
+            lead = g_voices.Newest();
+
+        // runs with no note held too, to keep the tempo
+        bool clockStep = synced && g_clock.Tick();
+
+        if(lead < 0)
         {
-            // No note => zero audio + zero CV
+            // No note => zero audio and CV
             out[0][i] = out[1][i] = out[2][i] = out[3][i] = 0.f;
-            patch.seed.dac.WriteValue(DacHandle::Channel::ONE, 0);
-            patch.seed.dac.WriteValue(DacHandle::Channel::TWO, 0);
+            WriteCvOuts(0.f, 0.f);
             continue;
         }
 
-        g_note.phase += inc;
-        if(g_note.phase >= 1.f)
+        // step + slew every voice at once
+        g_voices.Process(ps, clockStep);
+
+        // CV outs follow the newest voice's slewed lanes:
+        // scale CV1 by ctrl1, CV2 by ctrl2
+        WriteCvOuts(g_voices.Cv1(lead) * ctrl1, g_voices.Cv2(lead) * ctrl2);
+
+        if(poly > 1)
         {
-            g_note.phase -= 1.f;
-            // new random freq
-            float newFreq = RandomQuantizedFreq(g_note.seed);
-            pitchSlew.SetDest(newFreq);
-
-            // random for CV out2
-            float r2 = Rand01(g_note.seed);
-            float cv2target = r2 * 5.f;
-            cvSlew2.SetDest(cv2target);
-
-            // random for CV out1
-            float r1 = Rand01(g_note.seed);
-            float cv1target = r1 * 5.f;
-            cvSlew1.SetDest(cv1target);
+            // voice n => out n%4, silent when released
+            out[0][i] = out[1][i] = out[2][i] = out[3][i] = 0.f;
+            for(size_t v = 0; v < kNumVoices; v++)
+            {
+                if(!g_voices.IsOn(v))
+                    continue;
+                osc[v].SetFreq(g_voices.Freq(v));
+                out[v & 3][i] += osc[v].Process() * kVoiceGain;
+            }
+        }
+        else
+        {
+            // mono: voice 0 on all four waveforms
+            float freqNow = g_voices.Freq(0);
+            for(size_t c = 0; c < 4; c++)
+            {
+                osc[c].SetFreq(freqNow);
+                out[c][i] = osc[c].Process();
+            }
         }
-
-        // process slews
-        float freqNow = pitchSlew.Process();
-        float cv1Now  = cvSlew1.Process();
-        float cv2Now  = cvSlew2.Process();
-
-        // update oscillators
-        osc[0].SetFreq(freqNow);
-        osc[1].SetFreq(freqNow);
-        osc[2].SetFreq(freqNow);
-        osc[3].SetFreq(freqNow);
-
-        // amplitude
-        float amp = ctrl1;
-        float s0  = osc[0].Process() * amp;
-        float s1  = osc[1].Process() * amp;
-        float s2  = osc[2].Process() * amp;
-        float s3  = osc[3].Process() * amp;
-
-        out[0][i] = s0;
-        out[1][i] = s1;
-        out[2][i] = s2;
-        out[3][i] = s3;
-
-        // CV outs: scale CV1 by ctrl1, CV2 by ctrl2
-        float cvOut1 = cv1Now * ctrl1;
-        float cvOut2 = cv2Now * ctrl2;
-        patch.seed.dac.WriteValue(DacHandle::Channel::ONE, VoltsToDac(cvOut1));
-        patch.seed.dac.WriteValue(DacHandle::Channel::TWO, VoltsToDac(cvOut2));
     }
+
+    g_prof.End(g_secVoices);
+    if(synced)
+        g_clockStats.Publish(g_clock.Stats());
+
+    // amplitude: one multiply pass per output
+    g_prof.Begin(g_secVca);
+    for(size_t c = 0; c < 4; c++)
+        g_ampRamp.Multiply(out[c], size);
+    g_prof.End(g_secVca);
+
+    g_idle.Block(false);
+    g_prof.EndCallback();
 }
 
+#if AUDIO_MEASURE
+// the app, then the loopback click on out 4
+static void MeasureCallback(AudioHandle::InputBuffer  in,
+                            AudioHandle::OutputBuffer out,
+                            size_t                    size)
+{
+    AudioCallback(in, out, size);
+    g_measure.Process(in[0], out[3], size);
+}
+#endif
+
 // ----------------------------------------------------
 // Main
 // ----------------------------------------------------
 int main(void)
 {
     patch.Init();
+    ApplyAudioProfile(patch);
     float sr = patch.AudioSampleRate();
 
-    // Gate pin
-    dsy_gpio_pin gateP = {DSY_GPIOA, 10};
-    gatePin.pin  = gateP;
-    gatePin.mode = DSY_GPIO_MODE_OUTPUT_PP;
-    gatePin.pull = DSY_GPIO_NOPULL;
-    dsy_gpio_init(&gatePin);
-    SetGate(false);
+    // Gate out, low
+    g_gate.Init(GateOut::Config(), sr);
 
     // MIDI
     MidiUartHandler::Config midi_cfg;
     midi.Init(midi_cfg);
     midi.StartReceive();
+    g_noteLatency.Init(100);
 
     // Oscillators
-    for(int i = 0; i < 4; i++)
+    for(size_t i = 0; i < kNumVoices; i++)
     {
         osc[i].Init(sr);
         osc[i].SetAmp(1.0f);
+        switch(i & 3)
+        {
+            case 0: osc[i].SetWaveform(Oscillator::WAVE_SIN); break;
+            case 1: osc[i].SetWaveform(Oscillator::WAVE_SQUARE); break;
+            case 2: osc[i].SetWaveform(Oscillator::WAVE_TRI); break;
+            case 3: osc[i].SetWaveform(Oscillator::WAVE_SAW); break;
+        }
     }
-    osc[0].SetWaveform(Oscillator::WAVE_SIN);
-    osc[1].SetWaveform(Oscillator::WAVE_SQUARE);
-    osc[2].SetWaveform(Oscillator::WAVE_TRI);
-    osc[3].SetWaveform(Oscillator::WAVE_SAW);
-
-    // Slews
-    pitchSlew.Init(sr);
-    pitchSlew.SetValue(220.f);
-    cvSlew1.Init(sr);
-    cvSlew1.SetValue(0.f);
-    cvSlew2.Init(sr);
-    cvSlew2.SetValue(0.f);
+
+    // Voices (seeds, step phases and slews)
+    g_voices.Init(sr);
+    g_blockEvents.Init(sr);
+
+    // Profiler: block deadline in CPU cycles
+    g_prof.Init(System::GetSysClkFreq(), sr, patch.AudioBlockSize());
+    g_secVoices = g_prof.AddSection("voices", true);
+    g_secVca    = g_prof.AddSection("vca", true);
+    g_idle.Init();
+#if AUDIO_MEASURE
+    g_measure.Init(sr, patch.AudioBlockSize());
+#endif
+#if PROFILE_LOG || AUDIO_MEASURE
+    patch.seed.StartLog(false);
+#endif
 
     // Splash
     patch.display.Fill(false);
@@ -545,17 +867,35 @@ int main(void)
 
     // Start
     patch.StartAdc();
+#if AUDIO_MEASURE
+    patch.StartAudio(MeasureCallback);
+#else
     patch.StartAudio(AudioCallback);
-
-    while(1)
-    {
-        midi.Listen();
-        HandleMidi(midi);
-
-        UpdateEncoderUI();
-        UpdateOled();
-
-        patch.DelayMs(10);
-    }
+#endif
+
+    // MIDI is serviced from a timer interrupt from here on
+    TimerHandle::Config tim_cfg;
+    tim_cfg.periph     = TimerHandle::Config::Peripheral::TIM_5;
+    tim_cfg.dir        = TimerHandle::Config::CounterDir::UP;
+    tim_cfg.enable_irq = true;
+    midiTimer.Init(tim_cfg);
+    midiTimer.SetPeriod(midiTimer.GetFreq() / kMidiPollHz);
+    midiTimer.SetCallback(MidiTimerCallback);
+    midiTimer.Start();
+
+    // Main loop: UI tasks, WFI when idle
+    InitOled();
+    g_sched.Init(System::GetUs);
+    g_sched.AddPeriodic("ctrl", ControlsTask, 1000, 2);
+    g_oledTask = g_sched.AddPeriodic("oled", OledTask, 100000, 1);
+    g_sched.SetMinInterval(g_oledTask, 33333);
+    g_sched.AddPeriodic("idle", IdleTask, 1000000, 0);
+#if PROFILE_LOG
+    g_sched.AddPeriodic("prof", ProfileLogTask, 5000000, 0);
+#endif
+#if AUDIO_MEASURE
+    g_sched.AddPeriodic("meas", MeasureTask, 2000000, 0);
+#endif
+    g_sched.Run();
     return 0;
 }
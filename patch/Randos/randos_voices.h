@@ -0,0 +1,289 @@
+/**********************************************************
+   randos_voices.h
+   Random step generator voices for Randos
+
+   Each voice has its own deterministic seed (derived from
+   its MIDI key), step phase and pitch/CV slews. State is
+   kept per lane so all voices advance in one pass.
+
+   Step phases are 32-bit fixed point (phase_clock.h): a
+   step is the carry out of the add, exact over any run
+   length, where the float phase drifted.
+**********************************************************/
+#pragma once
+#ifndef RANDOS_VOICES_H
+#define RANDOS_VOICES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "phase_clock.h"
+#include "pitch_tables.h"
+#include "slew_lanes.h"
+#include "tcm.h"
+#include "voice_alloc.h"
+
+namespace daisyex
+{
+// ----------------------------------------------------
+// A simple linear-congruential generator (LCG)
+// ----------------------------------------------------
+inline uint32_t LCG_Next(uint32_t &seed)
+{
+    seed = seed * 1664525u + 1013904223u;
+    return seed;
+}
+inline float Rand01(uint32_t &seed)
+{
+    uint32_t r = (LCG_Next(seed) >> 8);
+    return float(r) * (1.0f / 16777216.0f);
+}
+
+// ----------------------------------------------------
+// Pitch picking settings (edited from the encoder UI)
+//   rootIndex => 0..12 => "None", "C", "C#", etc.
+//   octRange  => in [0.5..6]
+//   justOn    => pick from a Just scale
+// ----------------------------------------------------
+struct PitchSettings
+{
+    int   rootIndex;
+    float octRange;
+    bool  justOn;
+};
+
+// We'll define major scale offsets for 12-TET major scale
+static const int MAJOR_OFFSETS[8] = {0,2,4,5,7,9,11,12};
+
+// ----------------------------------------------------
+// Just scale around a "base frequency" derived from root
+// We'll treat baseFreq = MidiToFreq(48 + (rootIndex-1))
+//  if rootIndex>0, or just 220 if you prefer a standard A3.
+// Then we pick from kJustMajor8 plus random octaves
+// up to octRange
+// ----------------------------------------------------
+inline float JustRandomFreq(uint32_t &seed, float baseFreq, float octRange)
+{
+    const int scaleSize = 8; // length of kJustMajor8
+    // pick one ratio
+    float r1 = Rand01(seed);
+    int   idx = (int)(r1 * scaleSize);
+    if(idx >= scaleSize) idx = scaleSize - 1;
+
+    // pick an integer octave in [0.. floor(octRange)]
+    float r2       = Rand01(seed);
+    int   maxOctI  = (int)octRange; // floor
+    int   octPicked = (int)(r2 * (maxOctI+1));
+    if(octPicked > maxOctI) octPicked = maxOctI;
+
+    // octave shift is exact via exponent, no powf
+    return ScaleOctaves(baseFreq * kJustMajor8[idx], octPicked);
+}
+
+// ----------------------------------------------------
+// A function that picks a random frequency based on
+//   1) rootIndex: 0 => none, 1..12 => semitone root
+//   2) octRange
+//   3) justOn => if true, pick from a Just scale
+//                else pick from a 12TET major scale
+// ----------------------------------------------------
+inline float RandomQuantizedFreq(uint32_t &seed, const PitchSettings &ps)
+{
+    // If root=0 => "None" => unquantized
+    if(ps.rootIndex == 0)
+    {
+        // 50..2000 Hz
+        float r = Rand01(seed);
+        return 50.f + 1950.f * r;
+    }
+
+    // else we have a root
+    int rootSemitone = (ps.rootIndex - 1); // 0..11 => C..B
+    float baseFreq    = MidiToFreq(48 + rootSemitone);
+        // e.g. around C3 if rootSemitone=0 => C
+
+    // If "Just" is ON => pick from Just scale
+    if(ps.justOn)
+    {
+        return JustRandomFreq(seed, baseFreq, ps.octRange);
+    }
+    else
+    {
+        // 12TET major scale quant
+        // e.g. pick random semitones up to 12*octRange
+        float r = Rand01(seed);
+        float maxSemisF = 12.f * ps.octRange;
+        float pickF     = r * maxSemisF;
+        int   pickI     = (int)pickF; // integer semitones
+        int   fullOct   = pickI / 12;
+        int   leftover  = pickI % 12;
+        if(leftover < 0) leftover += 12;
+
+        // snap leftover to major scale
+        int chosen = 0;
+        for(int i=0; i<8; i++)
+        {
+            if(MAJOR_OFFSETS[i] <= leftover)
+                chosen = MAJOR_OFFSETS[i];
+            else
+                break;
+        }
+        int totalSemis = fullOct * 12 + chosen + rootSemitone;
+        int midinote   = 48 + totalSemis; // ~C3-based
+        if(midinote < 0)   midinote = 0;
+        if(midinote > 127) midinote = 127;
+        return MidiToFreq(midinote);
+    }
+}
+
+// ----------------------------------------------------
+// RandosVoices
+//   - NoteOn/NoteOff go through a VoiceAllocator
+//   - Process() advances every lane by one sample;
+//     inactive lanes hold their phase. With an external
+//     clock (clock_sync.h) the app sets the step inc to 0
+//     and passes clockStep: every held lane steps on it.
+//   - Freq()/Cv1()/Cv2() give the slewed lane values
+//     (CVs in 0..5 V)
+// ----------------------------------------------------
+template <size_t N>
+class RandosVoices
+{
+  public:
+    void Init(float samplerate)
+    {
+        alloc_.Init();
+        pitch_.Init(samplerate);
+        cv1_.Init(samplerate);
+        cv2_.Init(samplerate);
+        for(size_t v = 0; v < N; v++)
+        {
+            seed_[v]   = 0;
+            active_[v] = 0.f;
+            step_[v].Reset();
+            step_[v].SetInc(0);
+            pitch_.SetValue(v, 220.f);
+            cv1_.SetValue(v, 0.f);
+            cv2_.SetValue(v, 0.f);
+        }
+        inc_   = 0.f;
+        steps_ = 0;
+    }
+
+    void SetPolyphony(size_t n)
+    {
+        alloc_.SetPolyphony(n);
+        for(size_t v = alloc_.Polyphony(); v < N; v++)
+            Stop(v);
+    }
+    size_t Polyphony() const { return alloc_.Polyphony(); }
+
+    // returns the voice that started
+    int NoteOn(uint8_t note)
+    {
+        bool stolen;
+        int  v     = alloc_.NoteOn(note, stolen);
+        // Deterministic seed
+        seed_[v]   = (note * 12345u) + 99999u;
+        active_[v] = 1.f;
+        step_[v].Reset();
+        step_[v].SetInc(inc_);
+        return v;
+    }
+
+    // returns the voice that stopped, or -1
+    int NoteOff(uint8_t note)
+    {
+        int v = alloc_.NoteOff(note);
+        if(v >= 0)
+            Stop(v);
+        return v;
+    }
+
+    // MIDI All Notes Off
+    void AllNotesOff()
+    {
+        for(size_t v = 0; v < N; v++)
+        {
+            if(alloc_.IsOn(v))
+                alloc_.Release(v);
+            Stop(v);
+        }
+    }
+
+    // per-block settings; inc in steps per sample
+    void SetStepInc(float inc)
+    {
+        inc_ = PhaseAccumulator::IncFor(inc);
+        for(size_t v = 0; v < N; v++)
+            if(active_[v] != 0.f)
+                step_[v].SetInc(inc_);
+    }
+    void SetSlewTime(float t)
+    {
+        pitch_.SetTime(t);
+        cv1_.SetTime(t);
+        cv2_.SetTime(t);
+    }
+
+    DAISYEX_ITCM void Process(const PitchSettings &ps, bool clockStep = false)
+    {
+        // step phases (inactive lanes add 0), then one
+        // branch for the rare sample where a lane wrapped
+        // into a new step
+        uint32_t wrapped = 0;
+        for(size_t v = 0; v < N; v++)
+            wrapped |= (uint32_t)step_[v].Tick() << v;
+        if(clockStep)
+            for(size_t v = 0; v < N; v++)
+                wrapped |= (uint32_t)(active_[v] != 0.f) << v;
+
+        for(size_t v = 0; wrapped != 0 && v < N; v++)
+        {
+            if(wrapped & (1u << v))
+            {
+                steps_++;
+                // new random freq
+                pitch_.SetDest(v, RandomQuantizedFreq(seed_[v], ps));
+                // random for CV out2, then CV out1
+                cv2_.SetDest(v, Rand01(seed_[v]) * 5.f);
+                cv1_.SetDest(v, Rand01(seed_[v]) * 5.f);
+            }
+        }
+
+        pitch_.Process();
+        cv1_.Process();
+        cv2_.Process();
+    }
+
+    bool  IsOn(size_t v) const { return active_[v] != 0.f; }
+    bool  AnyOn() const { return alloc_.NumActive() > 0; }
+    int   Newest() const { return alloc_.Newest(); }
+    float Freq(size_t v) const { return pitch_.Value(v); }
+    float Cv1(size_t v) const { return cv1_.Value(v); }
+    float Cv2(size_t v) const { return cv2_.Value(v); }
+
+    // step boundaries taken, all lanes, since Init()
+    uint32_t Steps() const { return steps_; }
+
+    const VoiceAllocator<N> &Allocator() const { return alloc_; }
+
+  private:
+    // key released: the lane holds its phase
+    void Stop(size_t v)
+    {
+        active_[v] = 0.f;
+        step_[v].SetInc(0);
+    }
+
+    VoiceAllocator<N> alloc_;
+    SlewLanes<N>      pitch_, cv1_, cv2_;
+    uint32_t          seed_[N];
+    PhaseAccumulator  step_[N];   // step logic accumulator
+    float             active_[N]; // 1 while the key is held
+    uint32_t          inc_;
+    uint32_t          steps_;
+};
+
+} // namespace daisyex
+
+#endif
@@ -0,0 +1,108 @@
+/***************************************************************
+   zoom_pitch.h
+   Pitch quantizer and slew limiter for pod FractalZoom
+
+   Kept out of FractalZoom.cpp so the host benchmarks
+   (utils/bench/dsp_bench.cpp) time the same code the
+   module runs.
+***************************************************************/
+#pragma once
+#ifndef ZOOM_PITCH_H
+#define ZOOM_PITCH_H
+
+#include <math.h>
+#include "pitch_tables.h"
+
+namespace daisyex
+{
+// --------------------------------------------------------
+// Just-Intonation Major Scale (two octaves)
+// --------------------------------------------------------
+// Define 7 notes for one octave in just intonation major scale
+static const float majorJust7_scale[7] = {
+    1.0f,        // 0 = root (C)
+    9.f/8.f,     // 1 = major second (D)
+    5.f/4.f,     // 2 = major third (E)
+    4.f/3.f,     // 3 = perfect fourth (F)
+    3.f/2.f,     // 4 = perfect fifth (G)
+    5.f/3.f,     // 5 = major sixth (A)
+    15.f/8.f     // 6 = major seventh (B)
+};
+
+// Quantization function: map fractVal in [-2..+2] to frequency in major just intonation scale over four octaves
+inline float QuantizeJustMajor(float fractVal, float baseFreq)
+{
+    // clamp fractVal in [-2..2]
+    if(fractVal < -2.f) fractVal = -2.f;
+    if(fractVal >  2.f) fractVal =  2.f;
+
+    // shift to [0..4] (normalized input range)
+    float shifted = fractVal + 2.f; // now in [0..4]
+
+    // map [0..4] to [0..28) (4 octaves = 7 notes per octave * 4 octaves = 28 total steps)
+    float scaled = shifted * (28.f / 4.f); // => [0..28)
+    int step     = (int)floorf(scaled);   // determine the step
+    if(step < 0)    step = 0;
+    if(step > 27)   step = 27; // restrict step range to the 28 notes in 4 octaves
+
+    // Calculate the ratio for the note:
+    //   ratio = 2^(step/7) * majorJust7_scale[step%7]
+    // The octave part is an exact exponent shift (pitch_tables.h)
+    int octave = step / 7;
+    int degree = step - octave * 7;
+
+    // Final frequency
+    return ScaleOctaves(baseFreq * majorJust7_scale[degree], octave);
+}
+
+// --------------------------------------------------------
+// Slew Limiter class for smooth pitch transitions
+// --------------------------------------------------------
+class SlewLimiter
+{
+  public:
+    void Init(float samplerate)
+    {
+        sr_    = samplerate;
+        value_ = 0.f;
+        dest_  = 0.f;
+        rise_  = 0.02f; // default rise time
+        fall_  = 0.03f; // default fall time
+    }
+    void SetRiseFall(float t)
+    {
+        rise_ = t;
+        fall_ = t;
+    }
+    void SetValue(float v)
+    {
+        value_ = v;
+        dest_  = v;
+    }
+    void SetDest(float d)
+    {
+        dest_ = d;
+    }
+    float Process()
+    {
+        float diff = dest_ - value_;
+        float time = (diff >= 0.f) ? rise_ : fall_;
+        if(time < 1.0e-6f)
+        {
+            value_ = dest_;
+            return value_;
+        }
+        float step = diff / (time * sr_);
+        if(fabsf(step) > fabsf(diff))
+            value_ = dest_;
+        else
+            value_ += step;
+        return value_;
+    }
+  private:
+    float sr_, value_, dest_, rise_, fall_;
+};
+
+} // namespace daisyex
+
+#endif
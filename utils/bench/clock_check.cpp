@@ -0,0 +1,236 @@
+/**********************************************************
+   clock_check.cpp
+   Host check for the clock sync PLL (clock_sync.h)
+
+   Feeds ClockSync pulses the way Randos sees them: MIDI
+   clock or gate edges timestamped by a 4 kHz poll, so each
+   pulse lands on the next 12-sample grid point (250 us at
+   48 kHz) after its true time, plus a little random UART
+   delay. Then checks, per scenario:
+     - the loop locks, and within how many pulses
+     - the step count is exactly one per division
+       (nothing doubled or dropped), also across a tempo
+       change
+     - step intervals jitter less than the pulses do
+     - Start steps on the first pulse; a stopped gate
+       clock adds at most the step due on its missing
+       edge, then restarts on its next edge
+   and prints the jitter figures the app shows in its
+   Sync mode.
+
+       clock_check [-v]     (-v: per-scenario stats)
+
+   Exit code is non-zero if any check fails.
+**********************************************************/
+
+#include "clock_sync.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace daisyex;
+
+static const float    kSampleRate = 48000.f;
+static const uint32_t kPollGrid   = 12; // 4 kHz poll, in samples
+
+static int  g_failed  = 0;
+static bool g_verbose = false;
+
+static void Check(bool ok, const char *what)
+{
+    printf("%-56s %s\n", what, ok ? "ok" : "FAIL");
+    if(!ok)
+        g_failed++;
+}
+
+struct Run
+{
+    std::vector<uint32_t> steps;      // step samples
+    uint32_t              lock_pulse; // pulses until Locked()
+    ClockSync::JitterStats stats;     // after lock
+};
+
+// Pulses at 'bpm' (24 per quarter for MIDI, 'ppq' in
+// general) from t0 for 'seconds'; optional tempo change
+// to bpm2 halfway. Pulse arrival is quantized to the
+// poll grid plus 0..jitter samples.
+static Run Simulate(ClockSync &clk,
+                    float      bpm,
+                    float      bpm2,
+                    float      seconds,
+                    uint32_t   ppq,
+                    uint32_t   jitter,
+                    uint32_t   seed = 1)
+{
+    Run      r;
+    r.lock_pulse   = 0;
+    uint64_t total = (uint64_t)(seconds * kSampleRate);
+    double   t     = 0.0; // true time of the next pulse
+    uint32_t pulse = 0;
+    uint64_t next  = 0; // arrival sample of the next pulse
+    bool     stats_reset = false;
+    for(uint64_t s = 0; s < total; s++)
+    {
+        if(s == next)
+        {
+            clk.Pulse();
+            pulse++;
+            if(!r.lock_pulse && clk.Locked())
+                r.lock_pulse = pulse;
+            if(r.lock_pulse && !stats_reset && pulse > r.lock_pulse + 24)
+            {
+                clk.ResetStats();
+                stats_reset = true;
+            }
+            float cur = s < total / 2 ? bpm : bpm2;
+            t += kSampleRate * 60.0 / (cur * ppq);
+            seed        = seed * 1664525u + 1013904223u;
+            uint64_t at = (uint64_t)ceil(t / kPollGrid) * kPollGrid;
+            next        = at + (jitter ? (seed >> 8) % (jitter + 1) : 0);
+        }
+        if(clk.Tick())
+            r.steps.push_back((uint32_t)s);
+    }
+    r.stats = clk.Stats();
+    return r;
+}
+
+static void Print(const char *name, const Run &r)
+{
+    if(!g_verbose)
+        return;
+    printf("  %-20s lock %3u pulses, %zu steps, jitter in %.1f us, "
+           "out %.1f us, phase %.1f us\n",
+           name,
+           r.lock_pulse,
+           r.steps.size(),
+           r.stats.in_us,
+           r.stats.out_us,
+           r.stats.phase_us);
+}
+
+// no two steps closer than 'lo' or further than 'hi'
+static bool Spacing(const Run &r, size_t from, float lo, float hi)
+{
+    for(size_t i = from + 1; i < r.steps.size(); i++)
+    {
+        float d = (float)(r.steps[i] - r.steps[i - 1]);
+        if(d < lo || d > hi)
+            return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    g_verbose = argc > 1 && !strcmp(argv[1], "-v");
+    char what[96];
+
+    // MIDI clock, 1/16 steps, 120 bpm: 1000 samples per
+    // pulse, a step every 6000
+    {
+        ClockSync clk;
+        clk.Init(kSampleRate);
+        clk.SetRatio(1, 6);
+        Run r = Simulate(clk, 120.f, 120.f, 60.f, 24, 6);
+        Print("midi 120 1/16", r);
+        // 2880 pulses; steps on pulses 0, 6, ... 2874
+        Check(r.lock_pulse > 0 && r.lock_pulse < 48,
+              "MIDI 120 bpm 1/16: locks within 2 beats");
+        snprintf(what,
+                 sizeof(what),
+                 "MIDI 120 bpm 1/16: 480 steps in 60 s (got %zu)",
+                 r.steps.size());
+        Check(r.steps.size() == 480, what);
+        Check(r.steps[0] == 0, "MIDI: first step on the first pulse");
+        Check(Spacing(r, 0, 5900.f, 6100.f), "MIDI: every step 6000 +- 100 smp");
+        Check(r.stats.out_us < r.stats.in_us,
+              "MIDI: steps jitter less than the pulses");
+    }
+
+    // tempo change 120 -> 140 halfway: still one step per
+    // 6 pulses, no double or dropped step
+    {
+        ClockSync clk;
+        clk.Init(kSampleRate);
+        clk.SetRatio(1, 6);
+        Run r = Simulate(clk, 120.f, 140.f, 60.f, 24, 6);
+        Print("midi 120->140", r);
+        // 30 s at 120 = 1440 pulses, then 30 s at 140 =
+        // 1680: 3120 pulses, steps on every 6th
+        snprintf(what,
+                 sizeof(what),
+                 "MIDI 120->140 bpm: 520 steps (got %zu)",
+                 r.steps.size());
+        Check(r.steps.size() == 520, what);
+        Check(Spacing(r, 0, 5142.f * 0.8f, 6000.f * 1.2f),
+              "MIDI 120->140 bpm: no doubled or dropped step");
+        Check(r.stats.locked, "MIDI 120->140 bpm: locked again");
+    }
+
+    // gate clock at 4 Hz doubled: 8 steps per second, but
+    // none between the first two edges (no tempo yet)
+    {
+        ClockSync clk;
+        clk.Init(kSampleRate);
+        clk.SetRatio(2, 1);
+        Run r = Simulate(clk, 240.f, 240.f, 30.f, 1, 0);
+        Print("gate 4 Hz x2", r);
+        snprintf(what,
+                 sizeof(what),
+                 "gate 4 Hz x2: 239 steps in 30 s (got %zu)",
+                 r.steps.size());
+        Check(r.steps.size() == 239, what);
+        Check(Spacing(r, 4, 5900.f, 6100.f), "gate x2: steps halve the pulses");
+    }
+
+    // gate clock that stops: at most the step due on the
+    // missing edge, then a restart on the next edge with
+    // a step right on it
+    {
+        ClockSync clk;
+        clk.Init(kSampleRate);
+        clk.SetRatio(1, 1);
+        Simulate(clk, 120.f, 120.f, 5.f, 1, 0); // 2 Hz, 10 steps
+        size_t held = 0;
+        for(int s = 0; s < 96000; s++)
+            held += clk.Tick();
+        // 2 s later the clock comes back
+        clk.Pulse();
+        bool stepped = clk.Tick();
+        Check(held <= 1, "gate stopped: no steps past the missing edge");
+        Check(stepped, "gate restarted: steps on its first edge");
+    }
+
+    // MIDI transport: Stop holds, Start steps on the first
+    // pulse after it
+    {
+        ClockSync clk;
+        clk.Init(kSampleRate);
+        clk.SetRatio(1, 6);
+        Simulate(clk, 120.f, 120.f, 2.f, 24, 0);
+        clk.Stop();
+        size_t stopped = 0;
+        for(int p = 0; p < 48; p++)
+        {
+            clk.Pulse();
+            for(int s = 0; s < 1000; s++)
+                stopped += clk.Tick();
+        }
+        clk.Start();
+        for(int s = 0; s < 500; s++)
+            stopped += clk.Tick();
+        clk.Pulse();
+        bool stepped = clk.Tick();
+        Check(stopped == 0, "MIDI Stop: no steps while stopped");
+        Check(stepped, "MIDI Start: steps on the next clock");
+        snprintf(what,
+                 sizeof(what),
+                 "MIDI stopped clock keeps the tempo (%.1f bpm)",
+                 clk.Bpm());
+        Check(fabsf(clk.Bpm() - 120.f) < 0.5f, what);
+    }
+
+    return g_failed ? 1 : 0;
+}
@@ -0,0 +1,657 @@
+/**********************************************************
+   dsp_bench.cpp
+   Host microbenchmarks for the DSP primitives the apps
+   run per sample or per step, against a local baseline
+
+   Every benchmark times the apps' own code (common/ and
+   the app-local headers), not copies:
+     perlin_noise          FractalNoise1D::Noise
+     fbm_oct1..8           FractalNoise1D::FBm, lac 2 gain .5
+     fbm_batch_4x7         FBmBatch, 4 voices x 7 octaves
+     fbm_table_oct5        FbmTable::Eval, the baked table
+                           (256/unit) for fbm_oct5
+     fbm_lod_zoom_*        FbmLod::Eval as pod FractalZoom's
+                           right voice reads it (7 octaves,
+                           window 4, 3 Hz, a 10 s loop) at
+                           zoom 1/1024, 1/8, 1 and 32
+     quantize_cv_eq/just   JustInTone QuantizeCV
+     quantize_just_major   pod FractalZoom QuantizeJustMajor
+     random_freq_*         Randos RandomQuantizedFreq, per
+                           root/just mode
+     slew_limiter          pod FractalZoom SlewLimiter
+     randos_voices_4       RandosVoices<4>::Process
+     osc_*                 the apps' oscillator loops over a
+                           48-sample block (Oscillator from
+                           the host DaisySP stand-in)
+
+   Each result is the fastest of 31 runs of at least 2 ms
+   (short runs are likelier to miss a busy neighbour on a
+   shared build server). One "call" is one call of the
+   primitive, or one block for the osc_* loops; cycles are
+   CycleCount() (cycle_profiler.h: rdtsc on x86).
+
+       dsp_bench [-o out.json] [-b baseline.json]
+                 [-x percent] [-f name-filter]
+
+   JSON goes to stdout (or -o). With -b, each result's
+   ns_per_call is compared with the baseline's and the exit
+   code is 1 if any is more than -x percent (default 15)
+   slower. A slow result is measured twice more before it
+   counts, so one noisy run doesn't fail.
+
+   Times are absolute, so a baseline only means something
+   on the machine and compiler that recorded it. The JSON
+   carries both ("host", "compiler"), and a baseline from
+   another host or compiler is reported and not compared
+   (exit 0). None is checked in: 'make bench' records
+   build/dsp_bench_baseline.json on its first run and
+   compares against it afterwards; 'make bench-baseline'
+   re-records it.
+**********************************************************/
+
+#include "fbm.h"
+#include "fbm_table.h"
+#include "fbm_lod.h"
+#include "cycle_profiler.h"
+#include "daisysp.h"
+#include "randos_voices.h"
+#include "quantize_cv.h"
+#include "zoom_pitch.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+using namespace daisyex;
+using daisysp::Oscillator;
+
+static const float  kSampleRate = 48000.f;
+static const size_t kBlock      = 48;
+
+// ----------------------------------------------------
+// Inputs: a fixed pseudo-random table, so every run
+// sees the same values and the compiler can't fold them
+// ----------------------------------------------------
+static const size_t kInputs = 4096; // power of 2
+static float        g_in[kInputs];  // 0..1
+static float        g_sink;
+
+static void InitInputs()
+{
+    uint32_t seed = 12345u;
+    for(size_t i = 0; i < kInputs; i++)
+        g_in[i] = Rand01(seed);
+}
+
+static inline float In(int i)
+{
+    return g_in[i & (kInputs - 1)];
+}
+
+// ----------------------------------------------------
+// Benchmarks: run 'calls' calls, return something that
+// depends on every result
+// ----------------------------------------------------
+static FractalNoise1D g_noise;
+
+static float PerlinNoise(int calls)
+{
+    float acc = 0.f;
+    for(int i = 0; i < calls; i++)
+        acc += g_noise.Noise(In(i) * 256.f);
+    return acc;
+}
+
+template <int Octaves>
+static float FBmOctaves(int calls)
+{
+    float acc = 0.f;
+    for(int i = 0; i < calls; i++)
+        acc += g_noise.FBm(In(i) * 64.f, Octaves, 2.f, 0.5f);
+    return acc;
+}
+
+static float FBmBatch4x7(int calls)
+{
+    float x[4], out[4], acc = 0.f;
+    for(int i = 0; i < calls; i++)
+    {
+        for(int v = 0; v < 4; v++)
+            x[v] = In(i * 4 + v) * 64.f;
+        g_noise.FBmBatch(x, out, 4, 7, 2.f, 0.5f);
+        acc += out[0] + out[1] + out[2] + out[3];
+    }
+    return acc;
+}
+
+static float FbmTableOct5(int calls)
+{
+    static std::vector<float> image;
+    static FbmTable           table;
+    if(!table.Valid())
+    {
+        const uint32_t kPerUnit = 256;
+        image.resize(sizeof(FbmTableHeader) / sizeof(float)
+                     + (256 * kPerUnit + 1) * 2);
+        FbmTableHeader *h = (FbmTableHeader *)image.data();
+        BakeFbmTable(*h, (float *)(h + 1), kPerUnit, 5, 2.f, 0.5f);
+        table.Init(image.data(), 5, 2.f, 0.5f);
+    }
+    float acc = 0.f;
+    for(int i = 0; i < calls; i++)
+        acc += table.Eval(In(i) * 64.f);
+    return acc;
+}
+
+// zoom 2^ZoomLog2: one read per step of zoom / 3 Hz, x
+// wrapping every 30 reads like the loop does
+template <int ZoomLog2>
+static float FbmLodZoom(int calls)
+{
+    FbmLod lod;
+    lod.Init(g_noise, 7, 4, 2.f, 0.7f);
+    float step = ldexpf(1.f, ZoomLog2) / 3.f;
+    lod.SetStep(step);
+    float acc = 0.f;
+    for(int i = 0; i < calls; i++)
+        acc += lod.Eval((float)(i % 30) * step + In(i) * 1e-3f);
+    return acc;
+}
+
+template <bool Just>
+static float QuantizeCv(int calls)
+{
+    float acc = 0.f;
+    for(int i = 0; i < calls; i++)
+        acc += QuantizeCV(In(i) * 8.f, Just);
+    return acc;
+}
+
+static float QuantizeJust(int calls)
+{
+    float acc = 0.f;
+    for(int i = 0; i < calls; i++)
+        acc += QuantizeJustMajor(In(i) * 4.f - 2.f, 55.f);
+    return acc;
+}
+
+template <int Root, bool Just>
+static float RandomFreq(int calls)
+{
+    PitchSettings ps   = {Root, 3.f, Just};
+    uint32_t      seed = 99999u;
+    float         acc  = 0.f;
+    for(int i = 0; i < calls; i++)
+        acc += RandomQuantizedFreq(seed, ps);
+    return acc;
+}
+
+static float Slew(int calls)
+{
+    SlewLimiter slew;
+    slew.Init(kSampleRate);
+    slew.SetRiseFall(0.05f);
+    slew.SetValue(220.f);
+    float acc = 0.f;
+    for(int i = 0; i < calls; i++)
+    {
+        // a new pitch every 2400 samples (20 Hz steps)
+        if((i % 2400) == 0)
+            slew.SetDest(110.f + In(i) * 880.f);
+        acc += slew.Process();
+    }
+    return acc;
+}
+
+static float RandosVoices4(int calls)
+{
+    static RandosVoices<4> voices;
+    PitchSettings          ps = {1, 3.f, true};
+    voices.Init(kSampleRate);
+    voices.SetPolyphony(4);
+    voices.SetSlewTime(0.05f);
+    voices.SetStepInc(8.f / kSampleRate);
+    for(uint8_t n = 0; n < 4; n++)
+        voices.NoteOn(48 + n * 7);
+    float acc = 0.f;
+    for(int i = 0; i < calls; i++)
+    {
+        voices.Process(ps);
+        acc += voices.Freq(i & 3);
+    }
+    return acc;
+}
+
+// Randos mono / FractalZoom gliding: one frequency on the
+// four waveforms, set every sample
+static float OscQuadGlide(int calls)
+{
+    Oscillator osc[4];
+    const uint8_t waves[4] = {Oscillator::WAVE_SIN,
+                              Oscillator::WAVE_SQUARE,
+                              Oscillator::WAVE_TRI,
+                              Oscillator::WAVE_SAW};
+    for(int c = 0; c < 4; c++)
+    {
+        osc[c].Init(kSampleRate);
+        osc[c].SetWaveform(waves[c]);
+    }
+    float out[4][kBlock], acc = 0.f;
+    for(int b = 0; b < calls; b++)
+    {
+        float f = 110.f + In(b) * 880.f;
+        for(size_t i = 0; i < kBlock; i++)
+        {
+            f *= 1.0001f;
+            for(int c = 0; c < 4; c++)
+            {
+                osc[c].SetFreq(f);
+                out[c][i] = osc[c].Process();
+            }
+        }
+        acc += out[0][kBlock - 1] + out[3][kBlock - 1];
+    }
+    return acc;
+}
+
+// FractalZoom mono, pitch settled: four waveforms mixed,
+// no SetFreq inside the block
+static float OscQuadHeld(int calls)
+{
+    Oscillator osc[4];
+    const uint8_t waves[4] = {Oscillator::WAVE_SIN,
+                              Oscillator::WAVE_SQUARE,
+                              Oscillator::WAVE_TRI,
+                              Oscillator::WAVE_SAW};
+    for(int c = 0; c < 4; c++)
+    {
+        osc[c].Init(kSampleRate);
+        osc[c].SetWaveform(waves[c]);
+        osc[c].SetFreq(220.f);
+    }
+    float out[kBlock], acc = 0.f;
+    for(int b = 0; b < calls; b++)
+    {
+        for(size_t i = 0; i < kBlock; i++)
+        {
+            float s0 = osc[0].Process();
+            float s1 = osc[1].Process();
+            float s2 = osc[2].Process();
+            float s3 = osc[3].Process();
+            out[i]   = (s0 + s1 + s2 + s3) * 0.25f;
+        }
+        acc += out[kBlock - 1];
+    }
+    return acc;
+}
+
+// pod FractalZoom: two slewed sines
+static float OscSinePair(int calls)
+{
+    Oscillator  oscL, oscR;
+    SlewLimiter slewL, slewR;
+    oscL.Init(kSampleRate);
+    oscR.Init(kSampleRate);
+    slewL.Init(kSampleRate);
+    slewR.Init(kSampleRate);
+    slewL.SetValue(440.f);
+    slewR.SetValue(440.f);
+    float out[2][kBlock], acc = 0.f;
+    for(int b = 0; b < calls; b++)
+    {
+        if((b % 50) == 0)
+        {
+            slewL.SetDest(110.f + In(b) * 880.f);
+            slewR.SetDest(110.f + In(b + 1) * 880.f);
+        }
+        for(size_t i = 0; i < kBlock; i++)
+        {
+            oscL.SetFreq(slewL.Process());
+            oscR.SetFreq(slewR.Process());
+            out[0][i] = oscL.Process();
+            out[1][i] = oscR.Process();
+        }
+        acc += out[0][kBlock - 1] + out[1][kBlock - 1];
+    }
+    return acc;
+}
+
+struct Bench
+{
+    const char *name;
+    size_t      samples_per_call; // outputs per call
+    float (*run)(int calls);
+};
+
+static const Bench kBenches[] = {
+    {"perlin_noise", 1, PerlinNoise},
+    {"fbm_oct1", 1, FBmOctaves<1>},
+    {"fbm_oct2", 1, FBmOctaves<2>},
+    {"fbm_oct3", 1, FBmOctaves<3>},
+    {"fbm_oct4", 1, FBmOctaves<4>},
+    {"fbm_oct5", 1, FBmOctaves<5>},
+    {"fbm_oct6", 1, FBmOctaves<6>},
+    {"fbm_oct7", 1, FBmOctaves<7>},
+    {"fbm_oct8", 1, FBmOctaves<8>},
+    {"fbm_batch_4x7", 4, FBmBatch4x7},
+    {"fbm_table_oct5", 1, FbmTableOct5},
+    {"fbm_lod_zoom_1_1024", 1, FbmLodZoom<-10>},
+    {"fbm_lod_zoom_1_8", 1, FbmLodZoom<-3>},
+    {"fbm_lod_zoom_1", 1, FbmLodZoom<0>},
+    {"fbm_lod_zoom_32", 1, FbmLodZoom<5>},
+    {"quantize_cv_eq", 1, QuantizeCv<false>},
+    {"quantize_cv_just", 1, QuantizeCv<true>},
+    {"quantize_just_major", 1, QuantizeJust},
+    {"random_freq_none", 1, RandomFreq<0, false>},
+    {"random_freq_12tet", 1, RandomFreq<1, false>},
+    {"random_freq_just", 1, RandomFreq<1, true>},
+    {"slew_limiter", 1, Slew},
+    {"randos_voices_4", 1, RandosVoices4},
+    {"osc_quad_glide", kBlock, OscQuadGlide},
+    {"osc_quad_held", kBlock, OscQuadHeld},
+    {"osc_sine_pair", kBlock, OscSinePair},
+};
+
+// ----------------------------------------------------
+// Timing
+// ----------------------------------------------------
+struct Result
+{
+    const Bench *bench;
+    double       ns_per_call;
+    double       cycles_per_call;
+};
+
+static double NowNs()
+{
+    return std::chrono::duration<double, std::nano>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static Result Measure(const Bench &b)
+{
+    const double kMinRunNs = 2e6;
+    const int    kRuns     = 31;
+
+    // grow the call count until one run takes 2 ms
+    int    calls = 1000;
+    double t;
+    for(;;)
+    {
+        double t0 = NowNs();
+        g_sink += b.run(calls);
+        t = NowNs() - t0;
+        if(t >= kMinRunNs || calls >= (1 << 28))
+            break;
+        calls *= t * 4 < kMinRunNs ? 4 : 2;
+    }
+
+    Result r = {&b, 1e30, 1e30};
+    for(int k = 0; k < kRuns; k++)
+    {
+        double   t0 = NowNs();
+        uint32_t c0 = CycleCount();
+        g_sink += b.run(calls);
+        uint32_t c1 = CycleCount();
+        double   t1 = NowNs();
+        double   ns = (t1 - t0) / calls;
+        double   cy = (double)(uint32_t)(c1 - c0) / calls;
+        if(ns < r.ns_per_call)
+            r.ns_per_call = ns;
+        if(cy < r.cycles_per_call)
+            r.cycles_per_call = cy;
+    }
+    return r;
+}
+
+// ----------------------------------------------------
+// JSON out, one result per line so the baseline reader
+// stays a line scanner
+// ----------------------------------------------------
+static std::string HostName()
+{
+    char name[256] = {0};
+    if(gethostname(name, sizeof(name) - 1) != 0)
+        return "unknown";
+    return name;
+}
+
+static void WriteJson(FILE *f, const std::vector<Result> &results)
+{
+    fprintf(f, "{\n");
+    fprintf(f, "  \"suite\": \"dsp_bench\",\n");
+    fprintf(f, "  \"host\": \"%s\",\n", HostName().c_str());
+    fprintf(f, "  \"compiler\": \"%s\",\n", __VERSION__);
+    fprintf(f, "  \"results\": [\n");
+    for(size_t i = 0; i < results.size(); i++)
+    {
+        const Result &r = results[i];
+        fprintf(f,
+                "    {\"name\": \"%s\", \"ns_per_call\": %.3f, "
+                "\"cycles_per_call\": %.2f, \"cycles_per_sample\": %.2f}%s\n",
+                r.bench->name,
+                r.ns_per_call,
+                r.cycles_per_call,
+                r.cycles_per_call / r.bench->samples_per_call,
+                i + 1 < results.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+}
+
+struct Baseline
+{
+    std::string name;
+    double      ns_per_call;
+};
+
+struct BaselineFile
+{
+    std::string           host, compiler;
+    std::vector<Baseline> results;
+};
+
+// the string value of "key": "..." in line, if it's there
+static bool StringField(const char *line, const char *key, std::string &out)
+{
+    std::string pat = std::string("\"") + key + "\": \"";
+    const char *v   = strstr(line, pat.c_str());
+    if(!v)
+        return false;
+    v += pat.size();
+    const char *end = strchr(v, '"');
+    if(!end)
+        return false;
+    out = std::string(v, end - v);
+    return true;
+}
+
+static bool LoadBaseline(const char *path, BaselineFile &file)
+{
+    FILE *f = fopen(path, "r");
+    if(!f)
+        return false;
+    std::vector<Baseline> &out = file.results;
+    char                   line[512];
+    while(fgets(line, sizeof(line), f))
+    {
+        if(StringField(line, "host", file.host)
+           || StringField(line, "compiler", file.compiler))
+            continue;
+        const char *n  = strstr(line, "\"name\": \"");
+        const char *ns = strstr(line, "\"ns_per_call\": ");
+        if(!n || !ns)
+            continue;
+        n += strlen("\"name\": \"");
+        const char *end = strchr(n, '"');
+        if(!end)
+            continue;
+        Baseline b;
+        b.name        = std::string(n, end - n);
+        b.ns_per_call = atof(ns + strlen("\"ns_per_call\": "));
+        out.push_back(b);
+    }
+    fclose(f);
+    return true;
+}
+
+static const Baseline *Find(const std::vector<Baseline> &base,
+                           const char *                 name)
+{
+    for(const Baseline &b : base)
+        if(b.name == name)
+            return &b;
+    return nullptr;
+}
+
+static bool Slower(const Result &r, const Baseline *b, double threshold_pct)
+{
+    return b && b->ns_per_call > 0.0
+           && r.ns_per_call > b->ns_per_call * (1.0 + threshold_pct / 100.0);
+}
+
+// returns the number of regressions
+static int Compare(const std::vector<Result> &  results,
+                   const std::vector<Baseline> &base,
+                   double                       threshold_pct)
+{
+    int regressions = 0;
+    fprintf(stderr,
+            "%-22s %10s %10s %8s\n",
+            "benchmark",
+            "base ns",
+            "now ns",
+            "change");
+    for(const Result &r : results)
+    {
+        const Baseline *b = Find(base, r.bench->name);
+        if(!b || b->ns_per_call <= 0.0)
+        {
+            fprintf(stderr,
+                    "%-22s %10s %10.3f %8s\n",
+                    r.bench->name,
+                    "-",
+                    r.ns_per_call,
+                    "new");
+            continue;
+        }
+        double pct  = 100.0 * (r.ns_per_call / b->ns_per_call - 1.0);
+        bool   slow = Slower(r, b, threshold_pct);
+        fprintf(stderr,
+                "%-22s %10.3f %10.3f %+7.1f%%%s\n",
+                r.bench->name,
+                b->ns_per_call,
+                r.ns_per_call,
+                pct,
+                slow ? "  REGRESSION" : "");
+        if(slow)
+            regressions++;
+    }
+    return regressions;
+}
+
+static int Usage()
+{
+    fprintf(stderr,
+            "usage: dsp_bench [-o out.json] [-b baseline.json] "
+            "[-x percent] [-f filter]\n");
+    return 2;
+}
+
+int main(int argc, char **argv)
+{
+    const char *out_path  = nullptr;
+    const char *base_path = nullptr;
+    const char *filter    = nullptr;
+    double      threshold = 15.0;
+    for(int i = 1; i < argc; i++)
+    {
+        const char *a   = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : nullptr;
+        if(!val)
+            return Usage();
+        if(!strcmp(a, "-o"))
+            out_path = val;
+        else if(!strcmp(a, "-b"))
+            base_path = val;
+        else if(!strcmp(a, "-x"))
+            threshold = atof(val);
+        else if(!strcmp(a, "-f"))
+            filter = val;
+        else
+            return Usage();
+        i++;
+    }
+
+    BaselineFile file;
+    if(base_path && !LoadBaseline(base_path, file))
+    {
+        fprintf(stderr, "can't read %s\n", base_path);
+        return 2;
+    }
+    // absolute times from another machine or compiler say
+    // nothing about this build
+    std::string host = HostName();
+    if(base_path && (file.host != host || file.compiler != __VERSION__))
+    {
+        fprintf(stderr,
+                "%s was recorded on %s with %s, this is %s with %s: "
+                "not compared ('make bench-baseline' records one here)\n",
+                base_path,
+                file.host.empty() ? "an unknown host" : file.host.c_str(),
+                file.compiler.empty() ? "an unknown compiler"
+                                      : file.compiler.c_str(),
+                host.c_str(),
+                __VERSION__);
+        base_path = nullptr;
+    }
+    const std::vector<Baseline> &base = file.results;
+
+    InitInputs();
+    g_noise.Init();
+    EnableCycleCounter();
+
+    std::vector<Result> results;
+    for(const Bench &b : kBenches)
+        if(!filter || strstr(b.name, filter))
+            results.push_back(Measure(b));
+
+    // re-measure anything slow, keep the best
+    for(Result &r : results)
+    {
+        const Baseline *b = Find(base, r.bench->name);
+        for(int k = 0; k < 2 && Slower(r, b, threshold); k++)
+        {
+            Result again = Measure(*r.bench);
+            if(again.ns_per_call < r.ns_per_call)
+                r = again;
+        }
+    }
+
+    FILE *f = out_path ? fopen(out_path, "w") : stdout;
+    if(!f)
+    {
+        fprintf(stderr, "can't write %s\n", out_path);
+        return 2;
+    }
+    WriteJson(f, results);
+    if(f != stdout)
+        fclose(f);
+
+    if(!base_path)
+        return 0;
+    int regressions = Compare(results, base, threshold);
+    if(regressions > 0)
+    {
+        fprintf(stderr,
+                "%d benchmark(s) more than %.0f%% slower than %s\n",
+                regressions,
+                threshold,
+                base_path);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,184 @@
+/**********************************************************
+   format_bench.cpp
+   Host check + benchmark for fixed_format.h
+
+   - Fixed(v, d) must give exactly the text of
+     snprintf("%.<d>f", v): edge cases, every exponent,
+     and a few million pseudo-random floats
+   - the unit helpers must match the strings the apps
+     printed before ("In: %.2fV", "Range: %.1f oct", ...)
+   - truncation must match snprintf
+   - then ns per call, TextWriter vs snprintf
+
+   Exit code is non-zero if any check fails.
+**********************************************************/
+
+#include "fixed_format.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+using namespace daisyex;
+
+static int g_failed = 0;
+
+static void Check(bool ok, const char *what)
+{
+    printf("%-48s %s\n", what, ok ? "ok" : "FAIL");
+    if(!ok)
+        g_failed++;
+}
+
+// compare one value/decimals pair, print the first few mismatches
+static bool Same(float v, int decimals, bool plus, int &reported)
+{
+    char ref[64], got[64];
+    snprintf(ref, sizeof(ref), plus ? "%+.*f" : "%.*f", decimals, (double)v);
+    FormatFixed(got, sizeof(got), v, decimals, plus);
+    if(strcmp(ref, got) == 0)
+        return true;
+    if(reported++ < 5)
+        printf("  %.9g d=%d: printf \"%s\" fixed \"%s\"\n",
+               v,
+               decimals,
+               ref,
+               got);
+    return false;
+}
+
+static uint32_t Lcg(uint32_t &s)
+{
+    s = s * 1664525u + 1013904223u;
+    return s;
+}
+
+static float FromBits(uint32_t bits)
+{
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+template <typename Fn>
+static double NsPerCall(Fn fn, int iterations)
+{
+    volatile size_t sink = 0;
+    auto            t0   = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations; i++)
+        sink = sink + fn(i);
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(t1 - t0).count()
+           / iterations;
+}
+
+int main()
+{
+    int reported = 0;
+
+    // edge cases
+    const float edges[] = {0.f,     -0.f,      0.005f,   0.015f,    0.125f,
+                           -0.125f, 2.675f,    0.5f,     1.5f,      2.5f,
+                           -0.001f, 9.995f,    99.95f,   7.9999f,   1e-30f,
+                           1e-45f,  123456.7f, 8.0e12f,  -3.14159f, 440.f,
+                           std::numeric_limits<float>::infinity(),
+                           -std::numeric_limits<float>::infinity()};
+    bool ok = true;
+    for(float v : edges)
+        for(int d = 0; d <= TextWriter::kMaxDecimals; d++)
+            ok &= Same(v, d, false, reported) & Same(v, d, true, reported);
+    Check(ok, "edge cases match printf");
+
+    // every exponent up to the documented range, both signs
+    ok = true;
+    uint32_t seed = 12345;
+    for(uint32_t exp = 0; exp < 127 + 43; exp++)
+        for(int k = 0; k < 200; k++)
+        {
+            uint32_t bits = (exp << 23) | (Lcg(seed) >> 9);
+            if(k & 1)
+                bits |= 0x80000000u;
+            ok &= Same(FromBits(bits), (int)(k % 7), false, reported);
+        }
+    Check(ok, "all exponents match printf");
+
+    // UI-sized values: 0..10000 with short fractions
+    ok = true;
+    for(int i = 0; i < 3000000; i++)
+    {
+        float v = (float)(Lcg(seed) >> 8) * (10000.f / 16777216.f);
+        ok &= Same(v, i % 4, false, reported);
+    }
+    Check(ok, "3M random UI values match printf");
+
+    // exact halves of the last digit (ties to even)
+    ok = true;
+    for(int i = 0; i < 4096; i++)
+        ok &= Same((float)i / 8.f, 2, false, reported)
+              & Same((float)i / 16.f, 3, false, reported);
+    Check(ok, "binary ties round half to even");
+
+    // the apps' strings
+    ok = true;
+    for(int i = 0; i < 8000; i++)
+    {
+        float v = (float)i * 0.001f;
+        char  ref[32], got[32];
+
+        snprintf(ref, sizeof(ref), "In: %.2fV", (double)v);
+        TextWriter(got, sizeof(got)).Str("In: ").Volts(v);
+        ok &= strcmp(ref, got) == 0;
+
+        snprintf(ref, sizeof(ref), "Range: %.1f oct", (double)v);
+        TextWriter(got, sizeof(got)).Str("Range: ").Octaves(v);
+        ok &= strcmp(ref, got) == 0;
+
+        snprintf(ref, sizeof(ref), "%.1fHz", (double)(v * 100.f));
+        TextWriter(got, sizeof(got)).Hz(v * 100.f);
+        ok &= strcmp(ref, got) == 0;
+
+        snprintf(ref, sizeof(ref), "%+.1fc", (double)(v * 10.f - 40.f));
+        TextWriter(got, sizeof(got)).Cents(v * 10.f - 40.f);
+        ok &= strcmp(ref, got) == 0;
+    }
+    Check(ok, "Volts/Octaves/Hz/Cents match app formats");
+
+    // truncation
+    ok = true;
+    for(size_t size = 0; size < 12; size++)
+    {
+        char ref[16], got[16];
+        memset(ref, 'x', sizeof(ref));
+        memset(got, 'x', sizeof(got));
+        snprintf(ref, size, "Eq: %.2fV", 3.25);
+        TextWriter(got, size).Str("Eq: ").Volts(3.25f);
+        ok &= memcmp(ref, got, sizeof(ref)) == 0;
+    }
+    Check(ok, "truncation matches snprintf");
+
+    // speed
+    const int kIter = 2000000;
+    char      buf[32];
+    double    ns_printf = NsPerCall(
+        [&](int i) {
+            return (size_t)snprintf(
+                buf, sizeof(buf), "In: %.2fV", (double)((float)i * 0.001f));
+        },
+        kIter);
+    double ns_fixed = NsPerCall(
+        [&](int i) {
+            return TextWriter(buf, sizeof(buf))
+                .Str("In: ")
+                .Volts((float)i * 0.001f)
+                .Length();
+        },
+        kIter);
+    printf("\n\"In: %%.2fV\"  snprintf %6.1f ns  TextWriter %6.1f ns  x%.1f\n",
+           ns_printf,
+           ns_fixed,
+           ns_printf / ns_fixed);
+
+    printf("%s\n", g_failed ? "FAILED" : "all checks passed");
+    return g_failed ? 1 : 0;
+}
@@ -0,0 +1,25 @@
+/**********************************************************
+   format_size.cpp
+   Code size of the UI formatting, float printf vs
+   fixed_format.h (see 'make size' in the Makefile)
+
+   Built twice: with -DUSE_PRINTF the line is formatted
+   with snprintf("%.2fV") and linked with -u _printf_float,
+   otherwise with TextWriter. Compare the .text columns.
+**********************************************************/
+
+#include <cstdio>
+#include "fixed_format.h"
+
+volatile float g_value = 3.25f;
+char           g_buf[32];
+
+int main()
+{
+#ifdef USE_PRINTF
+    snprintf(g_buf, sizeof(g_buf), "In: %.2fV", (double)g_value);
+#else
+    daisyex::TextWriter(g_buf, sizeof(g_buf)).Str("In: ").Volts(g_value);
+#endif
+    return g_buf[0];
+}
@@ -0,0 +1,120 @@
+/**********************************************************
+   oled_check.cpp
+   Host check for the double-buffered OLED driver
+   (oled_dma.h) against the emulated panel in oled_host.h
+
+   - after Update() the panel RAM matches the back buffer
+   - drawing while a transfer is in flight doesn't leak
+     into the frame being sent
+   - only the dirty page span goes over the bus, and an
+     unchanged frame sends nothing
+
+   Exit code is non-zero if any check fails. Pass -d to
+   dump the final frame as text.
+**********************************************************/
+
+#include "oled_dma.h"
+#include "oled_host.h"
+#include <cstdio>
+#include <cstring>
+
+using namespace daisyex;
+
+typedef HostOledTransport<128, 64>               Panel;
+typedef DoubleBufferedOledDriver<128, 64, Panel> Driver;
+
+static int g_failed = 0;
+
+static void Check(bool ok, const char *what)
+{
+    printf("%-48s %s\n", what, ok ? "ok" : "FAIL");
+    if(!ok)
+        g_failed++;
+}
+
+static bool PanelMatches(Driver &d)
+{
+    return memcmp(d.GetTransport().Ram(), d.BackBuffer(), Driver::kBufferSize)
+           == 0;
+}
+
+static void Rect(Driver &d, int x0, int y0, int x1, int y1, bool on)
+{
+    for(int y = y0; y <= y1; y++)
+        for(int x = x0; x <= x1; x++)
+            d.DrawPixel(x, y, on);
+}
+
+int main(int argc, char **argv)
+{
+    static uint8_t front[Driver::kBufferSize];
+    static Driver  d;
+    Driver::Config cfg;
+    cfg.front_buffer = front;
+    d.Init(cfg);
+    Panel &panel = d.GetTransport();
+
+    // first frame clears the whole panel
+    Rect(d, 10, 3, 40, 20, true);
+    d.Update();
+    Check(PanelMatches(d), "first frame matches back buffer");
+    Check(panel.DataBytes() == Driver::kBufferSize,
+          "first frame sends all pages");
+
+    // one page changed => one page sent
+    uint32_t bytes = panel.DataBytes();
+    Rect(d, 0, 40, 127, 45, true); // page 5
+    d.Update();
+    Check(PanelMatches(d), "partial frame matches back buffer");
+    Check(panel.DataBytes() - bytes == 128, "partial frame sends one page");
+
+    // redrawing identical pixels isn't a change
+    bytes = panel.DataBytes();
+    uint32_t transfers = panel.Transfers();
+    Rect(d, 0, 40, 127, 45, true);
+    d.Update();
+    Check(panel.Transfers() == transfers && panel.DataBytes() == bytes,
+          "unchanged frame sends nothing");
+    Check(d.GetStats().skipped == 1, "unchanged frame counted as skipped");
+
+    // pages 1 and 3 dirty => span 1..3
+    bytes = panel.DataBytes();
+    d.DrawPixel(5, 9, true);
+    d.DrawPixel(5, 25, true);
+    d.Update();
+    Check(panel.DataBytes() - bytes == 3 * 128, "dirty span 1..3 sent");
+    Check(PanelMatches(d), "span frame matches back buffer");
+
+    // double buffering: keep drawing while the frame is in flight
+    panel.SetManualComplete(true);
+    Rect(d, 60, 0, 70, 63, true);
+    d.Update();
+    Check(d.Busy() && panel.InFlight(), "transfer in flight after Update()");
+    static uint8_t expect[Driver::kBufferSize];
+    memcpy(expect, d.BackBuffer(), sizeof(expect));
+
+    d.Fill(false);
+    Rect(d, 100, 50, 120, 60, true);
+    panel.Complete();
+    Check(memcmp(panel.Ram(), expect, sizeof(expect)) == 0,
+          "in-flight frame unaffected by new drawing");
+    Check(!d.Busy(), "driver idle after completion");
+
+    d.Update();
+    panel.Complete();
+    Check(PanelMatches(d), "next frame matches back buffer");
+
+    const Driver::Stats &st = d.GetStats();
+    printf("\nframes %u  skipped %u  waits %u  pages %u (%.1f per frame)\n",
+           (unsigned)st.frames,
+           (unsigned)st.skipped,
+           (unsigned)st.waits,
+           (unsigned)st.pages,
+           st.frames ? (double)st.pages / st.frames : 0.0);
+
+    if(argc > 1 && strcmp(argv[1], "-d") == 0)
+        panel.Dump(stdout);
+
+    printf("%s\n", g_failed ? "FAILED" : "all checks passed");
+    return g_failed ? 1 : 0;
+}
@@ -0,0 +1,263 @@
+/**********************************************************
+   phase_check.cpp
+   Soak check for the fixed-point timing in phase_clock.h
+
+   Runs PhaseAccumulator and SampleTimer over simulated
+   hours of audio at 48 kHz, in blocks, and checks every
+   event against its closed-form sample:
+     wrap j of a PhaseAccumulator   tick ceil(j 2^32 / inc)
+     event j of a periodic timer    tick floor(j P)
+   (P the 32.32 period, ticks counted from 1), so any
+   drift, however small, shows up as a wrong sample.
+   Also checks that Tick() and Advance() agree sample for
+   sample over random block sizes, FireIn() one-shots and
+   that a period change keeps the elapsed part of the
+   cycle.
+
+   For comparison it runs the float accumulators the apps
+   used (phase += inc; if(phase >= 1) phase -= 1) over the
+   same time and prints how far their last event lands
+   from the exact one.
+
+       phase_check [-H hours]      (default 6)
+
+   Exit code is non-zero if any check fails.
+**********************************************************/
+
+#include "phase_clock.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace daisyex;
+
+static const float  kSampleRate = 48000.f;
+static const size_t kBlock      = 48;
+
+static int g_failed = 0;
+
+static void Check(bool ok, const char *what)
+{
+    printf("%-56s %s\n", what, ok ? "ok" : "FAIL");
+    if(!ok)
+        g_failed++;
+}
+
+typedef unsigned __int128 u128;
+
+// blocks of kBlock; every wrap against ceil(j 2^32 / inc)
+static bool SoakPhase(float hz, uint64_t samples, uint64_t &events)
+{
+    PhaseAccumulator p;
+    p.SetFreq(hz, kSampleRate);
+    u128     inc = p.Inc();
+    uint16_t at[kBlock];
+    events       = 0;
+    for(uint64_t t = 0; t < samples; t += kBlock)
+    {
+        size_t n = p.Advance(kBlock, at, kBlock);
+        for(size_t e = 0; e < n; e++)
+        {
+            events++;
+            u128 want = (((u128)events << 32) + inc - 1) / inc;
+            if(t + at[e] + 1 != want)
+                return false;
+        }
+    }
+    // nothing missed at the end either
+    u128 total = ((u128)samples * inc) >> 32;
+    return total == events;
+}
+
+// blocks of kBlock; every event against floor(j P)
+static bool SoakTimer(uint64_t period, uint64_t samples, uint64_t &events)
+{
+    SampleTimer tm;
+    tm.Start(period);
+    uint16_t at[kBlock];
+    events = 0;
+    for(uint64_t t = 0; t < samples; t += kBlock)
+    {
+        size_t n = tm.Advance(kBlock, at, kBlock);
+        for(size_t e = 0; e < n; e++)
+        {
+            events++;
+            u128 want = ((u128)events * period) >> 32;
+            if(t + at[e] + 1 != want)
+                return false;
+        }
+    }
+    u128 total = ((u128)samples << 32) / period;
+    return total == events;
+}
+
+// how far (in samples) the float accumulator's last event
+// is from the exact one, after 'samples'
+static double FloatPhaseDrift(float inc, uint64_t samples)
+{
+    float    phase = 0.f;
+    uint64_t last  = 0, count = 0;
+    for(uint64_t t = 1; t <= samples; t++)
+    {
+        phase += inc;
+        if(phase >= 1.f)
+        {
+            phase -= 1.f;
+            last = t;
+            count++;
+        }
+    }
+    return (double)last - (double)count / (double)inc;
+}
+
+// patch FractalZoom's note clock: phase += 1/sr until it
+// reaches 'seconds'; the sample it ends on vs the exact one
+// (past 512 s the add rounds to nothing: capped at 2x)
+static double FloatNoteDrift(float seconds)
+{
+    float    phase = 0.f, inc = 1.f / kSampleRate;
+    uint64_t t     = 0;
+    while(phase < seconds && t < 2 * (uint64_t)(seconds * kSampleRate))
+    {
+        phase += inc;
+        t++;
+    }
+    return (double)t - (double)seconds * kSampleRate;
+}
+
+static bool TickMatchesAdvance(uint32_t seed)
+{
+    PhaseAccumulator a, b;
+    SampleTimer      ta, tb;
+    a.SetFreq(7.3f, kSampleRate);
+    b.SetFreq(7.3f, kSampleRate);
+    ta.Start(SampleTimer::Samples(1234.567f));
+    tb.Start(SampleTimer::Samples(1234.567f));
+    uint16_t at[128], tat[128];
+    for(int blk = 0; blk < 200000; blk++)
+    {
+        seed     = seed * 1664525u + 1013904223u;
+        size_t n = 1 + (seed >> 8) % 128;
+        size_t na = a.Advance(n, at, 128);
+        size_t nt = ta.Advance(n, tat, 128);
+        size_t ea = 0, et = 0;
+        for(size_t i = 0; i < n; i++)
+        {
+            if(b.Tick() && (ea >= na || at[ea++] != i))
+                return false;
+            if(tb.Tick() && (et >= nt || tat[et++] != i))
+                return false;
+        }
+        if(ea != na || et != nt || a.Raw() != b.Raw())
+            return false;
+        if(ta.SamplesLeft() != tb.SamplesLeft())
+            return false;
+    }
+    return true;
+}
+
+static bool OneShots()
+{
+    for(uint32_t k = 1; k < 300; k += 7)
+    {
+        SampleTimer tm;
+        tm.FireIn(k);
+        uint16_t at[4];
+        size_t   n = 0, fired_at = 0, t = 0;
+        while(tm.Armed())
+        {
+            size_t got = tm.Advance(16, at, 4);
+            if(got)
+            {
+                n += got;
+                fired_at = t + at[0] + 1;
+            }
+            t += 16;
+        }
+        if(n != 1 || fired_at != k || tm.Advance(1000) != 0)
+            return false;
+    }
+    return true;
+}
+
+static bool PeriodChange()
+{
+    uint16_t    at[32];
+    SampleTimer longer, shorter;
+    // 50 ticks into a 100-tick cycle: at 150 the event is
+    // 100 ticks away, at 10 it is overdue and fires next
+    longer.Start(100ull << 32);
+    longer.Advance(50);
+    longer.SetPeriod(150ull << 32);
+    size_t nl = longer.Advance(100, at, 32);
+    bool   ok = nl == 1 && at[0] == 99;
+    shorter.Start(100ull << 32);
+    shorter.Advance(50);
+    shorter.SetPeriod(10ull << 32);
+    size_t ns = shorter.Advance(100, at, 32);
+    return ok && ns == 10 && at[0] == 0 && at[1] == 10 && at[9] == 90;
+}
+
+int main(int argc, char **argv)
+{
+    double hours = 6.0;
+    for(int i = 1; i + 1 < argc; i += 2)
+        if(!strcmp(argv[i], "-H"))
+            hours = atof(argv[i + 1]);
+    uint64_t samples = (uint64_t)(hours * 3600.0 * kSampleRate);
+    samples -= samples % kBlock;
+    char     what[96];
+    uint64_t events;
+
+    printf("%.1f simulated hours, %llu samples, %zu-sample blocks\n",
+           hours,
+           (unsigned long long)samples,
+           kBlock);
+
+    // Randos step rates (0.25 .. 16 Hz) and some odd ones
+    const float kRates[] = {0.25f, 1.f, 7.3f, 16.f, 440.f, 4186.f};
+    for(float hz : kRates)
+    {
+        bool ok = SoakPhase(hz, samples, events);
+        snprintf(what,
+                 sizeof(what),
+                 "phase %7.2f Hz: %llu wraps on their samples",
+                 hz,
+                 (unsigned long long)events);
+        Check(ok, what);
+    }
+
+    // pod eval intervals (1..30 Hz) and loop lengths
+    const float kPeriods[] = {48000.f / 3.f, 1600.f, 48000.f / 7.f,
+                              24000.5f,     96000.f, 480000.f};
+    for(float p : kPeriods)
+    {
+        bool ok = SoakTimer(SampleTimer::Samples(p), samples, events);
+        snprintf(what,
+                 sizeof(what),
+                 "timer %9.3f smp: %llu events on their samples",
+                 p,
+                 (unsigned long long)events);
+        Check(ok, what);
+    }
+
+    Check(TickMatchesAdvance(1), "Tick() and Advance() agree, random blocks");
+    Check(OneShots(), "FireIn(k) fires once, on tick k");
+    Check(PeriodChange(), "SetPeriod() keeps the elapsed part of the cycle");
+
+    // the float versions over the same time, for scale
+    printf("float accumulators over the same time:\n");
+    const float kFloatRates[] = {1.f, 7.3f};
+    const float kNoteLengths[] = {5.f, 60.f, 300.f};
+    for(float hz : kFloatRates)
+        printf("  phase += %.2f/sr    last step off by %+.1f samples\n",
+               hz,
+               FloatPhaseDrift(hz / kSampleRate, samples));
+    for(float s : kNoteLengths)
+        printf("  t += 1/sr to %4.0f s ends %+.0f samples off\n",
+               s,
+               FloatNoteDrift(s));
+
+    return g_failed ? 1 : 0;
+}
@@ -0,0 +1,159 @@
+/**********************************************************
+   pitch_bench.cpp
+   Host benchmark: per-step pitch cost in Randos before
+   and after pitch_tables.h
+
+   The "legacy" functions are copies of what the apps
+   did before (powf per call); the table side times the
+   shipped ones from patch/Randos/randos_voices.h. Both
+   run the same seeds so the work is identical, and the
+   two must pick the same pitches.
+**********************************************************/
+
+#include "pitch_tables.h"
+#include "randos_voices.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+using namespace daisyex;
+
+// ----------------------------------------------------
+// Legacy versions (Rand01 is the apps' LCG)
+// ----------------------------------------------------
+static float LegacyMidiToFreq(int note)
+{
+    return 440.f * powf(2.f, (note - 69.f) / 12.f);
+}
+
+static float LegacyJustRandomFreq(uint32_t &seed, float baseFreq, float range)
+{
+    float r1  = Rand01(seed);
+    int   idx = (int)(r1 * 8);
+    if(idx >= 8) idx = 7;
+    float r2        = Rand01(seed);
+    int   maxOctI   = (int)range;
+    int   octPicked = (int)(r2 * (maxOctI + 1));
+    if(octPicked > maxOctI) octPicked = maxOctI;
+    float ratio = kJustMajor8[idx] * powf(2.f, (float)octPicked);
+    return baseFreq * ratio;
+}
+
+static float LegacyRandomQuantizedFreq(uint32_t &seed, const PitchSettings &ps)
+{
+    if(ps.rootIndex == 0)
+        return 50.f + 1950.f * Rand01(seed);
+
+    int   rootSemitone = ps.rootIndex - 1;
+    float baseFreq     = LegacyMidiToFreq(48 + rootSemitone);
+    if(ps.justOn)
+        return LegacyJustRandomFreq(seed, baseFreq, ps.octRange);
+
+    float r        = Rand01(seed);
+    int   pickI    = (int)(r * 12.f * ps.octRange);
+    int   fullOct  = pickI / 12;
+    int   leftover = pickI % 12;
+    int   chosen   = 0;
+    for(int i = 0; i < 8; i++)
+    {
+        if(MAJOR_OFFSETS[i] <= leftover)
+            chosen = MAJOR_OFFSETS[i];
+        else
+            break;
+    }
+    int midinote = 48 + fullOct * 12 + chosen + rootSemitone;
+    if(midinote > 127) midinote = 127;
+    return LegacyMidiToFreq(midinote);
+}
+
+// ----------------------------------------------------
+// Timing helper
+// ----------------------------------------------------
+static volatile float g_sink;
+
+template <typename Fn>
+static double NsPerCall(Fn fn, int iterations)
+{
+    auto  t0  = std::chrono::steady_clock::now();
+    float acc = 0.f;
+    for(int i = 0; i < iterations; i++)
+        acc += fn(i);
+    auto t1 = std::chrono::steady_clock::now();
+    g_sink  = acc;
+    return std::chrono::duration<double, std::nano>(t1 - t0).count()
+           / iterations;
+}
+
+int main()
+{
+    const int kIter = 10000000;
+
+    // accuracy check first
+    double maxCents = 0.0;
+    for(int n = 0; n < 128; n++)
+    {
+        double ref   = 440.0 * pow(2.0, (n - 69.0) / 12.0);
+        double cents = fabs(1200.0 * log2(MidiToFreq(n) / ref));
+        if(cents > maxCents)
+            maxCents = cents;
+    }
+    printf("MidiToFreq table max error : %.6f cents\n", maxCents);
+
+    // the shipped pickers against the legacy ones, same seeds
+    const PitchSettings kModes[3] = {{1, 3.f, true}, {1, 3.f, false}, {0, 3.f, false}};
+    double maxPickCents = 0.0;
+    for(const PitchSettings &ps : kModes)
+    {
+        uint32_t a = 99u, b = 99u;
+        for(int i = 0; i < 100000; i++)
+        {
+            double cents = fabs(1200.0
+                                * log2(RandomQuantizedFreq(a, ps)
+                                       / LegacyRandomQuantizedFreq(b, ps)));
+            if(cents > maxPickCents)
+                maxPickCents = cents;
+        }
+    }
+    printf("RandomQuantizedFreq vs powf: %.6f cents max\n", maxPickCents);
+
+    double midiLegacy
+        = NsPerCall([](int i) { return LegacyMidiToFreq(i & 127); }, kIter);
+    double midiTable
+        = NsPerCall([](int i) { return MidiToFreq(i & 127); }, kIter);
+
+    uint32_t seedA = 1234u;
+    double   justLegacy
+        = NsPerCall([&](int) { return LegacyJustRandomFreq(seedA, 130.8f, 6.f); },
+                    kIter);
+    uint32_t seedB = 1234u;
+    double   justTable
+        = NsPerCall([&](int) { return JustRandomFreq(seedB, 130.8f, 6.f); },
+                    kIter);
+
+    const PitchSettings kTet = {1, 3.f, false};
+    uint32_t            seedC = 1234u;
+    double              quantLegacy = NsPerCall(
+        [&](int) { return LegacyRandomQuantizedFreq(seedC, kTet); }, kIter);
+    uint32_t seedD = 1234u;
+    double   quantTable
+        = NsPerCall([&](int) { return RandomQuantizedFreq(seedD, kTet); },
+                    kIter);
+
+    printf("%-22s %10s %10s %8s\n", "per-step op", "powf ns", "table ns", "speedup");
+    printf("%-22s %10.2f %10.2f %7.2fx\n",
+           "MidiToFreq",
+           midiLegacy,
+           midiTable,
+           midiLegacy / midiTable);
+    printf("%-22s %10.2f %10.2f %7.2fx\n",
+           "JustRandomFreq",
+           justLegacy,
+           justTable,
+           justLegacy / justTable);
+    printf("%-22s %10.2f %10.2f %7.2fx\n",
+           "RandomQuantizedFreq",
+           quantLegacy,
+           quantTable,
+           quantLegacy / quantTable);
+    return 0;
+}
@@ -0,0 +1,672 @@
+/**********************************************************
+   daisy.h (host)
+   libDaisy stand-in for building the apps on Linux
+
+   Part of the host stub layer in utils/host. The app
+   sources compile unmodified against these headers (with
+   daisy_patch.h, daisy_pod.h and daisysp.h from this
+   directory) and run on a simulated clock kept by
+   host_board.cpp:
+
+     - the audio callback runs once per block of simulated
+       time and TimerHandle callbacks at their period,
+       both as "interrupts"
+     - WFI (scheduler.h) and System::Delay() advance the
+       clock to the next interrupt or the end of the delay
+     - knobs/CVs, gate inputs, buttons, the encoder and
+       MIDI come from a script (host_board.h)
+     - DAC writes and GPIO edges are captured with their
+       time; the Patch OLED is an emulated SSD130x fed by
+       the SPI and DC pin stubs
+
+   Only the parts of the libDaisy API the apps in this
+   repo use are here.
+**********************************************************/
+#pragma once
+#ifndef DAISYHOST_DAISY_H
+#define DAISYHOST_DAISY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef DAISY_HOST
+#define DAISY_HOST 1
+#endif
+
+// memory sections are plain RAM on the host
+#define DMA_BUFFER_MEM_SECTION
+#define DTCM_MEM_SECTION
+#define DSY_SDRAM_BSS
+
+// ----------------------------------------------------
+// GPIO (C API); writes are logged as edges
+// ----------------------------------------------------
+typedef enum
+{
+    DSY_GPIOA,
+    DSY_GPIOB,
+    DSY_GPIOC,
+    DSY_GPIOD,
+    DSY_GPIOE,
+    DSY_GPIOF,
+    DSY_GPIOG,
+    DSY_GPIOH,
+    DSY_GPIOI,
+    DSY_GPIOJ,
+    DSY_GPIOK,
+    DSY_GPIOX,
+    DSY_GPIO_LAST,
+} dsy_gpio_port;
+
+typedef struct
+{
+    dsy_gpio_port port;
+    uint8_t       pin;
+} dsy_gpio_pin;
+
+typedef enum
+{
+    DSY_GPIO_MODE_INPUT,
+    DSY_GPIO_MODE_OUTPUT_PP,
+    DSY_GPIO_MODE_OUTPUT_OD,
+    DSY_GPIO_MODE_ANALOG,
+    DSY_GPIO_MODE_LAST,
+} dsy_gpio_mode;
+
+typedef enum
+{
+    DSY_GPIO_NOPULL,
+    DSY_GPIO_PULLUP,
+    DSY_GPIO_PULLDOWN,
+} dsy_gpio_pull;
+
+typedef struct
+{
+    dsy_gpio_pin  pin;
+    dsy_gpio_mode mode;
+    dsy_gpio_pull pull;
+} dsy_gpio;
+
+void    dsy_gpio_init(const dsy_gpio *p);
+void    dsy_gpio_deinit(const dsy_gpio *p);
+uint8_t dsy_gpio_read(const dsy_gpio *p);
+void    dsy_gpio_write(const dsy_gpio *p, uint8_t state);
+void    dsy_gpio_toggle(const dsy_gpio *p);
+
+// ----------------------------------------------------
+// Fonts: sizes only, glyphs are placeholder patterns
+// ----------------------------------------------------
+typedef struct
+{
+    const uint8_t   FontWidth;
+    uint8_t         FontHeight;
+    const uint16_t *data;
+} FontDef;
+
+extern FontDef Font_6x8;
+extern FontDef Font_7x10;
+extern FontDef Font_11x18;
+extern FontDef Font_16x26;
+
+namespace daisyhost
+{
+// host_board.cpp side of the stubs below
+void WaitForInterrupt();
+void PanelWriteFrame(const uint8_t *frame, size_t size);
+} // namespace daisyhost
+
+namespace daisy
+{
+// ----------------------------------------------------
+// System: simulated time
+// ----------------------------------------------------
+class System
+{
+  public:
+    static void     Delay(uint32_t ms);
+    static void     DelayUs(uint32_t us);
+    static uint32_t GetNow();
+    static uint32_t GetUs();
+    static uint32_t GetTick();
+    static uint32_t GetTickFreq() { return 200000000; }
+    static uint32_t GetSysClkFreq() { return 480000000; }
+};
+
+// ----------------------------------------------------
+// Controls, read from the script in host_board.cpp
+// ----------------------------------------------------
+
+// same one-pole as libDaisy: coeff = 2 / (slew * rate)
+class AnalogControl
+{
+  public:
+    AnalogControl() : src_(nullptr), val_(0.f), coeff_(1.f) {}
+
+    void Init(const float *src, float update_rate, float slew_seconds = 0.002f)
+    {
+        src_   = src;
+        val_   = 0.f;
+        coeff_ = 1.f / (slew_seconds * update_rate * 0.5f);
+        if(coeff_ > 1.f)
+            coeff_ = 1.f;
+    }
+
+    float Process()
+    {
+        float target = src_ ? *src_ : 0.f;
+        val_ += coeff_ * (target - val_);
+        return val_;
+    }
+    float Value() const { return val_; }
+    void  SetCoeff(float coeff) { coeff_ = coeff; }
+
+  private:
+    const float *src_;
+    float        val_, coeff_;
+};
+
+class Switch
+{
+  public:
+    Switch() : src_(nullptr), state_(false), prev_(false) {}
+
+    void Init(const bool *src) { src_ = src; }
+    void Debounce()
+    {
+        prev_  = state_;
+        state_ = src_ && *src_;
+    }
+    bool Pressed() const { return state_; }
+    bool RisingEdge() const { return state_ && !prev_; }
+    bool FallingEdge() const { return !state_ && prev_; }
+
+  private:
+    const bool *src_;
+    bool        state_, prev_;
+};
+
+class Encoder
+{
+  public:
+    Encoder() : turns_(nullptr), inc_(0) {}
+
+    // turns: increments queued by the script, taken on Debounce()
+    void Init(int *turns, const bool *pressed)
+    {
+        turns_ = turns;
+        sw_.Init(pressed);
+    }
+    void Debounce()
+    {
+        inc_ = turns_ ? *turns_ : 0;
+        if(turns_)
+            *turns_ = 0;
+        sw_.Debounce();
+    }
+    int  Increment() const { return inc_; }
+    bool Pressed() const { return sw_.Pressed(); }
+    bool RisingEdge() const { return sw_.RisingEdge(); }
+    bool FallingEdge() const { return sw_.FallingEdge(); }
+
+  private:
+    int *  turns_;
+    int    inc_;
+    Switch sw_;
+};
+
+class GateIn
+{
+  public:
+    GateIn() : src_(nullptr), prev_(false) {}
+
+    void Init(const bool *src) { src_ = src; }
+    bool State() const { return src_ && *src_; }
+    bool Trig()
+    {
+        bool s    = State();
+        bool trig = s && !prev_;
+        prev_     = s;
+        return trig;
+    }
+
+  private:
+    const bool *src_;
+    bool        prev_;
+};
+
+class RgbLed
+{
+  public:
+    RgbLed() : r_(0.f), g_(0.f), b_(0.f), updates_(0) {}
+
+    void Set(float r, float g, float b)
+    {
+        r_ = r;
+        g_ = g;
+        b_ = b;
+    }
+    void     Update() { updates_++; }
+    float    Red() const { return r_; }
+    float    Green() const { return g_; }
+    float    Blue() const { return b_; }
+    uint32_t Updates() const { return updates_; }
+
+  private:
+    float    r_, g_, b_;
+    uint32_t updates_;
+};
+
+// libDaisy's Parameter, including the Process() of the
+// control it wraps
+class Parameter
+{
+  public:
+    enum Curve
+    {
+        LINEAR,
+        EXPONENTIAL,
+        LOGARITHMIC,
+        CUBE,
+        LAST,
+    };
+
+    Parameter() : in_(nullptr), min_(0.f), max_(1.f), val_(0.f) {}
+
+    void  Init(AnalogControl &input, float min, float max, Curve curve);
+    float Process();
+    float Value() const { return val_; }
+
+  private:
+    AnalogControl *in_;
+    float          min_, max_, lmin_, lmax_, val_;
+    Curve          curve_;
+};
+
+// ----------------------------------------------------
+// Outputs
+// ----------------------------------------------------
+
+// 12-bit CV outs; every write is captured
+class DacHandle
+{
+  public:
+    enum class Channel
+    {
+        ONE,
+        TWO,
+        BOTH,
+    };
+    enum class Result
+    {
+        OK,
+        ERR,
+    };
+
+    Result WriteValue(Channel chn, uint16_t val);
+};
+
+// Logger over USB CDC => stdout
+class DaisySeed
+{
+  public:
+    void StartLog(bool wait_for_pc = false);
+    static void PrintLine(const char *format, ...)
+        __attribute__((format(printf, 1, 2)));
+    static void Print(const char *format, ...)
+        __attribute__((format(printf, 1, 2)));
+    void SetLed(bool state) { led_ = state; }
+    void DelayMs(size_t del) { System::Delay((uint32_t)del); }
+
+    DacHandle dac;
+
+  private:
+    bool led_ = false;
+};
+
+// ----------------------------------------------------
+// Audio
+// ----------------------------------------------------
+class AudioHandle
+{
+  public:
+    typedef const float *const *InputBuffer;
+    typedef float **            OutputBuffer;
+    typedef void (*AudioCallback)(InputBuffer  in,
+                                  OutputBuffer out,
+                                  size_t       size);
+};
+
+class SaiHandle
+{
+  public:
+    struct Config
+    {
+        enum class SampleRate
+        {
+            SAI_8KHZ,
+            SAI_16KHZ,
+            SAI_32KHZ,
+            SAI_48KHZ,
+            SAI_96KHZ,
+        };
+    };
+};
+
+// ----------------------------------------------------
+// MIDI: events come from the script's queue
+// ----------------------------------------------------
+enum MidiMessageType
+{
+    NoteOff,
+    NoteOn,
+    PolyphonicKeyPressure,
+    ControlChange,
+    ProgramChange,
+    ChannelPressure,
+    PitchBend,
+    SystemCommon,
+    SystemRealTime,
+    ChannelMode,
+    MessageLast,
+};
+
+enum SystemRealTimeType
+{
+    TimingClock,
+    SRTUndefined0,
+    Start,
+    Continue,
+    Stop,
+    SRTUndefined1,
+    ActiveSensing,
+    Reset,
+    SystemRealTimeLast,
+};
+
+struct MidiEvent
+{
+    MidiMessageType    type;
+    int                channel;
+    uint8_t            data[2];
+    SystemRealTimeType srt_type;
+};
+
+class MidiUartHandler
+{
+  public:
+    struct Config
+    {
+    };
+
+    MidiUartHandler() : head_(0), tail_(0) {}
+
+    void Init(Config config) {}
+    void StartReceive() {}
+    // moves the script's events that are due into the queue
+    void      Listen();
+    bool      HasEvents() const { return head_ != tail_; }
+    MidiEvent PopEvent()
+    {
+        MidiEvent ev = queue_[tail_];
+        tail_        = (tail_ + 1) % kQueueSize;
+        return ev;
+    }
+    void SendMessage(uint8_t *bytes, size_t size) {}
+
+  private:
+    static const size_t kQueueSize = 256;
+    MidiEvent           queue_[kQueueSize];
+    size_t              head_, tail_;
+};
+
+// ----------------------------------------------------
+// Timers: the callback runs at the period in simulated
+// time (the timer clock is 200 MHz like TIM2-5)
+// ----------------------------------------------------
+class TimerHandle
+{
+  public:
+    struct Config
+    {
+        enum class Peripheral
+        {
+            TIM_2,
+            TIM_3,
+            TIM_4,
+            TIM_5,
+        };
+        enum class CounterDir
+        {
+            UP,
+            DOWN,
+        };
+
+        Peripheral periph;
+        CounterDir dir;
+        bool       enable_irq;
+    };
+    enum class Result
+    {
+        OK,
+        ERR,
+    };
+    typedef void (*PeriodElapsedCallback)(void *data);
+
+    TimerHandle() : period_(0xFFFFFFFFu), cb_(nullptr), data_(nullptr) {}
+    ~TimerHandle();
+
+    Result Init(const Config &config)
+    {
+        config_ = config;
+        return Result::OK;
+    }
+    Result DeInit() { return Stop(); }
+    const Config &GetConfig() const { return config_; }
+
+    Result   SetPeriod(uint32_t ticks);
+    Result   Start();
+    Result   Stop();
+    uint32_t GetFreq() { return 200000000; }
+    uint32_t GetTick();
+    uint32_t GetPeriod() const { return period_; }
+    void     SetCallback(PeriodElapsedCallback cb, void *data = nullptr)
+    {
+        cb_   = cb;
+        data_ = data;
+    }
+
+    // called by host_board.cpp
+    void Elapsed()
+    {
+        if(cb_)
+            cb_(data_);
+    }
+
+  private:
+    Config                config_;
+    uint32_t              period_;
+    PeriodElapsedCallback cb_;
+    void *                data_;
+};
+
+// ----------------------------------------------------
+// SPI: transfers on SPI1 go to the emulated Patch OLED,
+// DC pin low = command bytes, high = display data. DMA
+// transfers complete before DmaTransmit() returns.
+// ----------------------------------------------------
+class SpiHandle
+{
+  public:
+    struct Config
+    {
+        enum class Peripheral
+        {
+            SPI_1,
+            SPI_2,
+            SPI_3,
+            SPI_4,
+            SPI_5,
+            SPI_6,
+        };
+        enum class Mode
+        {
+            MASTER,
+            SLAVE,
+        };
+        enum class Direction
+        {
+            TWO_LINES,
+            TWO_LINES_TX_ONLY,
+            TWO_LINES_RX_ONLY,
+            ONE_LINE,
+        };
+        enum class ClockPolarity
+        {
+            LOW,
+            HIGH,
+        };
+        enum class ClockPhase
+        {
+            ONE_EDGE,
+            TWO_EDGE,
+        };
+        enum class NSS
+        {
+            SOFT,
+            HARD_INPUT,
+            HARD_OUTPUT,
+        };
+        enum class BaudPrescaler
+        {
+            PS_2,
+            PS_4,
+            PS_8,
+            PS_16,
+            PS_32,
+            PS_64,
+            PS_128,
+            PS_256,
+        };
+
+        struct
+        {
+            dsy_gpio_pin sclk, miso, mosi, nss;
+        } pin_config;
+
+        Peripheral    periph;
+        Mode          mode;
+        Direction     direction;
+        unsigned long datasize;
+        ClockPolarity clock_polarity;
+        ClockPhase    clock_phase;
+        NSS           nss;
+        BaudPrescaler baud_prescaler;
+    };
+    enum class Result
+    {
+        OK,
+        ERR,
+    };
+    typedef void (*StartCallbackFunctionPtr)(void *context);
+    typedef void (*EndCallbackFunctionPtr)(void *context, Result result);
+
+    Result Init(const Config &config)
+    {
+        config_ = config;
+        return Result::OK;
+    }
+    Result BlockingTransmit(uint8_t *buff, size_t size, uint32_t timeout = 100);
+    Result DmaTransmit(uint8_t *                buff,
+                       size_t                   size,
+                       StartCallbackFunctionPtr start_callback,
+                       EndCallbackFunctionPtr   end_callback,
+                       void *                   callback_context);
+
+  private:
+    Config config_;
+};
+
+// ----------------------------------------------------
+// Displays
+// ----------------------------------------------------
+class OneBitGraphicsDisplay
+{
+  public:
+    OneBitGraphicsDisplay() : cursor_x_(0), cursor_y_(0) {}
+    virtual ~OneBitGraphicsDisplay() {}
+
+    virtual uint16_t Height() const = 0;
+    virtual uint16_t Width() const  = 0;
+    virtual void     Fill(bool on)  = 0;
+    virtual void     DrawPixel(uint_fast8_t x, uint_fast8_t y, bool on) = 0;
+    virtual void     Update() = 0;
+
+    void SetCursor(uint16_t x, uint16_t y)
+    {
+        cursor_x_ = x;
+        cursor_y_ = y;
+    }
+    void DrawLine(uint_fast8_t x1,
+                  uint_fast8_t y1,
+                  uint_fast8_t x2,
+                  uint_fast8_t y2,
+                  bool         on);
+    void DrawRect(uint_fast8_t x1,
+                  uint_fast8_t y1,
+                  uint_fast8_t x2,
+                  uint_fast8_t y2,
+                  bool         on,
+                  bool         fill = false);
+    // advances the cursor like libDaisy
+    char WriteChar(char ch, FontDef font, bool on);
+    char WriteString(const char *str, FontDef font, bool on);
+
+  protected:
+    uint16_t cursor_x_, cursor_y_;
+};
+
+template <class ChildType>
+class OneBitGraphicsDisplayImpl : public OneBitGraphicsDisplay
+{
+};
+
+// patch.display: a 128x64 frame buffer, Update() sends it
+// to the emulated panel
+class SSD130x4WireSpi128x64Driver
+{
+};
+
+template <typename DisplayDriver>
+class OledDisplay : public OneBitGraphicsDisplayImpl<OledDisplay<DisplayDriver>>
+{
+  public:
+    OledDisplay() { Fill(false); }
+
+    uint16_t Height() const override { return 64; }
+    uint16_t Width() const override { return 128; }
+    void     Fill(bool on) override
+    {
+        for(size_t i = 0; i < sizeof(buffer_); i++)
+            buffer_[i] = on ? 0xFF : 0x00;
+    }
+    void DrawPixel(uint_fast8_t x, uint_fast8_t y, bool on) override
+    {
+        if(x >= 128 || y >= 64)
+            return;
+        if(on)
+            buffer_[x + (y / 8) * 128] |= 1 << (y % 8);
+        else
+            buffer_[x + (y / 8) * 128] &= ~(1 << (y % 8));
+    }
+    void Update() override
+    {
+        daisyhost::PanelWriteFrame(buffer_, sizeof(buffer_));
+    }
+
+  private:
+    uint8_t buffer_[128 * 64 / 8];
+};
+
+} // namespace daisy
+
+#endif
@@ -0,0 +1,70 @@
+/**********************************************************
+   daisy_patch.h (host)
+   DaisyPatch on the host stub layer (see daisy.h)
+
+   controls[0..3] follow the script's knob values (knob
+   plus CV, 0..1), gate_input[] its gate levels, the
+   encoder its turns and presses. Audio runs four
+   channels; display is the emulated OLED.
+**********************************************************/
+#pragma once
+#ifndef DAISYHOST_DAISY_PATCH_H
+#define DAISYHOST_DAISY_PATCH_H
+
+#include "daisy.h"
+
+namespace daisy
+{
+class DaisyPatch
+{
+  public:
+    enum Ctrl
+    {
+        CTRL_1,
+        CTRL_2,
+        CTRL_3,
+        CTRL_4,
+        CTRL_LAST,
+    };
+    enum GateInput
+    {
+        GATE_IN_1,
+        GATE_IN_2,
+        GATE_IN_LAST,
+    };
+
+    void Init(bool boost = false);
+
+    void StartAudio(AudioHandle::AudioCallback cb);
+    void ChangeAudioCallback(AudioHandle::AudioCallback cb);
+    void StopAudio();
+    void SetAudioSampleRate(SaiHandle::Config::SampleRate samplerate);
+    void SetAudioBlockSize(size_t size);
+    size_t AudioBlockSize();
+    float  AudioSampleRate();
+    float  AudioCallbackRate();
+
+    void StartAdc() {}
+    void StopAdc() {}
+    void ProcessAnalogControls();
+    void ProcessDigitalControls();
+    void ProcessAllControls()
+    {
+        ProcessAnalogControls();
+        ProcessDigitalControls();
+    }
+    float GetKnobValue(Ctrl k) { return controls[k].Value(); }
+
+    void DelayMs(size_t del) { System::Delay((uint32_t)del); }
+
+    DaisySeed                                seed;
+    Encoder                                  encoder;
+    AnalogControl                            controls[CTRL_LAST];
+    GateIn                                   gate_input[GATE_IN_LAST];
+    MidiUartHandler                          midi;
+    OledDisplay<SSD130x4WireSpi128x64Driver> display;
+};
+
+} // namespace daisy
+
+#endif
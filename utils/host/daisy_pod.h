@@ -0,0 +1,80 @@
+/**********************************************************
+   daisy_pod.h (host)
+   DaisyPod on the host stub layer (see daisy.h)
+
+   knob1/knob2 follow the script's knobs 0 and 1,
+   button1/button2 its buttons, the encoder its turns and
+   presses. Audio runs two channels; the LEDs keep their
+   last color.
+**********************************************************/
+#pragma once
+#ifndef DAISYHOST_DAISY_POD_H
+#define DAISYHOST_DAISY_POD_H
+
+#include "daisy.h"
+
+namespace daisy
+{
+class DaisyPod
+{
+  public:
+    enum Sw
+    {
+        BUTTON_1,
+        BUTTON_2,
+        BUTTON_LAST,
+    };
+    enum Knob
+    {
+        KNOB_1,
+        KNOB_2,
+        KNOB_LAST,
+    };
+
+    void Init(bool boost = false);
+
+    void StartAudio(AudioHandle::AudioCallback cb);
+    void ChangeAudioCallback(AudioHandle::AudioCallback cb);
+    void StopAudio();
+    void SetAudioSampleRate(SaiHandle::Config::SampleRate samplerate);
+    void SetAudioBlockSize(size_t size);
+    size_t AudioBlockSize();
+    float  AudioSampleRate();
+    float  AudioCallbackRate();
+
+    void StartAdc() {}
+    void StopAdc() {}
+    void ProcessAnalogControls()
+    {
+        knob1.Process();
+        knob2.Process();
+    }
+    void ProcessDigitalControls()
+    {
+        encoder.Debounce();
+        button1.Debounce();
+        button2.Debounce();
+    }
+    void ProcessAllControls()
+    {
+        ProcessAnalogControls();
+        ProcessDigitalControls();
+    }
+    float GetKnobValue(Knob k)
+    {
+        return k == KNOB_1 ? knob1.Value() : knob2.Value();
+    }
+
+    void DelayMs(size_t del) { System::Delay((uint32_t)del); }
+
+    DaisySeed       seed;
+    Encoder         encoder;
+    AnalogControl   knob1, knob2;
+    Switch          button1, button2;
+    RgbLed          led1, led2;
+    MidiUartHandler midi;
+};
+
+} // namespace daisy
+
+#endif
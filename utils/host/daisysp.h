@@ -0,0 +1,162 @@
+/**********************************************************
+   daisysp.h (host)
+   The DaisySP pieces the apps use, for the host stub
+   layer (see daisy.h)
+
+   Oscillator follows DaisySP's: normalized phase,
+   naive and PolyBLEP waveforms, amplitude 0.5 by default,
+   so host renders sound like the module.
+**********************************************************/
+#pragma once
+#ifndef DAISYHOST_DAISYSP_H
+#define DAISYHOST_DAISYSP_H
+
+#include <stdint.h>
+#include <math.h>
+
+namespace daisysp
+{
+#ifndef PI_F
+#define PI_F 3.1415927410125732421875f
+#endif
+#ifndef TWOPI_F
+#define TWOPI_F (2.0f * PI_F)
+#endif
+
+inline float fclamp(float in, float min, float max)
+{
+    return in < min ? min : (in > max ? max : in);
+}
+
+inline float mtof(float m)
+{
+    return powf(2.f, (m - 69.0f) / 12.0f) * 440.0f;
+}
+
+class Oscillator
+{
+  public:
+    enum
+    {
+        WAVE_SIN,
+        WAVE_TRI,
+        WAVE_SAW,
+        WAVE_RAMP,
+        WAVE_SQUARE,
+        WAVE_POLYBLEP_TRI,
+        WAVE_POLYBLEP_SAW,
+        WAVE_POLYBLEP_SQUARE,
+        WAVE_LAST,
+    };
+
+    void Init(float sample_rate)
+    {
+        sr_        = sample_rate;
+        sr_recip_  = 1.0f / sample_rate;
+        freq_      = 100.0f;
+        amp_       = 0.5f;
+        pw_        = 0.5f;
+        phase_     = 0.0f;
+        phase_inc_ = freq_ * sr_recip_;
+        waveform_  = WAVE_SIN;
+        last_out_  = 0.0f;
+        eoc_       = true;
+        eor_       = true;
+    }
+
+    void SetFreq(const float f)
+    {
+        freq_      = f;
+        phase_inc_ = f * sr_recip_;
+    }
+    void SetAmp(const float a) { amp_ = a; }
+    void SetWaveform(const uint8_t wf)
+    {
+        waveform_ = wf < WAVE_LAST ? wf : WAVE_SIN;
+    }
+    void SetPw(const float pw) { pw_ = fclamp(pw, 0.0f, 1.0f); }
+    void Reset(float phase = 0.0f) { phase_ = phase; }
+    bool IsEOR() const { return eor_; }
+    bool IsEOC() const { return eoc_; }
+
+    float Process()
+    {
+        float out, t;
+        switch(waveform_)
+        {
+            case WAVE_SIN: out = sinf(phase_ * TWOPI_F); break;
+            case WAVE_TRI:
+                t   = -1.0f + (2.0f * phase_);
+                out = 2.0f * (fabsf(t) - 0.5f);
+                break;
+            case WAVE_SAW: out = -1.0f * ((phase_ * 2.0f) - 1.0f); break;
+            case WAVE_RAMP: out = (phase_ * 2.0f) - 1.0f; break;
+            case WAVE_SQUARE: out = phase_ < pw_ ? 1.0f : -1.0f; break;
+            case WAVE_POLYBLEP_TRI:
+                t   = phase_;
+                out = phase_ < 0.5f ? 1.0f : -1.0f;
+                out += Polyblep(phase_inc_, t);
+                out -= Polyblep(phase_inc_, Mod1(t + 0.5f));
+                // leaky integrator: y[n] = A x[n] + (1 - A) y[n-1]
+                out       = phase_inc_ * out + (1.0f - phase_inc_) * last_out_;
+                last_out_ = out;
+                out *= 4.f;
+                break;
+            case WAVE_POLYBLEP_SAW:
+                t   = phase_;
+                out = (2.0f * t) - 1.0f;
+                out -= Polyblep(phase_inc_, t);
+                out *= -1.0f;
+                break;
+            case WAVE_POLYBLEP_SQUARE:
+                t   = phase_;
+                out = phase_ < pw_ ? 1.0f : -1.0f;
+                out += Polyblep(phase_inc_, t);
+                out -= Polyblep(phase_inc_, Mod1(t + (1.0f - pw_)));
+                out *= 0.707f;
+                break;
+            default: out = 0.0f; break;
+        }
+        phase_ += phase_inc_;
+        if(phase_ > 1.0f)
+        {
+            phase_ -= 1.0f;
+            eoc_ = true;
+        }
+        else
+        {
+            eoc_ = false;
+        }
+        eor_ = (phase_ - phase_inc_ < 0.5f && phase_ >= 0.5f);
+        return out * amp_;
+    }
+
+  private:
+    static float Mod1(float x) { return x - floorf(x); }
+
+    static float Polyblep(float phase_inc, float t)
+    {
+        float dt = phase_inc;
+        if(t < dt)
+        {
+            t /= dt;
+            return t + t - t * t - 1.0f;
+        }
+        else if(t > 1.0f - dt)
+        {
+            t = (t - 1.0f) / dt;
+            return t * t + t + t + 1.0f;
+        }
+        return 0.0f;
+    }
+
+    uint8_t waveform_;
+    float   amp_, freq_, pw_;
+    float   sr_, sr_recip_, phase_, phase_inc_;
+    float   last_out_;
+    bool    eor_, eoc_;
+};
+
+} // namespace daisysp
+
+#endif
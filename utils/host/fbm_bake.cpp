@@ -0,0 +1,134 @@
+/**********************************************************
+   fbm_bake.cpp
+   Bakes the fBm table image for FractalZoom's QSPI mode
+   (common/fbm_table.h)
+
+       fbm_bake -o build/fbm_table.bin
+       fbm_bake -o t.bin -O 7 -L 2 -G 0.5 -r 512
+
+   options: -O octaves (5), -L lacunarity (2, integer),
+   -G gain (0.5), -r entries per unit (256, power of 2).
+   The defaults are patch FractalZoom's g_octaves,
+   g_lacunarity and g_gain; the app refuses an image
+   baked for other settings.
+
+   After writing, the image is loaded back through
+   FbmTable and compared with FractalNoise1D::FBm at a
+   million pseudo-random points; the exit code is non-zero
+   if the worst error is above 1e-3 (1/2 Hz of
+   FractalZoom's 487.5 Hz per unit pitch map).
+**********************************************************/
+
+#include "fbm_table.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace daisyex;
+
+static int Usage()
+{
+    fprintf(stderr,
+            "usage: fbm_bake -o out.bin [-O octaves] [-L lacunarity] "
+            "[-G gain] [-r per_unit]\n");
+    return 2;
+}
+
+int main(int argc, char **argv)
+{
+    const char *out        = nullptr;
+    int         octaves    = 5;
+    float       lacunarity = 2.f;
+    float       gain       = 0.5f;
+    uint32_t    per_unit   = 256;
+    for(int i = 1; i + 1 < argc; i += 2)
+    {
+        const char *a = argv[i], *v = argv[i + 1];
+        if(!strcmp(a, "-o"))
+            out = v;
+        else if(!strcmp(a, "-O"))
+            octaves = atoi(v);
+        else if(!strcmp(a, "-L"))
+            lacunarity = (float)atof(v);
+        else if(!strcmp(a, "-G"))
+            gain = (float)atof(v);
+        else if(!strcmp(a, "-r"))
+            per_unit = (uint32_t)atoi(v);
+        else
+            return Usage();
+    }
+    if(!out || (argc % 2) == 0)
+        return Usage();
+
+    // header + entries, one buffer as it will sit in QSPI
+    size_t             n = 256u * per_unit;
+    std::vector<float> image(sizeof(FbmTableHeader) / sizeof(float)
+                             + (n + 1) * 2);
+    FbmTableHeader &   h = *(FbmTableHeader *)image.data();
+    if(!BakeFbmTable(h,
+                     image.data() + sizeof(FbmTableHeader) / sizeof(float),
+                     per_unit,
+                     octaves,
+                     lacunarity,
+                     gain))
+    {
+        fprintf(stderr,
+                "can't bake: lacunarity must be an integer and per_unit a "
+                "power of 2\n");
+        return 2;
+    }
+
+    FILE *f = fopen(out, "wb");
+    if(!f)
+    {
+        fprintf(stderr, "can't write %s\n", out);
+        return 2;
+    }
+    size_t bytes = image.size() * sizeof(float);
+    fwrite(image.data(), 1, bytes, f);
+    fclose(f);
+
+    // check the image the way the app reads it
+    FbmTable table;
+    if(!table.Init(image.data(), octaves, lacunarity, gain))
+    {
+        fprintf(stderr, "%s: image doesn't load\n", out);
+        return 1;
+    }
+    FractalNoise1D noise;
+    noise.Init();
+    uint32_t seed   = 1u;
+    double   worst  = 0.0, sum = 0.0;
+    float    worstX = 0.f;
+    const int kPoints = 1000000;
+    for(int i = 0; i < kPoints; i++)
+    {
+        seed    = seed * 1664525u + 1013904223u;
+        float x = (seed >> 8) * (256.f / 16777216.f);
+        double err
+            = fabs((double)table.Eval(x)
+                   - (double)noise.FBm(x, octaves, lacunarity, gain));
+        sum += err;
+        if(err > worst)
+        {
+            worst  = err;
+            worstX = x;
+        }
+    }
+    printf("%s: %u bytes, %d octaves, lacunarity %g, gain %g, %u/unit, "
+           "crc %08x\n",
+           out,
+           (unsigned)bytes,
+           octaves,
+           (double)lacunarity,
+           (double)gain,
+           (unsigned)per_unit,
+           (unsigned)h.crc);
+    printf("  error vs FBm: mean %.2e  max %.2e (x = %.4f)\n",
+           sum / kPoints,
+           worst,
+           (double)worstX);
+    return worst > 1e-3 ? 1 : 0;
+}
@@ -0,0 +1,216 @@
+/**********************************************************
+   gate_check.cpp
+   Host check for the scheduled gate output (gate_out.h)
+
+   Runs a small app on the host stub layer whose audio
+   callback drives a GateOut with Set/Retrigger/Trigger at
+   known sample times, then checks every PA10 edge the
+   board captured against the sample it belongs to:
+   sample s of the stream plays (and its edge should land)
+   one block after the callback that filled it,
+       (s + blocksize) / samplerate
+   from the first audio sample. The script covers minimum
+   pulse width, retriggers, an edge on the last sample of
+   a block and a pulse long enough for the timer to hop.
+
+       gate_check [-r samplerate] [-b blocksize]
+
+   Exit code is non-zero if an edge is missing, extra or
+   more than kToleranceNs off.
+**********************************************************/
+
+#include "host_board.h"
+#include "daisy_patch.h"
+#include "gate_out.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace daisy;
+using namespace daisyex;
+using namespace daisyhost;
+
+static const double kToleranceNs = 20.0; // 4 ticks at 200 MHz
+
+namespace
+{
+enum Op
+{
+    SET_HIGH,
+    SET_LOW,
+    RETRIGGER,
+    TRIGGER,
+};
+
+struct Action
+{
+    uint32_t at; // stream sample
+    Op       op;
+    uint32_t width; // TRIGGER
+};
+
+struct Expect
+{
+    uint32_t at;
+    uint8_t  high;
+};
+
+std::vector<Action> g_actions;
+std::vector<Expect> g_expect;
+size_t              g_next = 0;
+uint64_t            g_sample = 0;
+
+DaisyPatch patch;
+GateOut    gate;
+
+// the script, for blocks of 'bs' at 'sr'; m = 1 ms, the
+// default minimum width and retrigger gap
+void BuildScript(uint32_t sr, uint32_t bs)
+{
+    uint32_t m    = sr / 1000;
+    uint32_t last = 17000 - 17000 % bs + bs - 1; // last of a block
+    g_actions     = {
+        {1000, SET_HIGH, 0},
+        {3000, SET_LOW, 0},
+        {5000, SET_HIGH, 0},
+        {5010, SET_LOW, 0}, // < 1 ms: held to the width
+        {8000, SET_HIGH, 0},
+        {9000, RETRIGGER, 0},
+        {9005, SET_HIGH, 0}, // already (about to be) high
+        {12000, SET_LOW, 0},
+        {15000, TRIGGER, 240},
+        {last, SET_HIGH, 0},
+        {last + 500, SET_LOW, 0},
+        {18000, RETRIGGER, 0}, // from low: just a rise
+        {18500, SET_LOW, 0},
+        {20000, TRIGGER, 3 * sr}, // 3 s: the timer hops
+    };
+    g_expect = {
+        {1000, 1},
+        {3000, 0},
+        {5000, 1},
+        {5000 + m, 0},
+        {8000, 1},
+        {9000, 0},
+        {9000 + m, 1},
+        {12000, 0},
+        {15000, 1},
+        {15240, 0},
+        {last, 1},
+        {last + 500, 0},
+        {18000, 1},
+        {18500, 0},
+        {20000, 1},
+        {20000 + 3 * sr, 0},
+    };
+}
+
+void AudioCallback(AudioHandle::InputBuffer  in,
+                   AudioHandle::OutputBuffer out,
+                   size_t                    size)
+{
+    gate.BeginBlock(size);
+    for(; g_next < g_actions.size() && g_actions[g_next].at < g_sample + size;
+        g_next++)
+    {
+        const Action &a = g_actions[g_next];
+        size_t        i = (size_t)(a.at - g_sample);
+        switch(a.op)
+        {
+            case SET_HIGH: gate.Set(i, true); break;
+            case SET_LOW: gate.Set(i, false); break;
+            case RETRIGGER: gate.Retrigger(i); break;
+            case TRIGGER: gate.Trigger(i, a.width); break;
+        }
+    }
+    for(size_t c = 0; c < 4; c++)
+        memset(out[c], 0, size * sizeof(float));
+    g_sample += size;
+}
+
+int GateApp()
+{
+    patch.Init();
+    gate.Init(GateOut::Config(), patch.AudioSampleRate());
+    patch.StartAudio(AudioCallback);
+    while(1)
+        System::Delay(1);
+}
+
+int Usage()
+{
+    fprintf(stderr, "usage: gate_check [-r samplerate] [-b blocksize]\n");
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Config cfg;
+    cfg.log = false;
+    for(int i = 1; i < argc; i++)
+    {
+        const char *val = i + 1 < argc ? argv[i + 1] : nullptr;
+        if(!strcmp(argv[i], "-r") && val)
+            cfg.samplerate = (float)atof(argv[++i]);
+        else if(!strcmp(argv[i], "-b") && val)
+            cfg.blocksize = (size_t)atoi(argv[++i]);
+        else
+            return Usage();
+    }
+    uint32_t sr = (uint32_t)cfg.samplerate;
+    uint32_t bs = (uint32_t)cfg.blocksize;
+    BuildScript(sr, bs);
+    cfg.seconds = (20000.0 + 3.5 * sr) / sr;
+    Configure(cfg);
+    Run(GateApp);
+
+    dsy_gpio_pin pin = GateOut::Config().pin;
+    std::vector<GpioEdge> edges;
+    for(const GpioEdge &g : GpioEdges())
+        if(g.pin.port == pin.port && g.pin.pin == pin.pin)
+            edges.push_back(g);
+
+    int    failed = 0;
+    double worst  = 0.0;
+    for(size_t k = 0; k < g_expect.size() || k < edges.size(); k++)
+    {
+        if(k >= edges.size() || k >= g_expect.size())
+        {
+            printf("edge %zu: %s\n",
+                   k,
+                   k >= edges.size() ? "missing" : "unexpected");
+            failed++;
+            continue;
+        }
+        const Expect &x    = g_expect[k];
+        double        want = (double)(x.at + bs) * 1e9 / sr;
+        double        err  = (double)edges[k].time_ns - want;
+        if(fabs(err) > worst)
+            worst = fabs(err);
+        if(edges[k].state != x.high || fabs(err) > kToleranceNs)
+        {
+            printf("edge %zu: %s at %.0f ns, want %s at sample %u (%.0f ns)\n",
+                   k,
+                   edges[k].state ? "rise" : "fall",
+                   (double)edges[k].time_ns,
+                   x.high ? "rise" : "fall",
+                   x.at,
+                   want);
+            failed++;
+        }
+    }
+    printf("gate_check %u Hz, block %u: %zu edges, worst %.1f ns off, "
+           "%u late, %llu timer irqs  %s\n",
+           sr,
+           bs,
+           edges.size(),
+           worst,
+           gate.Late(),
+           (unsigned long long)GetStats().timer_irqs,
+           failed ? "FAIL" : "ok");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,998 @@
+/**********************************************************
+   host_board.cpp
+   Simulated clock, script and captures behind the host
+   stub headers (daisy.h, daisy_patch.h, daisy_pod.h)
+
+   Everything runs on one thread. "Interrupts" (scripted
+   input changes, TimerHandle callbacks, audio blocks) are
+   events on a nanosecond clock; they fire in time order
+   whenever the app's main context lets time pass: WFI,
+   System::Delay(), or a busy-wait on GetUs()/GetNow().
+   At equal times inputs go first, then timers, then the
+   audio block.
+**********************************************************/
+
+#include "host_board.h"
+#include "daisy_patch.h"
+#include "daisy_pod.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+FontDef Font_6x8   = {6, 8, nullptr};
+FontDef Font_7x10  = {7, 10, nullptr};
+FontDef Font_11x18 = {11, 18, nullptr};
+FontDef Font_16x26 = {16, 26, nullptr};
+
+namespace daisyhost
+{
+namespace
+{
+    const uint64_t kNever       = ~0ull;
+    const uint64_t kSysTickNs   = 1000000; // WFI wakes at least every 1 ms
+    const uint32_t kSpinLimit   = 1000;    // clock reads before time moves
+    const uint64_t kBootLimitNs = 60000000000ull; // no audio by then => stop
+
+    struct Finished
+    {
+    };
+
+    struct ScriptEvent
+    {
+        uint64_t at_ns; // from the first audio sample
+        Input    input;
+        int      index;
+        float    value;
+    };
+
+    struct MidiIn
+    {
+        uint64_t         at_ns;
+        daisy::MidiEvent ev;
+    };
+
+    struct TimerSlot
+    {
+        daisy::TimerHandle *tim;
+        uint64_t            next_ns, period_ns;
+    };
+
+    struct Engine
+    {
+        Config   cfg;
+        uint64_t now_ns;
+        bool     in_isr;
+        uint32_t spin;
+        bool     finished;
+
+        // audio
+        daisy::AudioHandle::AudioCallback audio_cb;
+        size_t                            channels;
+        bool                              audio_on;
+        uint64_t                          audio_start_ns;
+        uint64_t                          stop_blocks;
+        std::vector<float>                in_buf[kMaxChannels];
+        std::vector<float>                out_buf[kMaxChannels];
+        float *                           in_ptrs[kMaxChannels];
+        float *                           out_ptrs[kMaxChannels];
+        AudioHooks                        hooks;
+
+        std::vector<TimerSlot> timers;
+
+        // script, sorted on Run()
+        std::vector<ScriptEvent> script;
+        size_t                   script_next;
+        std::vector<MidiIn>      midi;
+        size_t                   midi_next;
+
+        // input state the controls read
+        float knob[kNumKnobs];
+        bool  gate[kNumGates];
+        bool  button[kNumButtons];
+        int   enc_turns;
+        bool  enc_press;
+
+        // captures
+        std::vector<DacWrite> dac;
+        uint16_t              dac_value[2];
+        bool                  dac_written[2];
+        std::vector<GpioEdge> gpio;
+        uint8_t               level[DSY_GPIO_LAST][16];
+        daisyex::HostOledTransport<128, 64> panel;
+        Stats                               stats;
+
+        Engine()
+        {
+            now_ns      = 0;
+            in_isr      = false;
+            spin        = 0;
+            finished    = false;
+            audio_cb    = nullptr;
+            channels    = 0;
+            audio_on    = false;
+            stop_blocks = 0;
+            hooks       = AudioHooks{nullptr, nullptr, nullptr};
+            script_next = midi_next = 0;
+            memset(knob, 0, sizeof(knob));
+            memset(gate, 0, sizeof(gate));
+            memset(button, 0, sizeof(button));
+            enc_turns = 0;
+            enc_press = false;
+            memset(dac_value, 0, sizeof(dac_value));
+            memset(dac_written, 0, sizeof(dac_written));
+            memset(level, 0, sizeof(level));
+            memset(&stats, 0, sizeof(stats));
+            panel.Init(daisyex::HostOledTransport<128, 64>::Config());
+            Resize();
+        }
+
+        void Resize()
+        {
+            for(size_t c = 0; c < kMaxChannels; c++)
+            {
+                in_buf[c].assign(cfg.blocksize, 0.f);
+                out_buf[c].assign(cfg.blocksize, 0.f);
+                in_ptrs[c]  = in_buf[c].data();
+                out_ptrs[c] = out_buf[c].data();
+            }
+        }
+
+        // block k starts at sample k * blocksize
+        uint64_t BlockNs(uint64_t k) const
+        {
+            uint64_t sr = (uint64_t)llroundf(cfg.samplerate);
+            return audio_start_ns + k * cfg.blocksize * 1000000000ull / sr;
+        }
+    };
+
+    // never destroyed: app statics (TimerHandle) may still
+    // call in from their destructors at exit
+    Engine &E()
+    {
+        static Engine *e = new Engine;
+        return *e;
+    }
+
+    // capture time; until audio starts this is the time
+    // since boot, rebased when it does
+    int64_t RelNow()
+    {
+        Engine &e = E();
+        if(!e.audio_on)
+            return (int64_t)e.now_ns;
+        return (int64_t)(e.now_ns - e.audio_start_ns);
+    }
+
+    // ------------------------------------------------
+    // Inputs
+    // ------------------------------------------------
+    void Apply(Input input, int index, float value)
+    {
+        Engine &e = E();
+        switch(input)
+        {
+            case Input::KNOB:
+                if(index >= 0 && index < (int)kNumKnobs)
+                    e.knob[index] = value;
+                break;
+            case Input::GATE:
+                if(index >= 0 && index < (int)kNumGates)
+                    e.gate[index] = value > 0.5f;
+                break;
+            case Input::BUTTON:
+                if(index >= 0 && index < (int)kNumButtons)
+                    e.button[index] = value > 0.5f;
+                break;
+            case Input::ENCODER_TURN: e.enc_turns += (int)value; break;
+            case Input::ENCODER_PRESS: e.enc_press = value > 0.5f; break;
+        }
+    }
+
+    uint64_t ToNs(double t)
+    {
+        return t > 0.0 ? (uint64_t)llround(t * 1e9) : 0;
+    }
+
+    // ------------------------------------------------
+    // Events
+    // ------------------------------------------------
+    enum EventKind
+    {
+        EV_NONE,
+        EV_INPUT,
+        EV_TIMER,
+        EV_AUDIO,
+    };
+
+    EventKind NextEvent(uint64_t &t, size_t &timer)
+    {
+        Engine &  e    = E();
+        EventKind kind = EV_NONE;
+        t              = kNever;
+        if(e.audio_on && e.script_next < e.script.size())
+        {
+            t    = e.audio_start_ns + e.script[e.script_next].at_ns;
+            kind = EV_INPUT;
+        }
+        for(size_t i = 0; i < e.timers.size(); i++)
+            if(e.timers[i].next_ns < t)
+            {
+                t     = e.timers[i].next_ns;
+                timer = i;
+                kind  = EV_TIMER;
+            }
+        if(e.audio_on)
+        {
+            uint64_t ta = e.BlockNs(e.stats.blocks);
+            if(ta < t)
+            {
+                t    = ta;
+                kind = EV_AUDIO;
+            }
+        }
+        return kind;
+    }
+
+    void FireAudio()
+    {
+        Engine & e     = E();
+        uint64_t block = e.stats.blocks;
+        size_t   size  = e.cfg.blocksize;
+        if(e.hooks.pre)
+            e.hooks.pre(block, e.hooks.ctx);
+        e.audio_cb(e.in_ptrs, e.out_ptrs, size);
+        if(e.hooks.post)
+            e.hooks.post(block, e.out_ptrs, e.channels, size, e.hooks.ctx);
+        e.stats.blocks++;
+        if(e.stop_blocks && e.stats.blocks >= e.stop_blocks)
+            e.finished = true;
+    }
+
+    void Fire(EventKind kind, size_t timer)
+    {
+        Engine &e = E();
+        e.in_isr  = true;
+        switch(kind)
+        {
+            case EV_INPUT:
+            {
+                const ScriptEvent &s = e.script[e.script_next++];
+                Apply(s.input, s.index, s.value);
+            }
+            break;
+            case EV_TIMER:
+            {
+                TimerSlot &slot = e.timers[timer];
+                slot.next_ns += slot.period_ns;
+                e.stats.timer_irqs++;
+                slot.tim->Elapsed();
+            }
+            break;
+            case EV_AUDIO: FireAudio(); break;
+            default: break;
+        }
+        e.in_isr = false;
+    }
+
+    // run every interrupt due up to 'until', then move the
+    // clock there; only from the main context
+    void Advance(uint64_t until)
+    {
+        Engine &e = E();
+        if(e.in_isr)
+            return;
+        while(1)
+        {
+            uint64_t  t;
+            size_t    timer = 0;
+            EventKind kind  = NextEvent(t, timer);
+            if(kind == EV_NONE || t > until)
+                break;
+            if(t > e.now_ns)
+                e.now_ns = t;
+            Fire(kind, timer);
+            if(e.finished)
+                throw Finished();
+        }
+        if(until > e.now_ns)
+            e.now_ns = until;
+        e.spin = 0;
+        if(!e.audio_on && e.now_ns > kBootLimitNs)
+            throw Finished();
+    }
+
+    // a main loop polling the clock must see time move
+    void Spin()
+    {
+        Engine &e = E();
+        if(!e.in_isr && ++e.spin >= kSpinLimit)
+            Advance(e.now_ns + 1000);
+    }
+
+    TimerSlot *FindTimer(daisy::TimerHandle *tim)
+    {
+        Engine &e = E();
+        for(size_t i = 0; i < e.timers.size(); i++)
+            if(e.timers[i].tim == tim)
+                return &e.timers[i];
+        return nullptr;
+    }
+
+    void RemoveTimer(daisy::TimerHandle *tim)
+    {
+        Engine &e = E();
+        for(size_t i = 0; i < e.timers.size(); i++)
+            if(e.timers[i].tim == tim)
+            {
+                e.timers.erase(e.timers.begin() + i);
+                return;
+            }
+    }
+
+    void PanelDone(void *ctx) {}
+
+    void SpiToPanel(const uint8_t *buf, size_t size)
+    {
+        Engine &      e  = E();
+        dsy_gpio_pin &dc = e.cfg.panel_dc;
+        if(e.level[dc.port][dc.pin & 15])
+        {
+            e.panel.SendData(buf, size, PanelDone, nullptr);
+            return;
+        }
+        for(size_t i = 0; i < size; i++)
+            e.panel.SendCommand(buf[i]);
+    }
+
+    void StartBoardAudio(daisy::AudioHandle::AudioCallback cb,
+                         size_t                            channels)
+    {
+        Engine &e  = E();
+        e.audio_cb = cb;
+        e.channels = channels;
+        if(e.audio_on)
+            return;
+        e.Resize();
+        e.audio_on       = true;
+        e.audio_start_ns = e.now_ns;
+        for(DacWrite &d : e.dac)
+            d.time_ns -= (int64_t)e.audio_start_ns;
+        for(GpioEdge &g : e.gpio)
+            g.time_ns -= (int64_t)e.audio_start_ns;
+        e.stop_blocks
+            = (uint64_t)ceil(e.cfg.seconds * e.cfg.samplerate / e.cfg.blocksize);
+    }
+
+    void SetBoardSampleRate(daisy::SaiHandle::Config::SampleRate sr)
+    {
+        typedef daisy::SaiHandle::Config::SampleRate Sr;
+        Engine &                                     e = E();
+        switch(sr)
+        {
+            case Sr::SAI_8KHZ: e.cfg.samplerate = 8000.f; break;
+            case Sr::SAI_16KHZ: e.cfg.samplerate = 16000.f; break;
+            case Sr::SAI_32KHZ: e.cfg.samplerate = 32000.f; break;
+            case Sr::SAI_48KHZ: e.cfg.samplerate = 48000.f; break;
+            case Sr::SAI_96KHZ: e.cfg.samplerate = 96000.f; break;
+        }
+    }
+
+    void SetBoardBlockSize(size_t size)
+    {
+        Engine &e = E();
+        if(e.audio_on || size == 0)
+            return; // libDaisy also needs audio stopped
+        e.cfg.blocksize = size;
+        e.Resize();
+    }
+
+} // namespace
+
+// ----------------------------------------------------
+// host_board.h
+// ----------------------------------------------------
+void Configure(const Config &cfg)
+{
+    E().cfg = cfg;
+    E().Resize();
+}
+
+void SetInput(Input input, int index, float value)
+{
+    Apply(input, index, value);
+}
+
+void Schedule(double t, Input input, int index, float value)
+{
+    E().script.push_back(ScriptEvent{ToNs(t), input, index, value});
+}
+
+void ScheduleMidi(double t, const daisy::MidiEvent &ev)
+{
+    E().midi.push_back(MidiIn{ToNs(t), ev});
+}
+
+void ScheduleNoteOn(double t, int channel, int note, int velocity)
+{
+    daisy::MidiEvent ev = {};
+    ev.type             = daisy::NoteOn;
+    ev.channel          = channel;
+    ev.data[0]          = (uint8_t)note;
+    ev.data[1]          = (uint8_t)velocity;
+    ScheduleMidi(t, ev);
+}
+
+void ScheduleNoteOff(double t, int channel, int note)
+{
+    daisy::MidiEvent ev = {};
+    ev.type             = daisy::NoteOff;
+    ev.channel          = channel;
+    ev.data[0]          = (uint8_t)note;
+    ScheduleMidi(t, ev);
+}
+
+void ScheduleControlChange(double t, int channel, int cc, int value)
+{
+    daisy::MidiEvent ev = {};
+    ev.type             = daisy::ControlChange;
+    ev.channel          = channel;
+    ev.data[0]          = (uint8_t)cc;
+    ev.data[1]          = (uint8_t)value;
+    ScheduleMidi(t, ev);
+}
+
+void ScheduleRealTime(double t, daisy::SystemRealTimeType type)
+{
+    daisy::MidiEvent ev = {};
+    ev.type             = daisy::SystemRealTime;
+    ev.srt_type         = type;
+    ScheduleMidi(t, ev);
+}
+
+void SetAudioHooks(const AudioHooks &hooks)
+{
+    E().hooks = hooks;
+}
+
+float *AudioInput(size_t channel)
+{
+    return E().in_ptrs[channel < kMaxChannels ? channel : 0];
+}
+
+void Run(AppMain app_main)
+{
+    Engine &e = E();
+    std::stable_sort(e.script.begin(),
+                     e.script.end(),
+                     [](const ScriptEvent &a, const ScriptEvent &b) {
+                         return a.at_ns < b.at_ns;
+                     });
+    std::stable_sort(
+        e.midi.begin(), e.midi.end(), [](const MidiIn &a, const MidiIn &b) {
+            return a.at_ns < b.at_ns;
+        });
+
+    // initial positions are there from power-up
+    while(e.script_next < e.script.size() && e.script[e.script_next].at_ns == 0)
+    {
+        const ScriptEvent &s = e.script[e.script_next++];
+        Apply(s.input, s.index, s.value);
+    }
+
+    try
+    {
+        app_main();
+        // main returned: let the interrupts run out the time
+        while(e.audio_on)
+            Advance(e.now_ns + kSysTickNs);
+    }
+    catch(const Finished &)
+    {
+    }
+    e.stats.sim_seconds = (double)e.now_ns * 1e-9;
+}
+
+const std::vector<DacWrite> &DacWrites()
+{
+    return E().dac;
+}
+
+const std::vector<GpioEdge> &GpioEdges()
+{
+    return E().gpio;
+}
+
+size_t CountEdges(dsy_gpio_pin pin)
+{
+    size_t n = 0;
+    for(const GpioEdge &g : E().gpio)
+        if(g.pin.port == pin.port && g.pin.pin == pin.pin)
+            n++;
+    return n;
+}
+
+const Stats &GetStats()
+{
+    E().stats.sim_seconds = (double)E().now_ns * 1e-9;
+    return E().stats;
+}
+
+float SampleRate()
+{
+    return E().cfg.samplerate;
+}
+
+size_t BlockSize()
+{
+    return E().cfg.blocksize;
+}
+
+size_t AudioChannels()
+{
+    return E().channels;
+}
+
+const daisyex::HostOledTransport<128, 64> &Panel()
+{
+    return E().panel;
+}
+
+// ----------------------------------------------------
+// daisy.h hooks
+// ----------------------------------------------------
+void WaitForInterrupt()
+{
+    Engine &e = E();
+    if(e.in_isr)
+        return;
+    e.stats.wfi++;
+    uint64_t  t;
+    size_t    timer = 0;
+    uint64_t  tick  = (e.now_ns / kSysTickNs + 1) * kSysTickNs;
+    EventKind kind  = NextEvent(t, timer);
+    Advance(kind != EV_NONE && t < tick ? t : tick);
+}
+
+void PanelWriteFrame(const uint8_t *frame, size_t size)
+{
+    Engine &e = E();
+    e.panel.SendCommand(0x21);
+    e.panel.SendCommand(0);
+    e.panel.SendCommand(127);
+    e.panel.SendCommand(0x22);
+    e.panel.SendCommand(0);
+    e.panel.SendCommand(7);
+    e.panel.SendData(frame, size, PanelDone, nullptr);
+}
+
+} // namespace daisyhost
+
+using daisyhost::E;
+
+// ----------------------------------------------------
+// GPIO
+// ----------------------------------------------------
+void dsy_gpio_init(const dsy_gpio *p)
+{
+    E().level[p->pin.port][p->pin.pin & 15] = 0;
+}
+
+void dsy_gpio_deinit(const dsy_gpio *p) {}
+
+uint8_t dsy_gpio_read(const dsy_gpio *p)
+{
+    return E().level[p->pin.port][p->pin.pin & 15];
+}
+
+void dsy_gpio_write(const dsy_gpio *p, uint8_t state)
+{
+    uint8_t &level = E().level[p->pin.port][p->pin.pin & 15];
+    state          = state ? 1 : 0;
+    if(level == state)
+        return;
+    level = state;
+    E().gpio.push_back(daisyhost::GpioEdge{daisyhost::RelNow(), p->pin, state});
+}
+
+void dsy_gpio_toggle(const dsy_gpio *p)
+{
+    dsy_gpio_write(p, !dsy_gpio_read(p));
+}
+
+namespace daisy
+{
+// ----------------------------------------------------
+// System
+// ----------------------------------------------------
+void System::Delay(uint32_t ms)
+{
+    daisyhost::Advance(E().now_ns + (uint64_t)ms * 1000000);
+}
+
+void System::DelayUs(uint32_t us)
+{
+    daisyhost::Advance(E().now_ns + (uint64_t)us * 1000);
+}
+
+uint32_t System::GetNow()
+{
+    daisyhost::Spin();
+    return (uint32_t)(E().now_ns / 1000000);
+}
+
+uint32_t System::GetUs()
+{
+    daisyhost::Spin();
+    return (uint32_t)(E().now_ns / 1000);
+}
+
+uint32_t System::GetTick()
+{
+    daisyhost::Spin();
+    return (uint32_t)(E().now_ns / 5); // 200 MHz
+}
+
+// ----------------------------------------------------
+// Parameter (libDaisy's curves)
+// ----------------------------------------------------
+void Parameter::Init(AnalogControl &input, float min, float max, Curve curve)
+{
+    in_    = &input;
+    min_   = min;
+    max_   = max;
+    curve_ = curve;
+    lmin_  = logf(min < 0.0000001f ? 0.0000001f : min);
+    lmax_  = logf(max);
+}
+
+float Parameter::Process()
+{
+    float in = in_->Process();
+    switch(curve_)
+    {
+        case LINEAR: val_ = (in * (max_ - min_)) + min_; break;
+        case EXPONENTIAL: val_ = ((in * in) * (max_ - min_)) + min_; break;
+        case LOGARITHMIC: val_ = expf((in * (lmax_ - lmin_)) + lmin_); break;
+        case CUBE: val_ = ((in * (in * in)) * (max_ - min_)) + min_; break;
+        default: break;
+    }
+    return val_;
+}
+
+// ----------------------------------------------------
+// DAC, Logger
+// ----------------------------------------------------
+DacHandle::Result DacHandle::WriteValue(Channel chn, uint16_t val)
+{
+    daisyhost::Engine &e = E();
+    e.stats.dac_writes++;
+    for(uint8_t c = 0; c < 2; c++)
+    {
+        bool hit = chn == Channel::BOTH || (uint8_t)chn == c;
+        if(!hit || (e.dac_written[c] && e.dac_value[c] == val))
+            continue;
+        e.dac_written[c] = true;
+        e.dac_value[c]   = val;
+        e.dac.push_back(daisyhost::DacWrite{daisyhost::RelNow(), c, val});
+    }
+    return Result::OK;
+}
+
+static bool g_logStarted = false;
+
+void DaisySeed::StartLog(bool wait_for_pc)
+{
+    g_logStarted = true;
+}
+
+void DaisySeed::PrintLine(const char *format, ...)
+{
+    if(!g_logStarted || !E().cfg.log)
+        return;
+    va_list va;
+    va_start(va, format);
+    vprintf(format, va);
+    va_end(va);
+    putchar('\n');
+}
+
+void DaisySeed::Print(const char *format, ...)
+{
+    if(!g_logStarted || !E().cfg.log)
+        return;
+    va_list va;
+    va_start(va, format);
+    vprintf(format, va);
+    va_end(va);
+}
+
+// ----------------------------------------------------
+// MIDI
+// ----------------------------------------------------
+void MidiUartHandler::Listen()
+{
+    daisyhost::Engine &e = E();
+    if(!e.audio_on)
+        return;
+    uint64_t now = e.now_ns - e.audio_start_ns;
+    while(e.midi_next < e.midi.size() && e.midi[e.midi_next].at_ns <= now)
+    {
+        size_t next = (head_ + 1) % kQueueSize;
+        if(next == tail_)
+            break; // full, like the UART FIFO
+        queue_[head_] = e.midi[e.midi_next++].ev;
+        head_         = next;
+        e.stats.midi_in++;
+    }
+}
+
+// ----------------------------------------------------
+// Timers
+// ----------------------------------------------------
+TimerHandle::~TimerHandle()
+{
+    daisyhost::RemoveTimer(this);
+}
+
+TimerHandle::Result TimerHandle::SetPeriod(uint32_t ticks)
+{
+    period_ = ticks;
+    if(daisyhost::TimerSlot *slot = daisyhost::FindTimer(this))
+        slot->period_ns = ((uint64_t)ticks + 1) * 5;
+    return Result::OK;
+}
+
+TimerHandle::Result TimerHandle::Start()
+{
+    daisyhost::Engine &e = E();
+    if(daisyhost::FindTimer(this))
+        return Result::OK;
+    uint64_t period_ns = ((uint64_t)period_ + 1) * 5; // 200 MHz
+    e.timers.push_back(
+        daisyhost::TimerSlot{this, e.now_ns + period_ns, period_ns});
+    return Result::OK;
+}
+
+TimerHandle::Result TimerHandle::Stop()
+{
+    daisyhost::RemoveTimer(this);
+    return Result::OK;
+}
+
+uint32_t TimerHandle::GetTick()
+{
+    return (uint32_t)(E().now_ns / 5);
+}
+
+// ----------------------------------------------------
+// SPI
+// ----------------------------------------------------
+SpiHandle::Result
+SpiHandle::BlockingTransmit(uint8_t *buff, size_t size, uint32_t timeout)
+{
+    if(config_.periph == Config::Peripheral::SPI_1)
+        daisyhost::SpiToPanel(buff, size);
+    return Result::OK;
+}
+
+SpiHandle::Result SpiHandle::DmaTransmit(uint8_t *                buff,
+                                         size_t                   size,
+                                         StartCallbackFunctionPtr start_cb,
+                                         EndCallbackFunctionPtr   end_cb,
+                                         void *                   ctx)
+{
+    if(start_cb)
+        start_cb(ctx);
+    if(config_.periph == Config::Peripheral::SPI_1)
+        daisyhost::SpiToPanel(buff, size);
+    if(end_cb)
+        end_cb(ctx, Result::OK);
+    return Result::OK;
+}
+
+// ----------------------------------------------------
+// Drawing (libDaisy's algorithms)
+// ----------------------------------------------------
+void OneBitGraphicsDisplay::DrawLine(uint_fast8_t x1,
+                                     uint_fast8_t y1,
+                                     uint_fast8_t x2,
+                                     uint_fast8_t y2,
+                                     bool         on)
+{
+    int dx = abs((int)x2 - (int)x1), sx = x1 < x2 ? 1 : -1;
+    int dy = -abs((int)y2 - (int)y1), sy = y1 < y2 ? 1 : -1;
+    int err = dx + dy, x = x1, y = y1;
+    while(1)
+    {
+        DrawPixel(x, y, on);
+        if(x == (int)x2 && y == (int)y2)
+            break;
+        int e2 = 2 * err;
+        if(e2 >= dy)
+        {
+            err += dy;
+            x += sx;
+        }
+        if(e2 <= dx)
+        {
+            err += dx;
+            y += sy;
+        }
+    }
+}
+
+void OneBitGraphicsDisplay::DrawRect(uint_fast8_t x1,
+                                     uint_fast8_t y1,
+                                     uint_fast8_t x2,
+                                     uint_fast8_t y2,
+                                     bool         on,
+                                     bool         fill)
+{
+    if(fill)
+    {
+        for(uint_fast8_t x = x1; x <= x2; x++)
+            for(uint_fast8_t y = y1; y <= y2; y++)
+                DrawPixel(x, y, on);
+        return;
+    }
+    DrawLine(x1, y1, x2, y1, on);
+    DrawLine(x2, y1, x2, y2, on);
+    DrawLine(x2, y2, x1, y2, on);
+    DrawLine(x1, y2, x1, y1, on);
+}
+
+char OneBitGraphicsDisplay::WriteChar(char ch, FontDef font, bool on)
+{
+    if(Width() <= (cursor_x_ + font.FontWidth)
+       || Height() <= (cursor_y_ + font.FontHeight))
+        return 0;
+    // no glyph data here: a pattern hashed from the
+    // character, so text changes still change pixels
+    uint32_t h = ch == ' ' ? 0 : (uint8_t)ch * 2654435761u;
+    for(uint32_t i = 0; i < font.FontHeight; i++)
+        for(uint32_t j = 0; j < font.FontWidth; j++)
+        {
+            bool bit = (h >> ((i * font.FontWidth + j) % 31)) & 1;
+            DrawPixel(cursor_x_ + j, cursor_y_ + i, bit ? on : !on);
+        }
+    cursor_x_ += font.FontWidth;
+    return ch;
+}
+
+char OneBitGraphicsDisplay::WriteString(const char *str, FontDef font, bool on)
+{
+    while(*str)
+    {
+        if(WriteChar(*str, font, on) != *str)
+            return *str;
+        str++;
+    }
+    return *str;
+}
+
+// ----------------------------------------------------
+// Boards
+// ----------------------------------------------------
+void DaisyPatch::Init(bool boost)
+{
+    daisyhost::Engine &e = E();
+    for(size_t i = 0; i < CTRL_LAST; i++)
+        controls[i].Init(&e.knob[i], AudioCallbackRate());
+    for(size_t i = 0; i < GATE_IN_LAST; i++)
+        gate_input[i].Init(&e.gate[i]);
+    encoder.Init(&e.enc_turns, &e.enc_press);
+}
+
+void DaisyPatch::StartAudio(AudioHandle::AudioCallback cb)
+{
+    daisyhost::StartBoardAudio(cb, 4);
+}
+
+void DaisyPatch::ChangeAudioCallback(AudioHandle::AudioCallback cb)
+{
+    E().audio_cb = cb;
+}
+
+void DaisyPatch::StopAudio()
+{
+    E().audio_on = false;
+}
+
+void DaisyPatch::SetAudioSampleRate(SaiHandle::Config::SampleRate samplerate)
+{
+    daisyhost::SetBoardSampleRate(samplerate);
+    for(size_t i = 0; i < CTRL_LAST; i++)
+        controls[i].Init(&E().knob[i], AudioCallbackRate());
+}
+
+void DaisyPatch::SetAudioBlockSize(size_t size)
+{
+    daisyhost::SetBoardBlockSize(size);
+    for(size_t i = 0; i < CTRL_LAST; i++)
+        controls[i].Init(&E().knob[i], AudioCallbackRate());
+}
+
+size_t DaisyPatch::AudioBlockSize()
+{
+    return E().cfg.blocksize;
+}
+
+float DaisyPatch::AudioSampleRate()
+{
+    return E().cfg.samplerate;
+}
+
+float DaisyPatch::AudioCallbackRate()
+{
+    return E().cfg.samplerate / (float)E().cfg.blocksize;
+}
+
+void DaisyPatch::ProcessAnalogControls()
+{
+    for(size_t i = 0; i < CTRL_LAST; i++)
+        controls[i].Process();
+}
+
+void DaisyPatch::ProcessDigitalControls()
+{
+    encoder.Debounce();
+}
+
+void DaisyPod::Init(bool boost)
+{
+    daisyhost::Engine &e = E();
+    knob1.Init(&e.knob[0], AudioCallbackRate());
+    knob2.Init(&e.knob[1], AudioCallbackRate());
+    button1.Init(&e.button[0]);
+    button2.Init(&e.button[1]);
+    encoder.Init(&e.enc_turns, &e.enc_press);
+}
+
+void DaisyPod::StartAudio(AudioHandle::AudioCallback cb)
+{
+    daisyhost::StartBoardAudio(cb, 2);
+}
+
+void DaisyPod::ChangeAudioCallback(AudioHandle::AudioCallback cb)
+{
+    E().audio_cb = cb;
+}
+
+void DaisyPod::StopAudio()
+{
+    E().audio_on = false;
+}
+
+void DaisyPod::SetAudioSampleRate(SaiHandle::Config::SampleRate samplerate)
+{
+    daisyhost::SetBoardSampleRate(samplerate);
+    knob1.Init(&E().knob[0], AudioCallbackRate());
+    knob2.Init(&E().knob[1], AudioCallbackRate());
+}
+
+void DaisyPod::SetAudioBlockSize(size_t size)
+{
+    daisyhost::SetBoardBlockSize(size);
+    knob1.Init(&E().knob[0], AudioCallbackRate());
+    knob2.Init(&E().knob[1], AudioCallbackRate());
+}
+
+size_t DaisyPod::AudioBlockSize()
+{
+    return E().cfg.blocksize;
+}
+
+float DaisyPod::AudioSampleRate()
+{
+    return E().cfg.samplerate;
+}
+
+float DaisyPod::AudioCallbackRate()
+{
+    return E().cfg.samplerate / (float)E().cfg.blocksize;
+}
+
+} // namespace daisy
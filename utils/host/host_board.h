@@ -0,0 +1,155 @@
+/**********************************************************
+   host_board.h
+   Script and capture side of the host stub layer
+
+   A driver (host_main.cpp, render.cpp) sets up the
+   board, schedules inputs, then hands the app's main() to
+   Run(). The app builds with -Dmain=AppMain_<app>, so its
+   main() runs as is:
+
+       daisyhost::Config cfg;
+       cfg.seconds = 10.0;
+       daisyhost::Configure(cfg);
+       daisyhost::Schedule(0.0, daisyhost::Input::KNOB, 3, 0.8f);
+       daisyhost::ScheduleNoteOn(0.5, 0, 60, 100);
+       daisyhost::Run(AppMain_FractalZoom);
+
+   Times are seconds of audio: 0 is the first sample the
+   app's callback renders. Inputs at or before 0 are in
+   place before the app's main() starts. Run() returns
+   once 'seconds' of audio have been rendered (or the app
+   returns from main without starting audio).
+
+   Captured times (DAC writes, GPIO edges) are in
+   nanoseconds from the first audio sample, negative
+   before audio starts.
+**********************************************************/
+#pragma once
+#ifndef DAISYHOST_HOST_BOARD_H
+#define DAISYHOST_HOST_BOARD_H
+
+#include "daisy.h"
+#include "oled_host.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace daisyhost
+{
+static const size_t kMaxChannels = 4;
+static const size_t kNumKnobs    = 4;
+static const size_t kNumGates    = 2;
+static const size_t kNumButtons  = 2;
+
+struct Config
+{
+    float        samplerate; // board default, the app may change it
+    size_t       blocksize;
+    double       seconds;    // audio to render
+    bool         log;        // Logger lines => stdout
+    dsy_gpio_pin panel_dc;   // D/C pin of the SPI1 OLED
+
+    Config()
+    {
+        samplerate = 48000.f;
+        blocksize  = 48;
+        seconds    = 10.0;
+        log        = true;
+        panel_dc   = {DSY_GPIOB, 4};
+    }
+};
+
+void Configure(const Config &cfg);
+
+// ----------------------------------------------------
+// Inputs
+// ----------------------------------------------------
+enum class Input
+{
+    KNOB,          // index 0..3, value 0..1 (Pod: knob1/knob2)
+    GATE,          // index 0..1, value 0/1
+    BUTTON,        // index 0..1 (Pod buttons), value 0/1
+    ENCODER_TURN,  // value = detents, + or -
+    ENCODER_PRESS, // value 0/1
+};
+
+// set now / at t seconds of audio
+void SetInput(Input input, int index, float value);
+void Schedule(double t, Input input, int index, float value);
+
+// MIDI arrives in the UART queue at t; the app sees it
+// on its next Listen()
+void ScheduleMidi(double t, const daisy::MidiEvent &ev);
+void ScheduleNoteOn(double t, int channel, int note, int velocity);
+void ScheduleNoteOff(double t, int channel, int note);
+void ScheduleControlChange(double t, int channel, int cc, int value);
+// MIDI clock (TimingClock) and transport
+void ScheduleRealTime(double t, daisy::SystemRealTimeType type);
+
+// ----------------------------------------------------
+// Audio hooks: pre() before each callback (fill
+// AudioInput() here), post() with the rendered block
+// ----------------------------------------------------
+struct AudioHooks
+{
+    void (*pre)(uint64_t block, void *ctx);
+    void (*post)(uint64_t            block,
+                 const float *const *out,
+                 size_t              channels,
+                 size_t              size,
+                 void *              ctx);
+    void *ctx;
+};
+void   SetAudioHooks(const AudioHooks &hooks);
+float *AudioInput(size_t channel); // current block, zeros by default
+
+// ----------------------------------------------------
+// Running
+// ----------------------------------------------------
+typedef int (*AppMain)();
+void Run(AppMain app_main);
+
+// ----------------------------------------------------
+// Captures
+// ----------------------------------------------------
+struct DacWrite
+{
+    int64_t  time_ns;
+    uint8_t  channel; // 0 or 1
+    uint16_t value;
+};
+
+struct GpioEdge
+{
+    int64_t      time_ns;
+    dsy_gpio_pin pin;
+    uint8_t      state;
+};
+
+struct Stats
+{
+    uint64_t blocks;      // audio callbacks
+    uint64_t timer_irqs;  // TimerHandle callbacks
+    uint64_t wfi;         // WaitForInterrupt() calls
+    uint64_t midi_in;     // events delivered to Listen()
+    uint64_t dac_writes;  // including unchanged values
+    double   sim_seconds; // simulated time since boot
+};
+
+// DAC writes that changed the channel's value
+const std::vector<DacWrite> &DacWrites();
+// output pin level changes, every pin
+const std::vector<GpioEdge> &GpioEdges();
+size_t                       CountEdges(dsy_gpio_pin pin);
+const Stats &                GetStats();
+
+float  SampleRate();
+size_t BlockSize();
+size_t AudioChannels();
+
+// the emulated OLED: Pixel(x, y), Dump(), transfer counts
+const daisyex::HostOledTransport<128, 64> &Panel();
+
+} // namespace daisyhost
+
+#endif
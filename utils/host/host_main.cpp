@@ -0,0 +1,123 @@
+/**********************************************************
+   host_main.cpp
+   Minimal driver for an app built on the host stub layer
+
+   Runs the app's main() for a number of seconds of audio
+   with fixed knobs and an optional held MIDI note, then
+   prints what the board saw. Meant for perf / valgrind:
+
+       build/FractalZoom -t 5 -n 60 -k 3=0.8
+       valgrind --tool=callgrind build/Randos -t 2 -n 48
+
+   options:
+       -t <s>        seconds of audio (10)
+       -k <i>=<v>    knob/CV i (0..3) at v (0..1)
+       -g <i>        gate input i held high
+       -n <note>     NoteOn at 50 ms, held
+       -q            no Logger output
+       -d            dump the OLED at the end
+**********************************************************/
+
+#include "host_board.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// the app's main(), renamed by the Makefile
+int APP_MAIN();
+
+using namespace daisyhost;
+
+static float g_peak[kMaxChannels];
+
+static void Post(uint64_t            block,
+                 const float *const *out,
+                 size_t              channels,
+                 size_t              size,
+                 void *              ctx)
+{
+    for(size_t c = 0; c < channels; c++)
+        for(size_t i = 0; i < size; i++)
+            if(fabsf(out[c][i]) > g_peak[c])
+                g_peak[c] = fabsf(out[c][i]);
+}
+
+static int Usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [-t seconds] [-k i=v]... [-g i]... [-n note] [-q] "
+            "[-d]\n",
+            name);
+    return 2;
+}
+
+int main(int argc, char **argv)
+{
+    const char *name = strrchr(argv[0], '/');
+    name             = name ? name + 1 : argv[0];
+
+    Config cfg;
+    bool   dump = false;
+    for(int i = 1; i < argc; i++)
+    {
+        const char *a   = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : nullptr;
+        if(!strcmp(a, "-t") && val)
+        {
+            cfg.seconds = atof(val);
+            i++;
+        }
+        else if(!strcmp(a, "-k") && val && strchr(val, '='))
+        {
+            SetInput(Input::KNOB, atoi(val), (float)atof(strchr(val, '=') + 1));
+            i++;
+        }
+        else if(!strcmp(a, "-g") && val)
+        {
+            SetInput(Input::GATE, atoi(val), 1.f);
+            i++;
+        }
+        else if(!strcmp(a, "-n") && val)
+        {
+            ScheduleNoteOn(0.05, 0, atoi(val), 100);
+            i++;
+        }
+        else if(!strcmp(a, "-q"))
+            cfg.log = false;
+        else if(!strcmp(a, "-d"))
+            dump = true;
+        else
+            return Usage(name);
+    }
+
+    Configure(cfg);
+    SetAudioHooks(AudioHooks{nullptr, Post, nullptr});
+    Run(APP_MAIN);
+
+    const Stats &st = GetStats();
+    printf("%s: %.2f s audio, %llu blocks of %u at %.0f Hz (%.2f s simulated)\n",
+           name,
+           (double)st.blocks * BlockSize() / SampleRate(),
+           (unsigned long long)st.blocks,
+           (unsigned)BlockSize(),
+           (double)SampleRate(),
+           st.sim_seconds);
+    printf("  peak   ");
+    for(size_t c = 0; c < AudioChannels(); c++)
+        printf(" %.3f", (double)g_peak[c]);
+    printf("\n  irqs    timer %llu  wfi %llu  midi in %llu\n",
+           (unsigned long long)st.timer_irqs,
+           (unsigned long long)st.wfi,
+           (unsigned long long)st.midi_in);
+    printf("  dac     %llu writes, %u changes\n",
+           (unsigned long long)st.dac_writes,
+           (unsigned)DacWrites().size());
+    printf("  gpio    %u edges\n", (unsigned)GpioEdges().size());
+    printf("  oled    %u transfers, %u bytes\n",
+           (unsigned)Panel().Transfers(),
+           (unsigned)Panel().DataBytes());
+    if(dump)
+        Panel().Dump(stdout);
+    return 0;
+}
@@ -0,0 +1,151 @@
+/**********************************************************
+   measure.cpp
+   The apps' measurement mode (audio_profile.h) on the
+   host stub layer, with the loopback cable simulated
+
+   The apps are built with AUDIO_MEASURE=1 for this driver
+   (build/measure_<app>.o). Their probe clicks on the last
+   output and listens on input 1; here that output is fed
+   back the way the Daisy's DMA double buffer would carry
+   it: the block a callback fills plays during the next
+   block period, the ADC captures during that period and
+   the callback after that gets it. So the round trip the
+   app prints is two blocks plus 'delay' samples standing
+   in for the codec's filters (0 by default).
+
+       measure <app> [-r samplerate] [-b blocksize]
+                     [-t seconds] [-d delay] [-n note]
+
+   (-n: a NoteOn at 0, so the patch apps aren't measuring
+   their silent path.)
+   prints the app's measurement lines (Logger, every 2s).
+   'make profiles' runs every app at 48/96 kHz and blocks
+   of 4/16/48/128 and keeps the last line of each.
+   Callback cycles are the host's (rdtsc against the
+   stub's 480 MHz CPU clock), so load and overhead compare
+   profiles with each other, not with the Daisy; the max,
+   and so the headroom, also catches the host OS
+   preempting a callback.
+**********************************************************/
+
+#include "host_board.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// the apps' main(), renamed by the Makefile
+int AppMain_Randos();
+int AppMain_FractalZoom();
+int AppMain_JustInTone();
+int AppMain_PodFractalZoom();
+
+using namespace daisyhost;
+
+namespace
+{
+struct App
+{
+    const char *name;
+    AppMain     main;
+};
+
+const App kApps[] = {
+    {"Randos", AppMain_Randos},
+    {"FractalZoom", AppMain_FractalZoom},
+    {"JustInTone", AppMain_JustInTone},
+    {"PodFractalZoom", AppMain_PodFractalZoom},
+};
+
+// the probe's output, delayed by two callbacks plus the
+// codec stand-in, back into input 1
+struct Loopback
+{
+    std::vector<float> line; // ring, newest at 'head'
+    size_t             head;
+    size_t             delay; // samples from callback out to callback in
+};
+
+void Pre(uint64_t block, void *ctx)
+{
+    Loopback *lb   = static_cast<Loopback *>(ctx);
+    size_t    size = BlockSize();
+    float *   in   = AudioInput(0);
+    size_t    n    = lb->line.size();
+    // sample i of this block was written 'delay' samples
+    // of stream time earlier
+    for(size_t i = 0; i < size; i++)
+        in[i] = lb->line[(lb->head + i + n - lb->delay) % n];
+}
+
+void Post(uint64_t            block,
+          const float *const *out,
+          size_t              channels,
+          size_t              size,
+          void *              ctx)
+{
+    Loopback *lb = static_cast<Loopback *>(ctx);
+    size_t    n  = lb->line.size();
+    for(size_t i = 0; i < size; i++)
+        lb->line[(lb->head + i) % n] = out[channels - 1][i];
+    lb->head = (lb->head + size) % n;
+}
+
+int Usage()
+{
+    fprintf(stderr,
+            "usage: measure <app> [-r samplerate] [-b blocksize] "
+            "[-t seconds] [-d delay] [-n note]\napps:");
+    for(const App &a : kApps)
+        fprintf(stderr, " %s", a.name);
+    fprintf(stderr, "\n");
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if(argc < 2)
+        return Usage();
+    const App *app = nullptr;
+    for(const App &a : kApps)
+        if(!strcmp(argv[1], a.name))
+            app = &a;
+    if(!app)
+        return Usage();
+
+    Config cfg;
+    size_t codec = 0;
+    cfg.seconds  = 5.0;
+    for(int i = 2; i < argc; i++)
+    {
+        const char *val = i + 1 < argc ? argv[i + 1] : nullptr;
+        if(!val)
+            return Usage();
+        if(!strcmp(argv[i], "-r"))
+            cfg.samplerate = (float)atof(argv[++i]);
+        else if(!strcmp(argv[i], "-b"))
+            cfg.blocksize = (size_t)atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-t"))
+            cfg.seconds = atof(argv[++i]);
+        else if(!strcmp(argv[i], "-d"))
+            codec = (size_t)atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-n"))
+            ScheduleNoteOn(0.0, 0, atoi(argv[++i]), 100);
+        else
+            return Usage();
+    }
+    if(cfg.blocksize == 0 || cfg.blocksize > 256 || cfg.samplerate <= 0.f)
+        return Usage();
+    Configure(cfg);
+
+    Loopback lb;
+    lb.delay = 2 * cfg.blocksize + codec;
+    lb.line.assign(lb.delay + cfg.blocksize, 0.f);
+    lb.head = 0;
+    SetAudioHooks(AudioHooks{Pre, Post, &lb});
+
+    Run(app->main);
+    return 0;
+}
@@ -0,0 +1,393 @@
+/**********************************************************
+   render.cpp
+   Offline renderer for the apps on the host stub layer
+
+   Runs one app faster than real time from a timeline of
+   control and MIDI events and writes what came out:
+
+       render FractalZoom -t 20 -s timelines/notes.txt -o out/fz
+
+   writes
+       out/fz.wav        audio outs, 32-bit float
+       out/fz_dac.csv    CV out changes: time_s,channel,code
+       out/fz_gpio.csv   output pin edges: time_s,pin,state
+
+   and reports the realtime factor and cycles per audio
+   callback (rdtsc on x86, see cycle_profiler.h).
+
+   Other options: -r/-b sample rate and block size, -k i=v
+   a knob from the start, -n a NoteOn at 0, -l the app's
+   Logger lines on stdout.
+
+   Timeline: one event per line, '#' comments, time in
+   seconds of audio:
+       0.0   knob 3 0.8          knob/CV 0..3, value 0..1
+       0.0   ramp 0 0.2 0.9 4.0  knob 0 from 0.2 to 0.9 over 4 s
+       0.5   note 60 100         NoteOn (velocity 0 = off)
+       1.5   noteoff 60
+       1.0   cc 1 64
+       2.0   gate 0 1            gate input 0 high
+       2.0   gateclock 0 4 8     gate 0: 4 Hz pulses for 8 s
+       1.0   clock 120 10        MIDI clock, 120 bpm for 10 s
+       1.0   start               MIDI Start (stop, continue)
+       2.0   button 1 1          Pod button 2 down
+       3.0   turn -2             encoder detents
+       3.0   press 1             encoder switch down
+   MIDI goes out on channel 1 unless 'ch <n>' (1..16)
+   follows the event.
+**********************************************************/
+
+#include "host_board.h"
+#include "cycle_profiler.h"
+#include "wav_writer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// the apps' main(), renamed by the Makefile
+int AppMain_Randos();
+int AppMain_FractalZoom();
+int AppMain_JustInTone();
+int AppMain_PodFractalZoom();
+
+using namespace daisyhost;
+
+namespace
+{
+struct App
+{
+    const char *name;
+    AppMain     main;
+};
+
+const App kApps[] = {
+    {"Randos", AppMain_Randos},
+    {"FractalZoom", AppMain_FractalZoom},
+    {"JustInTone", AppMain_JustInTone},
+    {"PodFractalZoom", AppMain_PodFractalZoom},
+};
+
+// ----------------------------------------------------
+// Timeline
+// ----------------------------------------------------
+bool Fail(const char *path, int line, const char *what)
+{
+    fprintf(stderr, "%s:%d: %s\n", path, line, what);
+    return false;
+}
+
+bool LoadTimeline(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if(!f)
+    {
+        fprintf(stderr, "can't open %s\n", path);
+        return false;
+    }
+    char buf[256];
+    int  line = 0;
+    bool ok   = true;
+    while(ok && fgets(buf, sizeof(buf), f))
+    {
+        line++;
+        if(char *hash = strchr(buf, '#'))
+            *hash = 0;
+        double t;
+        char   ev[16];
+        float  a[4] = {0.f, 0.f, 0.f, 0.f};
+        char   msg[64];
+        int    n = sscanf(buf, "%lf %15s", &t, ev);
+        if(n <= 0)
+            continue; // blank
+        if(n < 2)
+        {
+            ok = Fail(path, line, "expected: <time> <event> <args>");
+            break;
+        }
+        const char *args = strstr(buf, ev) + strlen(ev);
+        int na = sscanf(args, "%f %f %f %f", &a[0], &a[1], &a[2], &a[3]);
+        int ch = 0;
+        if(const char *c = strstr(args, "ch "))
+            ch = atoi(c + 3) - 1;
+        if(ch < 0 || ch > 15)
+            ok = Fail(path, line, "MIDI channel is 1..16");
+        else if(!strcmp(ev, "knob") && na >= 2)
+            Schedule(t, Input::KNOB, (int)a[0], a[1]);
+        else if(!strcmp(ev, "ramp") && na >= 4)
+        {
+            // one step per millisecond, about one per block
+            int steps = std::max(1, (int)(a[3] * 1000.f));
+            for(int i = 0; i <= steps; i++)
+                Schedule(t + a[3] * i / steps,
+                         Input::KNOB,
+                         (int)a[0],
+                         a[1] + (a[2] - a[1]) * i / steps);
+        }
+        else if(!strcmp(ev, "note") && na >= 2)
+            ScheduleNoteOn(t, ch, (int)a[0], (int)a[1]);
+        else if(!strcmp(ev, "noteoff") && na >= 1)
+            ScheduleNoteOff(t, ch, (int)a[0]);
+        else if(!strcmp(ev, "cc") && na >= 2)
+            ScheduleControlChange(t, ch, (int)a[0], (int)a[1]);
+        else if(!strcmp(ev, "gate") && na >= 2)
+            Schedule(t, Input::GATE, (int)a[0], a[1]);
+        else if(!strcmp(ev, "gateclock") && na >= 3 && a[1] > 0.f)
+        {
+            // 50% duty
+            double period = 1.0 / a[1];
+            for(double p = 0.0; p < a[2] - 1e-9; p += period)
+            {
+                Schedule(t + p, Input::GATE, (int)a[0], 1.f);
+                Schedule(t + p + period / 2, Input::GATE, (int)a[0], 0.f);
+            }
+        }
+        else if(!strcmp(ev, "clock") && na >= 2 && a[0] > 0.f)
+        {
+            // 24 per quarter note
+            double period = 60.0 / (a[0] * 24.0);
+            for(double p = 0.0; p < a[1] - 1e-9; p += period)
+                ScheduleRealTime(t + p, daisy::TimingClock);
+        }
+        else if(!strcmp(ev, "start"))
+            ScheduleRealTime(t, daisy::Start);
+        else if(!strcmp(ev, "stop"))
+            ScheduleRealTime(t, daisy::Stop);
+        else if(!strcmp(ev, "continue"))
+            ScheduleRealTime(t, daisy::Continue);
+        else if(!strcmp(ev, "button") && na >= 2)
+            Schedule(t, Input::BUTTON, (int)a[0], a[1]);
+        else if(!strcmp(ev, "turn") && na >= 1)
+            Schedule(t, Input::ENCODER_TURN, 0, a[0]);
+        else if(!strcmp(ev, "press") && na >= 1)
+            Schedule(t, Input::ENCODER_PRESS, 0, a[0]);
+        else
+        {
+            snprintf(msg, sizeof(msg), "bad event '%s'", ev);
+            ok = Fail(path, line, msg);
+        }
+    }
+    fclose(f);
+    return ok;
+}
+
+// ----------------------------------------------------
+// Per-block capture: cycles around each callback, the
+// audio into the WAV
+// ----------------------------------------------------
+struct Capture
+{
+    std::string           wav_path;
+    WavWriter             wav;
+    bool                  wav_ok;
+    uint32_t              start;
+    std::vector<uint32_t> cycles; // per callback
+};
+
+void Pre(uint64_t block, void *ctx)
+{
+    static_cast<Capture *>(ctx)->start = daisyex::CycleCount();
+}
+
+void Post(uint64_t            block,
+          const float *const *out,
+          size_t              channels,
+          size_t              size,
+          void *              ctx)
+{
+    uint32_t end = daisyex::CycleCount();
+    Capture *cap = static_cast<Capture *>(ctx);
+    cap->cycles.push_back(end - cap->start);
+    // the app picks the channel count on StartAudio
+    if(block == 0 && !cap->wav_path.empty())
+        cap->wav_ok = cap->wav.Open(cap->wav_path.c_str(),
+                                    channels,
+                                    (uint32_t)SampleRate());
+    if(cap->wav_ok)
+        cap->wav.Write(out, size);
+}
+
+// counter ticks per second, against the wall clock
+double CounterRate()
+{
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point                 t0 = Clock::now();
+    uint32_t                          c0 = daisyex::CycleCount();
+    double                            dt;
+    do
+        dt = std::chrono::duration<double>(Clock::now() - t0).count();
+    while(dt < 0.02);
+    return (double)(uint32_t)(daisyex::CycleCount() - c0) / dt;
+}
+
+void PinName(char *buf, size_t size, dsy_gpio_pin pin)
+{
+    snprintf(buf, size, "P%c%u", 'A' + (int)pin.port, (unsigned)pin.pin);
+}
+
+bool WriteCsv(const std::string &prefix)
+{
+    std::string path = prefix + "_dac.csv";
+    FILE *      f    = fopen(path.c_str(), "w");
+    if(!f)
+        return false;
+    fprintf(f, "time_s,channel,code\n");
+    for(const DacWrite &d : DacWrites())
+        fprintf(f, "%.9f,%u,%u\n", d.time_ns * 1e-9, d.channel + 1, d.value);
+    fclose(f);
+
+    path = prefix + "_gpio.csv";
+    f    = fopen(path.c_str(), "w");
+    if(!f)
+        return false;
+    fprintf(f, "time_s,pin,state\n");
+    for(const GpioEdge &g : GpioEdges())
+    {
+        char pin[8];
+        PinName(pin, sizeof(pin), g.pin);
+        fprintf(f, "%.9f,%s,%u\n", g.time_ns * 1e-9, pin, g.state);
+    }
+    fclose(f);
+    return true;
+}
+
+int Usage()
+{
+    fprintf(stderr,
+            "usage: render <app> [-t seconds] [-s timeline] [-o prefix]\n"
+            "              [-r samplerate] [-b blocksize] [-k i=v] [-n note] "
+            "[-l]\n"
+            "apps:");
+    for(const App &a : kApps)
+        fprintf(stderr, " %s", a.name);
+    fprintf(stderr, "\n");
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if(argc < 2)
+        return Usage();
+    const App *app = nullptr;
+    for(const App &a : kApps)
+        if(!strcmp(argv[1], a.name))
+            app = &a;
+    if(!app)
+        return Usage();
+
+    Config      cfg;
+    const char *prefix = nullptr;
+    cfg.log            = false;
+    for(int i = 2; i < argc; i++)
+    {
+        const char *a   = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : nullptr;
+        if(!val && strcmp(a, "-l"))
+            return Usage();
+        if(!strcmp(a, "-t"))
+            cfg.seconds = atof(argv[++i]);
+        else if(!strcmp(a, "-s"))
+        {
+            if(!LoadTimeline(argv[++i]))
+                return 1;
+        }
+        else if(!strcmp(a, "-o"))
+            prefix = argv[++i];
+        else if(!strcmp(a, "-r"))
+            cfg.samplerate = (float)atof(argv[++i]);
+        else if(!strcmp(a, "-b"))
+            cfg.blocksize = (size_t)atoi(argv[++i]);
+        else if(!strcmp(a, "-k") && strchr(val, '='))
+        {
+            SetInput(Input::KNOB, atoi(val), (float)atof(strchr(val, '=') + 1));
+            i++;
+        }
+        else if(!strcmp(a, "-n"))
+            ScheduleNoteOn(0.0, 0, atoi(argv[++i]), 100);
+        else if(!strcmp(a, "-l"))
+            cfg.log = true;
+        else
+            return Usage();
+    }
+    if(cfg.blocksize == 0 || cfg.blocksize > 256 || cfg.samplerate <= 0.f)
+        return Usage();
+    Configure(cfg);
+
+    Capture cap;
+    cap.wav_ok = false;
+    if(prefix)
+        cap.wav_path = std::string(prefix) + ".wav";
+    cap.cycles.reserve((size_t)(cfg.seconds * cfg.samplerate / cfg.blocksize)
+                       + 1);
+    SetAudioHooks(AudioHooks{Pre, Post, &cap});
+
+    double rate = CounterRate();
+    auto   t0   = std::chrono::steady_clock::now();
+    Run(app->main);
+    double wall = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - t0)
+                      .count();
+    cap.wav.Close();
+
+    const Stats &st    = GetStats();
+    double       audio = (double)st.blocks * BlockSize() / SampleRate();
+    printf("%s: %.2f s of audio at %.0f Hz / %u in %.3f s, x%.0f realtime\n",
+           app->name,
+           audio,
+           (double)SampleRate(),
+           (unsigned)BlockSize(),
+           wall,
+           wall > 0.0 ? audio / wall : 0.0);
+
+    if(!cap.cycles.empty())
+    {
+        std::vector<uint32_t> sorted = cap.cycles;
+        std::sort(sorted.begin(), sorted.end());
+        uint64_t total = 0;
+        for(uint32_t c : sorted)
+            total += c;
+        size_t n      = sorted.size();
+        double avg    = (double)total / n;
+        double budget = rate * BlockSize() / SampleRate();
+        printf("  callback  cycles min %u  avg %.0f  p50 %u  p99 %u  max %u"
+               "  (%.1f/sample)\n",
+               sorted[0],
+               avg,
+               sorted[n / 2],
+               sorted[std::min(n - 1, n * 99 / 100)],
+               sorted[n - 1],
+               avg / BlockSize());
+        printf("            load avg %.2f%%  max %.2f%% of the block at "
+               "%.2f GHz; %.0f%% of the run\n",
+               100.0 * avg / budget,
+               100.0 * sorted[n - 1] / budget,
+               rate * 1e-9,
+               wall > 0.0 ? 100.0 * total / rate / wall : 0.0);
+    }
+    printf("  events    midi %llu  timer %llu  dac %u  gpio %u  oled %u\n",
+           (unsigned long long)st.midi_in,
+           (unsigned long long)st.timer_irqs,
+           (unsigned)DacWrites().size(),
+           (unsigned)GpioEdges().size(),
+           (unsigned)Panel().Transfers());
+
+    if(prefix)
+    {
+        if(!cap.wav_ok || !WriteCsv(prefix))
+        {
+            fprintf(stderr, "can't write %s.*\n", prefix);
+            return 1;
+        }
+        printf("  wrote     %s.wav (%u ch), %s_dac.csv, %s_gpio.csv\n",
+               prefix,
+               (unsigned)AudioChannels(),
+               prefix,
+               prefix);
+    }
+    return 0;
+}
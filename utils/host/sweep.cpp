@@ -0,0 +1,498 @@
+/**********************************************************
+   sweep.cpp
+   Parameter sweeps over the Randos and FractalZoom voice
+   engines, one job per configuration on all host cores
+
+   Each job runs one voice of the app's own engine
+   (randos_voices.h / fractal_voices.h) into a sine
+   oscillator for -t seconds, in blocks of 48 at 48 kHz,
+   and summarises what it played:
+
+       sweep randos -p seed=36:84:1 -p root=1,8 -p just=0,1
+       sweep fractal -p zoom=0.25:4:0.25 -p octaves=3:7:1 -o out
+
+   Parameters (name=a,b,c or name=lo:hi:step; the rest
+   keep the app's defaults):
+       randos   seed   MIDI key, seeds the step LCG (60)
+                root   0 none, 1..12 C..B (1)
+                range  octaves, 0.5..6 (1)
+                just   0 12-TET major, 1 just (0)
+                rate   steps per second (4)
+                slew   seconds (0.05)
+       fractal  zoom   zoomFactor (1)
+                point  zoomPoint (0)
+                octaves, lacunarity, gain (5, 2, 0.5)
+                slew   seconds (0.1)
+
+   Output is CSV on stdout, one row per configuration in
+   grid order: the parameters, steps (Randos step
+   boundaries / FractalZoom fractal evaluations), note
+   changes, lowest and highest MIDI note, a 12-bin pitch
+   class histogram (fraction of blocks), a hash of the
+   audio, and the engine's CPU cost in cycles per sample.
+
+   Jobs share nothing but the read-only noise table and
+   write only their own row, so everything except the
+   cycle counts is the same for any -j; -c re-renders the
+   sweep on one thread and checks that. -o <dir> also
+   writes <dir>/<app>_<row>.wav per configuration.
+   Other options: -j threads (all cores), -q no summary.
+**********************************************************/
+
+#include "cycle_profiler.h"
+#include "daisysp.h"
+#include "fractal_voices.h"
+#include "randos_voices.h"
+#include "wav_writer.h"
+#include "work_pool.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace daisyhost;
+using namespace daisyex;
+using daisysp::Oscillator;
+
+namespace
+{
+const float  kSampleRate = 48000.f;
+const size_t kBlock      = 48;
+
+// ----------------------------------------------------
+// Parameters and the grid
+// ----------------------------------------------------
+struct ParamDef
+{
+    const char *name;
+    float       def;
+};
+
+const ParamDef kRandosParams[] = {
+    {"seed", 60.f},
+    {"root", 1.f},
+    {"range", 1.f},
+    {"just", 0.f},
+    {"rate", 4.f},
+    {"slew", 0.05f},
+};
+
+const ParamDef kFractalParams[] = {
+    {"zoom", 1.f},
+    {"point", 0.f},
+    {"octaves", 5.f},
+    {"lacunarity", 2.f},
+    {"gain", 0.5f},
+    {"slew", 0.1f},
+};
+
+enum Param
+{
+    // randos
+    SEED = 0,
+    ROOT,
+    RANGE,
+    JUST,
+    RATE,
+    R_SLEW,
+    // fractal
+    ZOOM = 0,
+    POINT,
+    OCTAVES,
+    LACUNARITY,
+    GAIN,
+    F_SLEW,
+};
+
+struct Grid
+{
+    const ParamDef *                defs;
+    size_t                          count;
+    std::vector<std::vector<float>> values; // per parameter
+
+    size_t Size() const
+    {
+        size_t n = 1;
+        for(const std::vector<float> &v : values)
+            n *= v.size();
+        return n;
+    }
+
+    // row -> values, first parameter slowest
+    std::vector<float> At(size_t row) const
+    {
+        std::vector<float> p(count);
+        for(size_t k = count; k-- > 0;)
+        {
+            p[k] = values[k][row % values[k].size()];
+            row /= values[k].size();
+        }
+        return p;
+    }
+};
+
+// "a,b,c" or "lo:hi:step"
+bool ParseList(const char *s, std::vector<float> &out)
+{
+    out.clear();
+    float lo, hi, step;
+    if(sscanf(s, "%f:%f:%f", &lo, &hi, &step) == 3)
+    {
+        if(step <= 0.f || hi < lo)
+            return false;
+        int n = (int)floor((hi - lo) / step + 1e-4) + 1;
+        for(int k = 0; k < n; k++)
+            out.push_back(lo + step * k);
+        return true;
+    }
+    for(const char *p = s; *p;)
+    {
+        char *end;
+        float v = strtof(p, &end);
+        if(end == p)
+            return false;
+        out.push_back(v);
+        p = *end == ',' ? end + 1 : end;
+        if(*end && *end != ',')
+            return false;
+    }
+    return !out.empty();
+}
+
+// ----------------------------------------------------
+// One job
+// ----------------------------------------------------
+struct Features
+{
+    uint32_t steps;
+    uint32_t note_changes;
+    int      low, high;
+    float    pitch_class[12];
+    uint64_t hash;
+    double   cycles_per_sample; // varies run to run
+
+    bool SameAs(const Features &o) const
+    {
+        return steps == o.steps && note_changes == o.note_changes
+               && low == o.low && high == o.high && hash == o.hash
+               && memcmp(pitch_class, o.pitch_class, sizeof(pitch_class))
+                      == 0;
+    }
+};
+
+// block-rate pitch tracking + FNV-1a over the samples
+class Analyzer
+{
+  public:
+    Analyzer() : blocks_(0), prev_(-1), hash_(1469598103934665603ull)
+    {
+        memset(pc_, 0, sizeof(pc_));
+        f_.note_changes = 0;
+        f_.low          = 127;
+        f_.high         = 0;
+        f_.cycles       = 0;
+    }
+
+    void Block(const float *out, size_t n, float freq, uint32_t cycles)
+    {
+        for(size_t i = 0; i < n; i++)
+        {
+            uint32_t bits;
+            memcpy(&bits, &out[i], 4);
+            for(int b = 0; b < 4; b++)
+            {
+                hash_ ^= (bits >> (8 * b)) & 0xffu;
+                hash_ *= 1099511628211ull;
+            }
+        }
+        int note = (int)lrintf(69.f + 12.f * log2f(freq / 440.f));
+        note     = note < 0 ? 0 : (note > 127 ? 127 : note);
+        pc_[note % 12]++;
+        if(note < f_.low)
+            f_.low = note;
+        if(note > f_.high)
+            f_.high = note;
+        if(prev_ >= 0 && note != prev_)
+            f_.note_changes++;
+        prev_ = note;
+        f_.cycles += cycles;
+        blocks_++;
+    }
+
+    Features Finish(uint32_t steps, size_t samples) const
+    {
+        Features f;
+        f.steps        = steps;
+        f.note_changes = f_.note_changes;
+        f.low          = f_.low;
+        f.high         = f_.high;
+        for(int k = 0; k < 12; k++)
+            f.pitch_class[k] = blocks_ ? (float)pc_[k] / blocks_ : 0.f;
+        f.hash              = hash_;
+        f.cycles_per_sample = samples ? (double)f_.cycles / samples : 0.0;
+        return f;
+    }
+
+  private:
+    struct
+    {
+        uint32_t note_changes;
+        int      low, high;
+        uint64_t cycles;
+    } f_;
+    uint32_t pc_[12];
+    uint32_t blocks_;
+    int      prev_;
+    uint64_t hash_;
+};
+
+FractalNoise1D g_noise; // read-only once the jobs start
+
+Features RenderRandos(const std::vector<float> &p, double seconds, WavWriter *wav)
+{
+    RandosVoices<1> voices;
+    Oscillator      osc;
+    voices.Init(kSampleRate);
+    voices.SetPolyphony(1);
+    voices.SetSlewTime(p[R_SLEW]);
+    voices.SetStepInc(p[RATE] / kSampleRate);
+    voices.NoteOn((uint8_t)p[SEED]);
+    osc.Init(kSampleRate);
+    osc.SetAmp(1.f);
+
+    PitchSettings ps = {(int)p[ROOT], p[RANGE], p[JUST] != 0.f};
+    size_t   blocks  = (size_t)ceil(seconds * kSampleRate / kBlock);
+    Analyzer an;
+    float    out[kBlock];
+    for(size_t b = 0; b < blocks; b++)
+    {
+        uint32_t c0 = CycleCount();
+        for(size_t i = 0; i < kBlock; i++)
+        {
+            voices.Process(ps);
+            osc.SetFreq(voices.Freq(0));
+            out[i] = osc.Process();
+        }
+        uint32_t c1 = CycleCount();
+        an.Block(out, kBlock, voices.Freq(0), c1 - c0);
+        if(wav)
+        {
+            const float *ch[1] = {out};
+            wav->Write(ch, kBlock);
+        }
+    }
+    return an.Finish(voices.Steps(), blocks * kBlock);
+}
+
+Features RenderFractal(const std::vector<float> &p, double seconds, WavWriter *wav)
+{
+    FractalVoices<1> voices;
+    Oscillator       osc;
+    voices.Init(kSampleRate, &g_noise);
+    voices.SetPolyphony(1);
+    voices.SetDuration((float)seconds + 1.f); // outlasts the render
+    voices.SetSlewTime(p[F_SLEW]);
+    voices.NoteOn(60, p[ZOOM], p[POINT]);
+    osc.Init(kSampleRate);
+    osc.SetAmp(1.f);
+
+    FbmParams fp     = {(int)p[OCTAVES], p[LACUNARITY], p[GAIN]};
+    size_t    blocks = (size_t)ceil(seconds * kSampleRate / kBlock);
+    Analyzer  an;
+    float     out[kBlock];
+    for(size_t b = 0; b < blocks; b++)
+    {
+        uint32_t c0 = CycleCount();
+        voices.BeginBlock(fp, kBlock);
+        osc.SetFreq(voices.Freq(0));
+        for(size_t i = 0; i < kBlock; i++)
+        {
+            voices.Process();
+            if(voices.Gliding(0))
+                osc.SetFreq(voices.Freq(0));
+            out[i] = osc.Process();
+        }
+        uint32_t c1 = CycleCount();
+        an.Block(out, kBlock, voices.Freq(0), c1 - c0);
+        if(wav)
+        {
+            const float *ch[1] = {out};
+            wav->Write(ch, kBlock);
+        }
+    }
+    return an.Finish(voices.GetMetrics().evals, blocks * kBlock);
+}
+
+// ----------------------------------------------------
+// Output
+// ----------------------------------------------------
+void PrintHeader(const Grid &g)
+{
+    for(size_t k = 0; k < g.count; k++)
+        printf("%s,", g.defs[k].name);
+    printf("steps,note_changes,low,high");
+    for(int k = 0; k < 12; k++)
+        printf(",pc%d", k);
+    printf(",hash,cycles_per_sample\n");
+}
+
+void PrintRow(const Grid &g, const std::vector<float> &p, const Features &f)
+{
+    for(size_t k = 0; k < g.count; k++)
+        printf("%g,", (double)p[k]);
+    printf("%u,%u,%d,%d",
+           (unsigned)f.steps,
+           (unsigned)f.note_changes,
+           f.low,
+           f.high);
+    for(int k = 0; k < 12; k++)
+        printf(",%.4f", (double)f.pitch_class[k]);
+    printf(",%016llx,%.1f\n", (unsigned long long)f.hash, f.cycles_per_sample);
+}
+
+int Usage()
+{
+    fprintf(stderr,
+            "usage: sweep randos|fractal [-t seconds] [-j threads] "
+            "[-p name=list]... [-o dir] [-c] [-q]\n");
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if(argc < 2)
+        return Usage();
+
+    Grid        g;
+    const char *app = argv[1];
+    bool        randos;
+    if(!strcmp(app, "randos"))
+    {
+        randos  = true;
+        g.defs  = kRandosParams;
+        g.count = sizeof(kRandosParams) / sizeof(kRandosParams[0]);
+    }
+    else if(!strcmp(app, "fractal"))
+    {
+        randos  = false;
+        g.defs  = kFractalParams;
+        g.count = sizeof(kFractalParams) / sizeof(kFractalParams[0]);
+    }
+    else
+        return Usage();
+    for(size_t k = 0; k < g.count; k++)
+        g.values.push_back(std::vector<float>(1, g.defs[k].def));
+
+    double      seconds = 10.0;
+    unsigned    threads = DefaultThreads();
+    const char *dir     = nullptr;
+    bool        check = false, quiet = false;
+    for(int i = 2; i < argc; i++)
+    {
+        const char *a   = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : nullptr;
+        if(!strcmp(a, "-c"))
+            check = true;
+        else if(!strcmp(a, "-q"))
+            quiet = true;
+        else if(!val)
+            return Usage();
+        else if(!strcmp(a, "-t"))
+            seconds = atof(argv[++i]);
+        else if(!strcmp(a, "-j"))
+            threads = (unsigned)atoi(argv[++i]);
+        else if(!strcmp(a, "-o"))
+            dir = argv[++i];
+        else if(!strcmp(a, "-p"))
+        {
+            const char *eq = strchr(val, '=');
+            size_t      k  = 0;
+            while(eq && k < g.count
+                  && (strlen(g.defs[k].name) != (size_t)(eq - val)
+                      || strncmp(g.defs[k].name, val, eq - val)))
+                k++;
+            if(!eq || k == g.count || !ParseList(eq + 1, g.values[k]))
+            {
+                fprintf(stderr, "bad parameter: %s\n", val);
+                return 2;
+            }
+            i++;
+        }
+        else
+            return Usage();
+    }
+
+    g_noise.Init();
+    EnableCycleCounter();
+
+    size_t                n = g.Size();
+    std::vector<Features> results(n);
+    auto                  job = [&](size_t row, unsigned) {
+        std::vector<float> p = g.At(row);
+        WavWriter          wav;
+        WavWriter *        w = nullptr;
+        if(dir)
+        {
+            std::string path
+                = std::string(dir) + "/" + app + "_" + std::to_string(row) + ".wav";
+            if(wav.Open(path.c_str(), 1, (uint32_t)kSampleRate))
+                w = &wav;
+        }
+        results[row] = randos ? RenderRandos(p, seconds, w)
+                              : RenderFractal(p, seconds, w);
+        wav.Close();
+    };
+
+    auto      t0    = std::chrono::steady_clock::now();
+    PoolStats stats = ParallelFor(n, threads, job);
+    double    wall  = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - t0)
+                      .count();
+
+    PrintHeader(g);
+    for(size_t row = 0; row < n; row++)
+        PrintRow(g, g.At(row), results[row]);
+
+    if(!quiet)
+    {
+        size_t stolen = 0;
+        for(size_t s : stats.stolen)
+            stolen += s;
+        fprintf(stderr,
+                "%s: %u configurations x %.1f s in %.2f s on %u threads, "
+                "%.1f configs/s, x%.0f realtime, %u stolen\n",
+                app,
+                (unsigned)n,
+                seconds,
+                wall,
+                (unsigned)stats.jobs.size(),
+                n / wall,
+                n * seconds / wall,
+                (unsigned)stolen);
+    }
+
+    if(check)
+    {
+        // same sweep on one thread, no files
+        dir = nullptr;
+        std::vector<Features> parallel = results;
+        ParallelFor(n, 1, job);
+        size_t diff = 0;
+        for(size_t row = 0; row < n; row++)
+            if(!results[row].SameAs(parallel[row]))
+                diff++;
+        fprintf(stderr,
+                "determinism: %s (%u of %u rows differ on 1 thread)\n",
+                diff ? "FAIL" : "ok",
+                (unsigned)diff,
+                (unsigned)n);
+        if(diff)
+            return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,97 @@
+/**********************************************************
+   wav_writer.h
+   32-bit float WAV output for the host tools
+
+   Open(), then Write() planar blocks as they come; Close()
+   patches the chunk sizes into the header.
+**********************************************************/
+#pragma once
+#ifndef DAISYHOST_WAV_WRITER_H
+#define DAISYHOST_WAV_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+namespace daisyhost
+{
+// ----------------------------------------------------
+// WAV, 32-bit float, written a block at a time
+// ----------------------------------------------------
+class WavWriter
+{
+  public:
+    WavWriter() : f_(nullptr), channels_(0), frames_(0) {}
+
+    static const size_t kMaxChannels = 8;
+
+    bool Open(const char *path, size_t channels, uint32_t samplerate)
+    {
+        if(channels < 1 || channels > kMaxChannels)
+            return false;
+        f_ = fopen(path, "wb");
+        if(!f_)
+            return false;
+        channels_ = channels;
+        rate_     = samplerate;
+        frames_   = 0;
+        WriteHeader(); // sizes patched in Close()
+        return true;
+    }
+
+    void Write(const float *const *in, size_t size)
+    {
+        float frame[kMaxChannels];
+        for(size_t i = 0; i < size; i++)
+        {
+            for(size_t c = 0; c < channels_; c++)
+                frame[c] = in[c][i];
+            fwrite(frame, sizeof(float), channels_, f_);
+        }
+        frames_ += size;
+    }
+
+    void Close()
+    {
+        if(!f_)
+            return;
+        fseek(f_, 0, SEEK_SET);
+        WriteHeader();
+        fclose(f_);
+        f_ = nullptr;
+    }
+
+  private:
+    void U32(uint32_t v) { fwrite(&v, 4, 1, f_); }
+    void U16(uint16_t v) { fwrite(&v, 2, 1, f_); }
+
+    void WriteHeader()
+    {
+        uint32_t data = (uint32_t)(frames_ * channels_ * sizeof(float));
+        fwrite("RIFF", 1, 4, f_);
+        U32(4 + (8 + 16) + (8 + 4) + (8 + data));
+        fwrite("WAVE", 1, 4, f_);
+        fwrite("fmt ", 1, 4, f_);
+        U32(16);
+        U16(3); // IEEE float
+        U16((uint16_t)channels_);
+        U32(rate_);
+        U32(rate_ * (uint32_t)(channels_ * sizeof(float)));
+        U16((uint16_t)(channels_ * sizeof(float)));
+        U16(32);
+        fwrite("fact", 1, 4, f_);
+        U32(4);
+        U32((uint32_t)frames_);
+        fwrite("data", 1, 4, f_);
+        U32(data);
+    }
+
+    FILE *   f_;
+    size_t   channels_;
+    uint32_t rate_;
+    uint64_t frames_;
+};
+
+} // namespace daisyhost
+
+#endif
@@ -0,0 +1,112 @@
+/**********************************************************
+   work_pool.h
+   Work-stealing parallel-for for the host tools
+
+   ParallelFor(n, threads, fn) runs fn(i, worker) once for
+   every i in [0, n). Each worker starts with a contiguous
+   slice of the indices in its own deque and takes from
+   the back of it; an idle worker steals from the front of
+   another's, so a slice of slow jobs gets spread out
+   without any up-front cost model.
+
+   Jobs are independent and no new ones are added once it
+   starts, so a worker that finds every deque empty is
+   done. Nothing here orders the calls: a caller that
+   wants deterministic output writes result i into slot i.
+**********************************************************/
+#pragma once
+#ifndef DAISYHOST_WORK_POOL_H
+#define DAISYHOST_WORK_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace daisyhost
+{
+struct PoolStats
+{
+    std::vector<size_t> jobs;   // per worker
+    std::vector<size_t> stolen; // per worker, jobs it stole
+};
+
+inline unsigned DefaultThreads()
+{
+    unsigned n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+inline PoolStats
+ParallelFor(size_t                                     n,
+            unsigned                                   threads,
+            const std::function<void(size_t, unsigned)> &fn)
+{
+    struct Queue
+    {
+        std::mutex         m;
+        std::deque<size_t> q;
+    };
+
+    if(threads < 1)
+        threads = 1;
+    if(threads > n && n > 0)
+        threads = (unsigned)n;
+
+    std::vector<Queue> queues(threads);
+    for(unsigned w = 0; w < threads; w++)
+        for(size_t i = n * w / threads; i < n * (w + 1) / threads; i++)
+            queues[w].q.push_back(i);
+
+    PoolStats stats;
+    stats.jobs.assign(threads, 0);
+    stats.stolen.assign(threads, 0);
+
+    auto worker = [&](unsigned w) {
+        for(;;)
+        {
+            size_t job;
+            bool   found = false;
+            {
+                std::lock_guard<std::mutex> lock(queues[w].m);
+                if(!queues[w].q.empty())
+                {
+                    job = queues[w].q.back();
+                    queues[w].q.pop_back();
+                    found = true;
+                }
+            }
+            for(unsigned k = 1; !found && k < threads; k++)
+            {
+                Queue &                     victim = queues[(w + k) % threads];
+                std::lock_guard<std::mutex> lock(victim.m);
+                if(!victim.q.empty())
+                {
+                    job = victim.q.front();
+                    victim.q.pop_front();
+                    found = true;
+                    stats.stolen[w]++;
+                }
+            }
+            if(!found)
+                return;
+            fn(job, w);
+            stats.jobs[w]++;
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for(unsigned w = 1; w < threads; w++)
+        pool.emplace_back(worker, w);
+    worker(0);
+    for(std::thread &t : pool)
+        t.join();
+    return stats;
+}
+
+} // namespace daisyhost
+
+#endif